@@ -0,0 +1,34 @@
+#ifndef _QUALITY_H
+#define _QUALITY_H
+
+// Configurações de qualidade do jogo (argumentos "--quality NIVEL" e
+// "--quality-config ARQUIVO"), carregadas pelas funções de "quality.cpp".
+// Os níveis pré-definidos são "low", "medium" e "high"; um arquivo de
+// configuração que altera algum valor resulta no nível "custom".
+struct QualitySettings
+{
+    char name[16];
+
+    // Distância do "far plane" até a câmera (BuildCamera())
+    float far_distance;
+
+    // Os obstáculos aparecem com Z do modelo em [spawn_near, spawn_far) e são
+    // removidos quando o Z da sua posição fica abaixo de behind_z. Como mudam
+    // a partida, estes valores são gravados junto com as entradas ("--record").
+    int spawn_near;
+    int spawn_far;
+    float behind_z;
+
+    // Amostragem das texturas (LoadTextureImage()): deslocamento do nível de
+    // mipmap escolhido e anisotropia máxima (1 = desligada)
+    float lod_bias;
+    float anisotropy;
+
+    // Amostras por pixel do framebuffer (0 = sem MSAA)
+    int msaa_samples;
+
+    // Termo especular de Phong na iluminação de cada fragmento
+    bool specular;
+};
+
+#endif // _QUALITY_H
@@ -0,0 +1,57 @@
+#ifndef _TRIPLEBUFFER_H
+#define _TRIPLEBUFFER_H
+
+#include <atomic>
+
+// Buffer triplo sem travas (lock-free) para exatamente um produtor e um
+// consumidor, em threads diferentes.
+//
+// O produtor preenche o valor retornado por Write() e chama Publish(). O
+// consumidor chama Read(), que retorna sempre o valor publicado mais recente.
+// Nenhum dos dois espera pelo outro: existem três cópias de T, uma sendo
+// escrita, uma sendo lida, e uma intermediária que guarda a última publicação
+// e é trocada atomicamente com a do produtor ou com a do consumidor.
+template <typename T>
+class TripleBuffer
+{
+public:
+    TripleBuffer() : m_Write(0), m_Middle(1), m_Read(2) {}
+
+    // Inicializa as três cópias com o mesmo valor. Deve ser chamada antes de
+    // o produtor e o consumidor começarem a executar.
+    void Reset(const T& value)
+    {
+        m_Buffers[0] = m_Buffers[1] = m_Buffers[2] = value;
+        m_Write = 0;
+        m_Middle.store(1);
+        m_Read = 2;
+    }
+
+    // Cópia que o produtor pode escrever livremente
+    T& Write() { return m_Buffers[m_Write]; }
+
+    // Publica a cópia de Write(); o produtor recebe outra cópia para escrever
+    void Publish()
+    {
+        m_Write = m_Middle.exchange(m_Write | NEW_DATA, std::memory_order_acq_rel) & INDEX_MASK;
+    }
+
+    // Retorna a última cópia publicada. O valor continua válido até a próxima
+    // chamada de Read().
+    const T& Read()
+    {
+        if (m_Middle.load(std::memory_order_relaxed) & NEW_DATA)
+            m_Read = m_Middle.exchange(m_Read, std::memory_order_acq_rel) & INDEX_MASK;
+        return m_Buffers[m_Read];
+    }
+
+private:
+    enum { INDEX_MASK = 3, NEW_DATA = 4 };
+
+    T m_Buffers[3];
+    int m_Write;               // Usado somente pelo produtor
+    std::atomic<int> m_Middle; // Índice da cópia intermediária + bit NEW_DATA
+    int m_Read;                // Usado somente pelo consumidor
+};
+
+#endif // _TRIPLEBUFFER_H
@@ -3,8 +3,26 @@
 
 #include <cstdio>
 
+// Tipos de objeto aceitos por GlDebug_Label() (GL_KHR_debug), que não estão
+// no OpenGL 3.3 carregado pela GLAD
+#define GL_BUFFER  0x82E0
+#define GL_SHADER  0x82E1
+#define GL_PROGRAM 0x82E2
+#define GL_SAMPLER 0x82E6
+
+// Nas compilações de release (NDEBUG) a verificação some. Nas de depuração,
+// se o contexto tem GL_KHR_debug os erros já chegam pelo callback de
+// gldebug.cpp e glGetError(), que faz a CPU esperar a GPU, não é chamada.
+#ifdef NDEBUG
+#define glCheckError() ((void)0)
+#else
+bool GlDebug_Active(); // Função definida em gldebug.cpp
+
 static GLenum glCheckError_(const char *file, int line)
 {
+    if (GlDebug_Active())
+        return GL_NO_ERROR;
+
     GLenum errorCode;
     while ((errorCode = glGetError()) != GL_NO_ERROR)
     {
@@ -25,5 +43,6 @@ static GLenum glCheckError_(const char *file, int line)
     return errorCode;
 }
 #define glCheckError() glCheckError_(__FILE__, __LINE__)
+#endif // NDEBUG
 
 #endif // _UTILS_H
@@ -0,0 +1,106 @@
+// Clipes de animação amostrados: cada clipe é uma tabela de poses tomadas em
+// intervalos regulares, e a pose em um instante qualquer é a interpolação
+// linear entre as duas amostras vizinhas. O custo de avaliar uma pose é o
+// mesmo a qualquer instante e não depende do passo da simulação nem da taxa
+// de quadros.
+//
+// As amostras ficam em estrutura de vetores: uma linha por canal (ângulo de
+// uma articulação), com os clipes lado a lado ao longo da linha. Todos os
+// clipes têm o mesmo número de canais. Animation_EvaluateBatch() avalia as
+// poses de vários personagens de uma vez, canal a canal, e mistura cada uma
+// com a pose de um segundo clipe, usada nas transições.
+#include <cstdio>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+
+namespace
+{
+    struct AnimationClip
+    {
+        size_t offset;     // Primeira coluna do clipe nas linhas da tabela
+        size_t frames;     // Número de amostras (pelo menos duas)
+        float sampleRate;  // Amostras por segundo
+        bool loop;         // A última amostra é igual à primeira
+    };
+
+    std::vector<AnimationClip> animation_clips;
+    std::vector< std::vector<float> > animation_rows;
+
+    // Índice da amostra anterior ao instante "time" do clipe, em colunas da
+    // tabela, e a fração do caminho até a seguinte
+    void Animation_Locate(const AnimationClip& clip, float time, size_t& column, float& fraction)
+    {
+        float duration = (clip.frames - 1) / clip.sampleRate;
+        if (clip.loop)
+            time -= duration * floorf(time / duration);
+        float position = std::min(std::max(time, 0.0f), duration) * clip.sampleRate;
+        size_t frame = std::min((size_t)position, clip.frames - 2);
+        column = clip.offset + frame;
+        fraction = position - (float)frame;
+    }
+}
+
+// Cria um clipe a partir de "frames" poses de "channels" floats cada, tomadas
+// a "sampleRate" amostras por segundo. Retorna -1 se o número de canais for
+// diferente do dos clipes anteriores.
+int Animation_CreateClip(const float* poses, size_t channels, size_t frames, float sampleRate, bool loop)
+{
+    if (animation_rows.empty())
+        animation_rows.resize(channels);
+    if (channels != animation_rows.size() || frames == 0)
+    {
+        fprintf(stderr, "ERROR: animation clip with %d channels and %d frames.\n", (int)channels, (int)frames);
+        return -1;
+    }
+
+    // Um clipe de uma só pose é guardado com duas amostras iguais
+    size_t stored = std::max(frames, (size_t)2);
+    AnimationClip clip;
+    clip.offset = animation_rows[0].size();
+    clip.frames = stored;
+    clip.sampleRate = sampleRate;
+    clip.loop = loop;
+    for (size_t c = 0; c < channels; ++c)
+    {
+        for (size_t f = 0; f < stored; ++f)
+            animation_rows[c].push_back(poses[std::min(f, frames - 1) * channels + c]);
+    }
+    animation_clips.push_back(clip);
+    return (int)animation_clips.size() - 1;
+}
+
+// Avalia "count" personagens. O personagem i está no instante times[i] do
+// clipe clips[i], misturado com o instante fromTimes[i] do clipe fromClips[i]:
+// weights[i] é o peso de clips[i] (1 ignora o outro clipe). "out" recebe um
+// vetor de "count" floats por canal.
+void Animation_EvaluateBatch(const int* clips, const float* times, const int* fromClips, const float* fromTimes,
+                             const float* weights, size_t count, float* out)
+{
+    static thread_local std::vector<size_t> columns, fromColumns;
+    static thread_local std::vector<float> fractions, fromFractions;
+    columns.resize(count);
+    fromColumns.resize(count);
+    fractions.resize(count);
+    fromFractions.resize(count);
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        Animation_Locate(animation_clips[clips[i]], times[i], columns[i], fractions[i]);
+        Animation_Locate(animation_clips[fromClips[i]], fromTimes[i], fromColumns[i], fromFractions[i]);
+    }
+
+    for (size_t c = 0; c < animation_rows.size(); ++c)
+    {
+        const float* row = animation_rows[c].data();
+        float* o = out + c * count;
+        for (size_t i = 0; i < count; ++i)
+        {
+            const float* a = row + columns[i];
+            const float* b = row + fromColumns[i];
+            float to = a[0] + (a[1] - a[0]) * fractions[i];
+            float from = b[0] + (b[1] - b[0]) * fromFractions[i];
+            o[i] = from + (to - from) * weights[i];
+        }
+    }
+}
@@ -0,0 +1,143 @@
+// Medição de desempenho dos trechos mais usados do código (argumento
+// "--bench ARQUIVO" ou "make bench"). Os casos são registrados em
+// RunBenchmarks(), em main.cpp; aqui ficam a calibração, a medição e a
+// gravação dos resultados em JSON, para que possam ser comparados entre
+// versões.
+//
+// Cada caso é executado em blocos de N iterações, com N escolhido para que um
+// bloco dure pelo menos BENCH_MIN_SAMPLE_TIME. São medidos BENCH_REPETITIONS
+// blocos e guardamos o mínimo, a mediana e a média do tempo por iteração.
+#include <cstdio>
+#include <cmath>
+#include <ctime>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+
+namespace
+{
+    const double BENCH_MIN_SAMPLE_TIME = 0.02; // segundos
+    const int BENCH_REPETITIONS = 7;
+    const long BENCH_MAX_ITERATIONS = 1L << 30;
+
+    struct BenchResult
+    {
+        std::string name;
+        long iterations;    // Iterações por bloco
+        double min_ns;      // Tempo por iteração
+        double median_ns;
+        double mean_ns;
+        double stddev_ns;
+        double items;       // Itens processados por iteração (ex.: obstáculos)
+    };
+}
+
+typedef void (*BenchFunction)(void* data);
+
+std::vector<BenchResult> bench_results;
+
+// Impede que o compilador descarte cálculos cujo resultado não é usado
+volatile float bench_sink;
+void Bench_Sink(float value)
+{
+    bench_sink = value;
+}
+
+double Bench_RunBlock(BenchFunction fn, void* data, long iterations)
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (long i = 0; i < iterations; ++i)
+        fn(data);
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Mede "fn". "items" é o número de elementos processados por chamada, usado
+// para calcular a vazão (items_per_second).
+void Bench_Run(const char* name, BenchFunction fn, void* data, double items = 1.0)
+{
+    // Aquecimento e calibração: dobramos N até um bloco durar o suficiente
+    long iterations = 1;
+    double elapsed = Bench_RunBlock(fn, data, iterations);
+    while (elapsed < BENCH_MIN_SAMPLE_TIME && iterations < BENCH_MAX_ITERATIONS)
+    {
+        iterations *= 2;
+        elapsed = Bench_RunBlock(fn, data, iterations);
+    }
+
+    std::vector<double> samples(BENCH_REPETITIONS);
+    for (int r = 0; r < BENCH_REPETITIONS; ++r)
+        samples[r] = Bench_RunBlock(fn, data, iterations) * 1e9 / iterations;
+    std::sort(samples.begin(), samples.end());
+
+    BenchResult result;
+    result.name = name;
+    result.iterations = iterations;
+    result.min_ns = samples.front();
+    result.median_ns = samples[BENCH_REPETITIONS / 2];
+    result.mean_ns = 0.0;
+    for (int r = 0; r < BENCH_REPETITIONS; ++r)
+        result.mean_ns += samples[r] / BENCH_REPETITIONS;
+    result.stddev_ns = 0.0;
+    for (int r = 0; r < BENCH_REPETITIONS; ++r)
+        result.stddev_ns += (samples[r] - result.mean_ns) * (samples[r] - result.mean_ns) / BENCH_REPETITIONS;
+    result.stddev_ns = sqrt(result.stddev_ns);
+    result.items = items;
+    bench_results.push_back(result);
+
+    printf("%-48s %14.1f ns %14.1f ns %10ld\n", name, result.median_ns, result.min_ns, iterations);
+    fflush(stdout);
+}
+
+void Bench_PrintHeader()
+{
+    printf("%-48s %17s %17s %10s\n", "benchmark", "median", "min", "iterations");
+}
+
+// Grava os resultados. O formato segue o do Google Benchmark
+// ("context" + "benchmarks"), para poder usar as mesmas ferramentas de
+// comparação.
+bool Bench_WriteJson(const char* filename)
+{
+    FILE* file = fopen(filename, "w");
+    if (!file)
+    {
+        fprintf(stderr, "ERROR: cannot open \"%s\" for writing.\n", filename);
+        return false;
+    }
+
+    char date[32];
+    time_t now = time(NULL);
+    strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", localtime(&now));
+
+    fprintf(file, "{\n  \"context\": {\n");
+    fprintf(file, "    \"date\": \"%s\",\n", date);
+#if defined(__clang__)
+    fprintf(file, "    \"compiler\": \"clang %s\",\n", __clang_version__);
+#elif defined(__GNUC__)
+    fprintf(file, "    \"compiler\": \"gcc %s\",\n", __VERSION__);
+#elif defined(_MSC_VER)
+    fprintf(file, "    \"compiler\": \"msvc %d\",\n", _MSC_VER);
+#endif
+#ifdef NDEBUG
+    fprintf(file, "    \"library_build_type\": \"release\",\n");
+#else
+    fprintf(file, "    \"library_build_type\": \"debug\",\n");
+#endif
+    fprintf(file, "    \"repetitions\": %d\n  },\n", BENCH_REPETITIONS);
+
+    fprintf(file, "  \"benchmarks\": [\n");
+    for (size_t i = 0; i < bench_results.size(); ++i)
+    {
+        const BenchResult& r = bench_results[i];
+        fprintf(file, "    {\"name\": \"%s\", \"iterations\": %ld, \"real_time\": %.3f, \"min_time\": %.3f, "
+                      "\"mean_time\": %.3f, \"stddev_time\": %.3f, \"time_unit\": \"ns\", \"items_per_second\": %.1f}%s\n",
+                r.name.c_str(), r.iterations, r.median_ns, r.min_ns, r.mean_ns, r.stddev_ns,
+                r.items * 1e9 / r.median_ns, i + 1 < bench_results.size() ? "," : "");
+    }
+    fprintf(file, "  ]\n}\n");
+    fclose(file);
+
+    printf("Bench: wrote %d results to \"%s\"\n", (int)bench_results.size(), filename);
+    return true;
+}
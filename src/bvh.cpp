@@ -0,0 +1,431 @@
+// Hierarquia de volumes envolventes (BVH) sobre os triângulos de uma malha,
+// usada para testar colisões com a geometria real dos modelos e para lançar
+// raios contra eles.
+//
+// A árvore é construída uma vez, ao carregar o modelo, escolhendo cada
+// divisão pela heurística de área de superfície (SAH) avaliada em
+// BVH_BINS intervalos ao longo de cada eixo. Os nós ficam em um único vetor,
+// em profundidade: o filho esquerdo de um nó interno é sempre o nó seguinte
+// e só o índice do direito é guardado. Cada nó ocupa 32 bytes (dois por
+// linha de cache) e os triângulos são reordenados para que os de uma folha
+// fiquem contíguos.
+//
+// As consultas recebem a matriz de modelo da instância: a caixa ou o raio
+// é levado para o espaço do modelo, onde a árvore foi construída.
+#include <cstdio>
+#include <cmath>
+#include <cfloat>
+#include <vector>
+#include <algorithm>
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+#include <glm/geometric.hpp>
+
+glm::mat4 Transform_AffineInverse(const glm::mat4& m);
+
+namespace
+{
+    const int BVH_BINS = 16;
+    const unsigned int BVH_MAX_LEAF_SIZE = 8;  // Folhas maiores são sempre divididas
+    const int BVH_MAX_DEPTH = 60;              // Menor que o tamanho da pilha das consultas
+    const int BVH_STACK_SIZE = 64;
+
+    // Nó interno: count == 0 e "index" é o filho direito (o esquerdo é o nó
+    // seguinte). Folha: triângulos [index, index + count).
+    struct BvhNode
+    {
+        glm::vec3 min;
+        unsigned int index;
+        glm::vec3 max;
+        unsigned int count;
+    };
+
+    struct BvhTree
+    {
+        std::vector<BvhNode> nodes;
+        std::vector<glm::vec3> vertices; // 3 por triângulo, na ordem das folhas
+    };
+
+    std::vector<BvhTree> bvh_trees;
+
+    struct BvhBuilder
+    {
+        const float* triangles;
+        std::vector<unsigned int> order;
+        std::vector<glm::vec3> centroids;
+        std::vector<glm::vec3> mins;
+        std::vector<glm::vec3> maxs;
+    };
+
+    // Mesmo cálculo de intervalo usado ao avaliar as divisões
+    struct BvhLeftOfSplit
+    {
+        const BvhBuilder* b;
+        int axis, bin;
+        float min, scale;
+        bool operator()(unsigned int t) const
+        {
+            return std::min(BVH_BINS - 1, (int)((b->centroids[t][axis] - min) * scale)) < bin;
+        }
+    };
+
+    float Bvh_Area(const glm::vec3& min, const glm::vec3& max)
+    {
+        glm::vec3 e = max - min;
+        return e.x * e.y + e.y * e.z + e.z * e.x;
+    }
+
+    void Bvh_Subdivide(BvhTree& tree, BvhBuilder& b, unsigned int first, unsigned int count, int depth)
+    {
+        unsigned int nodeIndex = (unsigned int)tree.nodes.size();
+        tree.nodes.push_back(BvhNode());
+
+        glm::vec3 min(FLT_MAX), max(-FLT_MAX), cmin(FLT_MAX), cmax(-FLT_MAX);
+        for (unsigned int i = first; i < first + count; ++i)
+        {
+            unsigned int t = b.order[i];
+            min = glm::min(min, b.mins[t]);
+            max = glm::max(max, b.maxs[t]);
+            cmin = glm::min(cmin, b.centroids[t]);
+            cmax = glm::max(cmax, b.centroids[t]);
+        }
+        tree.nodes[nodeIndex].min = min;
+        tree.nodes[nodeIndex].max = max;
+
+        // Melhor divisão pela SAH, entre os limites dos intervalos de cada eixo
+        int bestAxis = -1;
+        int bestBin = 0;
+        float bestCost = FLT_MAX;
+        for (int axis = 0; axis < 3 && count > 2; ++axis)
+        {
+            float extent = cmax[axis] - cmin[axis];
+            if (extent <= 0.0f)
+                continue;
+
+            unsigned int binCount[BVH_BINS] = { 0 };
+            glm::vec3 binMin[BVH_BINS], binMax[BVH_BINS];
+            for (int k = 0; k < BVH_BINS; ++k)
+            {
+                binMin[k] = glm::vec3(FLT_MAX);
+                binMax[k] = glm::vec3(-FLT_MAX);
+            }
+            float scale = BVH_BINS / extent;
+            for (unsigned int i = first; i < first + count; ++i)
+            {
+                unsigned int t = b.order[i];
+                int k = std::min(BVH_BINS - 1, (int)((b.centroids[t][axis] - cmin[axis]) * scale));
+                ++binCount[k];
+                binMin[k] = glm::min(binMin[k], b.mins[t]);
+                binMax[k] = glm::max(binMax[k], b.maxs[t]);
+            }
+
+            // Custos de todas as divisões com duas varreduras
+            float leftArea[BVH_BINS - 1];
+            unsigned int leftCount[BVH_BINS - 1];
+            glm::vec3 lmin(FLT_MAX), lmax(-FLT_MAX);
+            unsigned int n = 0;
+            for (int k = 0; k < BVH_BINS - 1; ++k)
+            {
+                n += binCount[k];
+                lmin = glm::min(lmin, binMin[k]);
+                lmax = glm::max(lmax, binMax[k]);
+                leftCount[k] = n;
+                leftArea[k] = n ? Bvh_Area(lmin, lmax) : 0.0f;
+            }
+            glm::vec3 rmin(FLT_MAX), rmax(-FLT_MAX);
+            n = 0;
+            for (int k = BVH_BINS - 1; k > 0; --k)
+            {
+                n += binCount[k];
+                rmin = glm::min(rmin, binMin[k]);
+                rmax = glm::max(rmax, binMax[k]);
+                if (n == 0 || leftCount[k - 1] == 0)
+                    continue;
+                float cost = leftCount[k - 1] * leftArea[k - 1] + n * Bvh_Area(rmin, rmax);
+                if (cost < bestCost)
+                {
+                    bestCost = cost;
+                    bestAxis = axis;
+                    bestBin = k;
+                }
+            }
+        }
+
+        // Dividir só compensa se testar os dois filhos for mais barato que
+        // testar todos os triângulos deste nó
+        bool split = bestAxis >= 0 && (bestCost < count * Bvh_Area(min, max) || count > BVH_MAX_LEAF_SIZE);
+        unsigned int mid = first;
+        if (split)
+        {
+            BvhLeftOfSplit left = { &b, bestAxis, bestBin, cmin[bestAxis], BVH_BINS / (cmax[bestAxis] - cmin[bestAxis]) };
+            unsigned int* begin = b.order.data() + first;
+            unsigned int* middle = std::partition(begin, begin + count, left);
+            mid = (unsigned int)(middle - b.order.data());
+        }
+        else if (count > BVH_MAX_LEAF_SIZE && count > 2)
+        {
+            // Centróides coincidentes: dividimos ao meio
+            mid = first + count / 2;
+            split = true;
+        }
+
+        if (!split || depth >= BVH_MAX_DEPTH || mid == first || mid == first + count)
+        {
+            tree.nodes[nodeIndex].index = first;
+            tree.nodes[nodeIndex].count = count;
+            return;
+        }
+
+        tree.nodes[nodeIndex].count = 0;
+        Bvh_Subdivide(tree, b, first, mid - first, depth + 1);
+        tree.nodes[nodeIndex].index = (unsigned int)tree.nodes.size();
+        Bvh_Subdivide(tree, b, mid, first + count - mid, depth + 1);
+    }
+
+    bool Bvh_BoxesOverlap(const BvhNode& node, const glm::vec3& min, const glm::vec3& max)
+    {
+        return node.min.x <= max.x && node.max.x >= min.x &&
+               node.min.y <= max.y && node.max.y >= min.y &&
+               node.min.z <= max.z && node.max.z >= min.z;
+    }
+
+    // Projeção dos três vértices em "axis" comparada com a da caixa
+    bool Bvh_SeparatedOnAxis(const glm::vec3& axis, const glm::vec3& v0, const glm::vec3& v1, const glm::vec3& v2, const glm::vec3& half)
+    {
+        float p0 = glm::dot(axis, v0), p1 = glm::dot(axis, v1), p2 = glm::dot(axis, v2);
+        float r = half.x * fabsf(axis.x) + half.y * fabsf(axis.y) + half.z * fabsf(axis.z);
+        return std::min(p0, std::min(p1, p2)) > r || std::max(p0, std::max(p1, p2)) < -r;
+    }
+
+    // Teste de eixos separadores entre um triângulo e uma caixa (Akenine-Möller):
+    // os 3 eixos da caixa, a normal do triângulo e os 9 produtos vetoriais
+    bool Bvh_TriangleOverlapsBox(const glm::vec3* tri, const glm::vec3& center, const glm::vec3& half)
+    {
+        glm::vec3 v0 = tri[0] - center, v1 = tri[1] - center, v2 = tri[2] - center;
+        for (int k = 0; k < 3; ++k)
+        {
+            if (std::min(v0[k], std::min(v1[k], v2[k])) > half[k] || std::max(v0[k], std::max(v1[k], v2[k])) < -half[k])
+                return false;
+        }
+
+        glm::vec3 e[3] = { v1 - v0, v2 - v1, v0 - v2 };
+        glm::vec3 normal = glm::cross(e[0], e[1]);
+        float r = half.x * fabsf(normal.x) + half.y * fabsf(normal.y) + half.z * fabsf(normal.z);
+        if (fabsf(glm::dot(normal, v0)) > r)
+            return false;
+
+        for (int j = 0; j < 3; ++j)
+        {
+            if (Bvh_SeparatedOnAxis(glm::vec3(0.0f, -e[j].z, e[j].y), v0, v1, v2, half) ||
+                Bvh_SeparatedOnAxis(glm::vec3(e[j].z, 0.0f, -e[j].x), v0, v1, v2, half) ||
+                Bvh_SeparatedOnAxis(glm::vec3(-e[j].y, e[j].x, 0.0f), v0, v1, v2, half))
+                return false;
+        }
+        return true;
+    }
+
+    // Distância de entrada do raio na caixa do nó, ou FLT_MAX se não a cruza
+    // antes de "maxT"
+    float Bvh_RayEntersNode(const BvhNode& node, const glm::vec3& origin, const glm::vec3& invDirection, float maxT)
+    {
+        glm::vec3 t0 = (node.min - origin) * invDirection;
+        glm::vec3 t1 = (node.max - origin) * invDirection;
+        glm::vec3 tmin = glm::min(t0, t1), tmax = glm::max(t0, t1);
+        float enter = std::max(std::max(tmin.x, tmin.y), std::max(tmin.z, 0.0f));
+        float exit = std::min(std::min(tmax.x, tmax.y), std::min(tmax.z, maxT));
+        return enter <= exit ? enter : FLT_MAX;
+    }
+
+    // Möller-Trumbore: distância ao longo do raio, ou FLT_MAX
+    float Bvh_RayHitsTriangle(const glm::vec3* tri, const glm::vec3& origin, const glm::vec3& direction)
+    {
+        glm::vec3 e1 = tri[1] - tri[0], e2 = tri[2] - tri[0];
+        glm::vec3 p = glm::cross(direction, e2);
+        float det = glm::dot(e1, p);
+        if (fabsf(det) < 1e-12f)
+            return FLT_MAX;
+        float inv = 1.0f / det;
+        glm::vec3 s = origin - tri[0];
+        float u = glm::dot(s, p) * inv;
+        if (u < 0.0f || u > 1.0f)
+            return FLT_MAX;
+        glm::vec3 q = glm::cross(s, e1);
+        float v = glm::dot(direction, q) * inv;
+        if (v < 0.0f || u + v > 1.0f)
+            return FLT_MAX;
+        float t = glm::dot(e2, q) * inv;
+        return t >= 0.0f ? t : FLT_MAX;
+    }
+}
+
+// Constrói a BVH de "count" triângulos, dados por 9 floats cada (três
+// vértices xyz no espaço do modelo). Retorna o identificador usado nas
+// consultas.
+int Bvh_Build(const float* triangles, size_t count)
+{
+    BvhBuilder b;
+    b.triangles = triangles;
+    b.order.resize(count);
+    b.centroids.resize(count);
+    b.mins.resize(count);
+    b.maxs.resize(count);
+    for (size_t t = 0; t < count; ++t)
+    {
+        glm::vec3 v0(triangles[9*t + 0], triangles[9*t + 1], triangles[9*t + 2]);
+        glm::vec3 v1(triangles[9*t + 3], triangles[9*t + 4], triangles[9*t + 5]);
+        glm::vec3 v2(triangles[9*t + 6], triangles[9*t + 7], triangles[9*t + 8]);
+        b.order[t] = (unsigned int)t;
+        b.mins[t] = glm::min(v0, glm::min(v1, v2));
+        b.maxs[t] = glm::max(v0, glm::max(v1, v2));
+        b.centroids[t] = (v0 + v1 + v2) / 3.0f;
+    }
+
+    bvh_trees.push_back(BvhTree());
+    BvhTree& tree = bvh_trees.back();
+    tree.nodes.reserve(2 * count);
+    Bvh_Subdivide(tree, b, 0, (unsigned int)count, 0);
+
+    tree.vertices.resize(3 * count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        const float* t = triangles + 9 * b.order[i];
+        for (int v = 0; v < 3; ++v)
+            tree.vertices[3*i + v] = glm::vec3(t[3*v + 0], t[3*v + 1], t[3*v + 2]);
+    }
+    return (int)bvh_trees.size() - 1;
+}
+
+// Libera a memória da árvore; o identificador não é reaproveitado
+void Bvh_Release(int bvh)
+{
+    std::vector<BvhNode>().swap(bvh_trees[bvh].nodes);
+    std::vector<glm::vec3>().swap(bvh_trees[bvh].vertices);
+}
+
+size_t Bvh_NodeCount(int bvh)
+{
+    return bvh_trees[bvh].nodes.size();
+}
+
+// Caixa que envolve a malha, no espaço do modelo
+void Bvh_Bounds(int bvh, glm::vec3& min, glm::vec3& max)
+{
+    min = bvh_trees[bvh].nodes[0].min;
+    max = bvh_trees[bvh].nodes[0].max;
+}
+
+// Caixa do nó "node" (de 0 a Bvh_NodeCount() - 1), no espaço do modelo. Usada
+// para visualizar a árvore.
+void Bvh_NodeBounds(int bvh, size_t node, glm::vec3& min, glm::vec3& max)
+{
+    min = bvh_trees[bvh].nodes[node].min;
+    max = bvh_trees[bvh].nodes[node].max;
+}
+
+// Testa se a caixa [boxMin, boxMax], em coordenadas do mundo, intercepta
+// algum triângulo da malha na instância com matriz de modelo "model". A
+// caixa levada ao espaço do modelo é substituída pela caixa alinhada aos
+// eixos que a envolve; o teste é exato quando "model" só combina escalas,
+// translações e rotações múltiplas de 90 graus (caso dos obstáculos).
+bool Bvh_OverlapsBox(int bvh, const glm::mat4& model, const glm::vec3& boxMin, const glm::vec3& boxMax)
+{
+    const BvhTree& tree = bvh_trees[bvh];
+    glm::mat4 inverse = Transform_AffineInverse(model);
+    glm::vec3 center = glm::vec3(inverse * glm::vec4((boxMin + boxMax) * 0.5f, 1.0f));
+    glm::vec3 worldHalf = (boxMax - boxMin) * 0.5f;
+    glm::vec3 half(0.0f);
+    for (int c = 0; c < 3; ++c)
+        half += glm::abs(glm::vec3(inverse[c])) * worldHalf[c];
+    glm::vec3 min = center - half, max = center + half;
+
+    unsigned int stack[BVH_STACK_SIZE];
+    int sp = 0;
+    unsigned int i = 0;
+    for (;;)
+    {
+        const BvhNode& node = tree.nodes[i];
+        if (Bvh_BoxesOverlap(node, min, max))
+        {
+            if (node.count == 0)
+            {
+                stack[sp++] = node.index;
+                i = i + 1;
+                continue;
+            }
+            for (unsigned int t = node.index; t < node.index + node.count; ++t)
+            {
+                if (Bvh_TriangleOverlapsBox(&tree.vertices[3 * t], center, half))
+                    return true;
+            }
+        }
+        if (sp == 0)
+            return false;
+        i = stack[--sp];
+    }
+}
+
+// Lança um raio, em coordenadas do mundo, contra a malha na instância com
+// matriz de modelo "model". Retorna o parâmetro t do triângulo mais próximo
+// (ponto = origin + t * direction) até "maxT", ou -1 se não há interseção.
+float Bvh_Raycast(int bvh, const glm::mat4& model, const glm::vec3& origin, const glm::vec3& direction, float maxT)
+{
+    const BvhTree& tree = bvh_trees[bvh];
+    glm::mat4 inverse = Transform_AffineInverse(model);
+    // A direção não é normalizada, então t é o mesmo nos dois espaços
+    glm::vec3 o = glm::vec3(inverse * glm::vec4(origin, 1.0f));
+    glm::vec3 d = glm::vec3(inverse * glm::vec4(direction, 0.0f));
+    glm::vec3 invD = 1.0f / d;
+
+    float closest = maxT;
+    bool hit = false;
+    unsigned int stack[BVH_STACK_SIZE];
+    int sp = 0;
+    unsigned int i = 0;
+    if (Bvh_RayEntersNode(tree.nodes[0], o, invD, closest) == FLT_MAX)
+        return -1.0f;
+    for (;;)
+    {
+        const BvhNode& node = tree.nodes[i];
+        if (node.count == 0)
+        {
+            // Visitamos primeiro o filho mais próximo, para encurtar o raio cedo
+            unsigned int near = i + 1, far = node.index;
+            float tNear = Bvh_RayEntersNode(tree.nodes[near], o, invD, closest);
+            float tFar = Bvh_RayEntersNode(tree.nodes[far], o, invD, closest);
+            if (tFar < tNear)
+            {
+                std::swap(near, far);
+                std::swap(tNear, tFar);
+            }
+            if (tNear != FLT_MAX)
+            {
+                if (tFar != FLT_MAX)
+                    stack[sp++] = far;
+                i = near;
+                continue;
+            }
+        }
+        else
+        {
+            for (unsigned int t = node.index; t < node.index + node.count; ++t)
+            {
+                float distance = Bvh_RayHitsTriangle(&tree.vertices[3 * t], o, d);
+                if (distance < closest)
+                {
+                    closest = distance;
+                    hit = true;
+                }
+            }
+        }
+
+        // Filhos empilhados podem ter ficado além do ponto já encontrado
+        do
+        {
+            if (sp == 0)
+                return hit ? closest : -1.0f;
+            i = stack[--sp];
+        } while (Bvh_RayEntersNode(tree.nodes[i], o, invD, closest) == FLT_MAX);
+    }
+}
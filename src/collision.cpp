@@ -0,0 +1,257 @@
+// Teste de colisão entre o personagem e os obstáculos, feito uma vez por
+// passo da simulação. Todas as caixas são alinhadas aos eixos e descritas
+// pelo centro e pela metade do tamanho em cada eixo.
+//
+// O teste é contínuo: cada obstáculo percorre um segmento durante o passo e
+// calculamos o instante do passo em que a sua caixa encosta na do personagem
+// (considerado parado na posição do fim do passo). Assim um obstáculo rápido,
+// ou um passo longo, não atravessa o personagem sem ser detectado. As caixas
+// envolvem as malhas dos obstáculos; quem chama confirma a colisão contra os
+// triângulos (veja "bvh.cpp").
+//
+// Fase ampla: os obstáculos são agrupados pela pista em que apareceram. Só
+// são testadas as pistas cuja faixa de X cobre o personagem e, nelas, só os
+// obstáculos cujo segmento em Z passa a uma distância que pode alcançá-lo.
+// Os obstáculos não são ordenados por Z: com algumas dezenas deles, ordenar
+// a cada passo custa mais que a passagem linear que seleciona os candidatos.
+//
+// Fase estreita: os candidatos são copiados para vetores contíguos e
+// testados 4 de cada vez com SSE2 (ou 8 com AVX), intersectando os
+// intervalos de tempo em que as projeções em X, Y e Z se sobrepõem. O teste
+// de sobreposição no fim do passo usa as mesmas operações, na mesma ordem,
+// do teste escalar PlayerObstacleColision(), então uma colisão que ele
+// detecta também é sempre detectada aqui.
+#include <cstddef>
+#include <cmath>
+#include <cfloat>
+#include <vector>
+#include <algorithm>
+
+#include <glm/simd/platform.h>
+
+#if GLM_ARCH & GLM_ARCH_AVX_BIT
+#include <immintrin.h>
+#elif GLM_ARCH & GLM_ARCH_SSE2_BIT
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+    const int COLLISION_LANES = 3;
+
+    // Folga da fase ampla, para que ela nunca descarte um obstáculo que a fase
+    // estreita consideraria em colisão por diferença de arredondamento
+    const float COLLISION_MARGIN = 1e-3f;
+
+    // Memória reaproveitada entre as chamadas (uma por thread, por causa do
+    // modo "--batch"): centro, metade do tamanho e deslocamento no passo
+    thread_local std::vector<float> collision_candidates[9];
+    thread_local std::vector<unsigned int> collision_candidate_index;
+    thread_local std::vector<float> collision_times;
+
+    // Operações usadas pela fase estreita, para cada largura de registrador.
+    // Máscaras têm todos os bits ligados nas posições verdadeiras.
+    struct CollisionScalar
+    {
+        typedef float V;
+        static const size_t WIDTH = 1;
+        static V Load(const float* p) { return *p; }
+        static V Set1(float x) { return x; }
+        static V Add(V a, V b) { return a + b; }
+        static V Sub(V a, V b) { return a - b; }
+        static V Div(V a, V b) { return a / b; }
+        static V Min(V a, V b) { return a < b ? a : b; }
+        static V Max(V a, V b) { return a > b ? a : b; }
+        static V Abs(V a) { return fabsf(a); }
+        static V True() { return 1.0f; }
+        static V Less(V a, V b) { return a < b ? 1.0f : 0.0f; }
+        static V NotEqual(V a, V b) { return a != b ? 1.0f : 0.0f; }
+        static V And(V a, V b) { return (a != 0.0f && b != 0.0f) ? 1.0f : 0.0f; }
+        static V Select(V mask, V a, V b) { return mask != 0.0f ? a : b; }
+        static void Store(float* p, V a) { *p = a; }
+    };
+
+#if GLM_ARCH & GLM_ARCH_SSE2_BIT
+    struct CollisionSse
+    {
+        typedef __m128 V;
+        static const size_t WIDTH = 4;
+        static V Load(const float* p) { return _mm_loadu_ps(p); }
+        static V Set1(float x) { return _mm_set1_ps(x); }
+        static V Add(V a, V b) { return _mm_add_ps(a, b); }
+        static V Sub(V a, V b) { return _mm_sub_ps(a, b); }
+        static V Div(V a, V b) { return _mm_div_ps(a, b); }
+        static V Min(V a, V b) { return _mm_min_ps(a, b); }
+        static V Max(V a, V b) { return _mm_max_ps(a, b); }
+        static V Abs(V a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+        static V True() { return _mm_castsi128_ps(_mm_set1_epi32(-1)); }
+        static V Less(V a, V b) { return _mm_cmplt_ps(a, b); }
+        static V NotEqual(V a, V b) { return _mm_cmpneq_ps(a, b); }
+        static V And(V a, V b) { return _mm_and_ps(a, b); }
+        static V Select(V mask, V a, V b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+        static void Store(float* p, V a) { _mm_storeu_ps(p, a); }
+    };
+#endif
+
+#if GLM_ARCH & GLM_ARCH_AVX_BIT
+    struct CollisionAvx
+    {
+        typedef __m256 V;
+        static const size_t WIDTH = 8;
+        static V Load(const float* p) { return _mm256_loadu_ps(p); }
+        static V Set1(float x) { return _mm256_set1_ps(x); }
+        static V Add(V a, V b) { return _mm256_add_ps(a, b); }
+        static V Sub(V a, V b) { return _mm256_sub_ps(a, b); }
+        static V Div(V a, V b) { return _mm256_div_ps(a, b); }
+        static V Min(V a, V b) { return _mm256_min_ps(a, b); }
+        static V Max(V a, V b) { return _mm256_max_ps(a, b); }
+        static V Abs(V a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+        static V True() { return _mm256_castsi256_ps(_mm256_set1_epi32(-1)); }
+        static V Less(V a, V b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+        static V NotEqual(V a, V b) { return _mm256_cmp_ps(a, b, _CMP_NEQ_UQ); }
+        static V And(V a, V b) { return _mm256_and_ps(a, b); }
+        static V Select(V mask, V a, V b) { return _mm256_blendv_ps(b, a, mask); }
+        static void Store(float* p, V a) { _mm256_storeu_ps(p, a); }
+    };
+    typedef CollisionAvx CollisionOps;
+#elif GLM_ARCH & GLM_ARCH_SSE2_BIT
+    typedef CollisionSse CollisionOps;
+#else
+    typedef CollisionScalar CollisionOps;
+#endif
+
+    // Testa as caixas candidatas [0, count); "count" é múltiplo de Ops::WIDTH.
+    // Guarda em "times" o instante de contato de cada uma, em frações do
+    // passo, ou FLT_MAX.
+    template <class Ops>
+    void Collision_Narrowphase(const float player[6], const float* const c[9], size_t count, float* times)
+    {
+        typedef typename Ops::V V;
+        const V zero = Ops::Set1(0.0f);
+        const V one = Ops::Set1(1.0f);
+        const V never = Ops::Set1(FLT_MAX);
+        V p[6];
+        for (int k = 0; k < 6; ++k)
+            p[k] = Ops::Set1(player[k]);
+
+        for (size_t i = 0; i < count; i += Ops::WIDTH)
+        {
+            V endHit = Ops::True();
+            V enter = zero; // Intervalo de contato, limitado ao passo
+            V exit = one;
+            for (int k = 0; k < 3; ++k)
+            {
+                V center = Ops::Load(c[k] + i);
+                V limit = Ops::Add(p[k + 3], Ops::Load(c[k + 3] + i));
+                V motion = Ops::Load(c[k + 6] + i);
+
+                // Sobreposição no fim do passo
+                endHit = Ops::And(endHit, Ops::Less(Ops::Abs(Ops::Sub(p[k], center)), limit));
+
+                // Instantes em que |p - (início + t * deslocamento)| = limite
+                V start = Ops::Sub(p[k], Ops::Sub(center, motion));
+                V t0 = Ops::Div(Ops::Sub(start, limit), motion);
+                V t1 = Ops::Div(Ops::Add(start, limit), motion);
+                V moving = Ops::NotEqual(motion, zero);
+                V inside = Ops::Less(Ops::Abs(start), limit);
+                enter = Ops::Max(enter, Ops::Select(moving, Ops::Min(t0, t1), Ops::Select(inside, zero, never)));
+                exit = Ops::Min(exit, Ops::Select(moving, Ops::Max(t0, t1), never));
+            }
+            V sweptHit = Ops::Less(enter, exit);
+            Ops::Store(times + i, Ops::Select(sweptHit, enter, Ops::Select(endHit, one, never)));
+        }
+    }
+}
+
+// "player" tem o centro e a metade do tamanho da caixa do personagem
+// (x, y, z, hx, hy, hz). "boxes" tem as caixas dos obstáculos no fim do passo
+// em 6 vetores de "count" floats seguidos (cx, cy, cz, hx, hy, hz), "motion"
+// o deslocamento de cada um durante o passo em 3 vetores (dx, dy, dz) e
+// "lanes" a pista de cada um (0, 1 ou 2).
+//
+// Retorna quantas caixas encostam na do personagem durante o passo. Os
+// índices delas são guardados em "hits" e os instantes do contato, entre 0
+// (início do passo) e 1 (fim do passo), em "times"; os dois vetores devem ter
+// espaço para "count" elementos.
+size_t Collision_PlayerSweep(const float player[6], const float* boxes, const float* motion, const unsigned char* lanes, size_t count,
+                             unsigned int* hits, float* times)
+{
+    const float* cx = boxes;
+    const float* cz = boxes + 2 * count;
+    const float* hx = boxes + 3 * count;
+    const float* hz = boxes + 5 * count;
+    const float* dx = motion;
+    const float* dz = motion + 2 * count;
+
+    // Faixa de X percorrida e maior metade de profundidade de cada pista
+    float laneMinX[COLLISION_LANES], laneMaxX[COLLISION_LANES], laneMaxHalfZ[COLLISION_LANES];
+    for (int l = 0; l < COLLISION_LANES; ++l)
+    {
+        laneMinX[l] = FLT_MAX;
+        laneMaxX[l] = -FLT_MAX;
+        laneMaxHalfZ[l] = 0.0f;
+    }
+    for (size_t i = 0; i < count; ++i)
+    {
+        int l = lanes[i];
+        laneMinX[l] = std::min(laneMinX[l], std::min(cx[i], cx[i] - dx[i]) - hx[i]);
+        laneMaxX[l] = std::max(laneMaxX[l], std::max(cx[i], cx[i] - dx[i]) + hx[i]);
+        laneMaxHalfZ[l] = std::max(laneMaxHalfZ[l], hz[i]);
+    }
+
+    // Janela de Z de cada pista que pode alcançar o personagem. Pistas fora da
+    // faixa de X do personagem ficam com uma janela vazia.
+    float laneMinZ[COLLISION_LANES], laneMaxZ[COLLISION_LANES];
+    for (int l = 0; l < COLLISION_LANES; ++l)
+    {
+        float reach = player[5] + laneMaxHalfZ[l] + COLLISION_MARGIN;
+        laneMinZ[l] = player[2] - reach;
+        laneMaxZ[l] = player[2] + reach;
+        if (laneMaxX[l] + COLLISION_MARGIN < player[0] - player[3] || laneMinX[l] - COLLISION_MARGIN > player[0] + player[3])
+            laneMinZ[l] = FLT_MAX;
+    }
+
+    // Seleciona os candidatos: obstáculos cujo segmento em Z cruza a janela
+    for (int k = 0; k < 9; ++k)
+        collision_candidates[k].clear();
+    collision_candidate_index.clear();
+    for (size_t i = 0; i < count; ++i)
+    {
+        int l = lanes[i];
+        if (std::max(cz[i], cz[i] - dz[i]) < laneMinZ[l] || std::min(cz[i], cz[i] - dz[i]) > laneMaxZ[l])
+            continue;
+        for (int k = 0; k < 6; ++k)
+            collision_candidates[k].push_back(boxes[k * count + i]);
+        for (int k = 0; k < 3; ++k)
+            collision_candidates[6 + k].push_back(motion[k * count + i]);
+        collision_candidate_index.push_back((unsigned int)i);
+    }
+
+    size_t candidates = collision_candidates[0].size();
+    if (candidates == 0)
+        return 0;
+
+    // Completa o último grupo com caixas paradas e distantes, que nunca colidem
+    const size_t width = CollisionOps::WIDTH;
+    size_t padded = (candidates + width - 1) / width * width;
+    for (int k = 0; k < 9; ++k)
+        collision_candidates[k].resize(padded, k < 3 ? FLT_MAX : 0.0f);
+
+    const float* c[9];
+    for (int k = 0; k < 9; ++k)
+        c[k] = collision_candidates[k].data();
+    collision_times.resize(padded);
+    Collision_Narrowphase<CollisionOps>(player, c, padded, collision_times.data());
+
+    size_t n = 0;
+    for (size_t i = 0; i < candidates; ++i)
+    {
+        if (collision_times[i] <= 1.0f)
+        {
+            hits[n] = collision_candidate_index[i];
+            times[n] = collision_times[i];
+            ++n;
+        }
+    }
+    return n;
+}
@@ -0,0 +1,196 @@
+// Desenho de depuração em modo imediato: linhas, caixas e eixos podem ser
+// pedidos de qualquer ponto do quadro e são acumulados em um vetor de
+// vértices na CPU. DebugDraw_Flush(), chamada no fim da cena, envia tudo para
+// um buffer dinâmico e desenha com uma única chamada, qualquer que seja o
+// número de itens.
+//
+// Nas compilações de release (NDEBUG) este arquivo fica vazio e as funções
+// declaradas em main.cpp são trocadas por funções vazias. O renderizador por
+// software não desenha linhas, então os itens são descartados.
+#ifndef NDEBUG
+#include <vector>
+
+#include <glad/glad.h>
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "utils.h"
+
+GLuint CreateGpuProgram(GLuint vertex_shader_id, GLuint fragment_shader_id); // Função definida em main.cpp
+void TextRendering_LoadShader(const GLchar* const shader_string, GLuint shader_id); // Função definida em textrendering.cpp
+
+void Profiler_CountDrawCalls(int n); // Função definida em profiler.cpp
+
+void GlState_UseProgram(GLuint program); // Funções definidas em glstate.cpp
+void GlState_BindVertexArray(GLuint vertex_array);
+void GlState_BindBuffer(GLenum target, GLuint buffer);
+void GlState_DepthFunc(GLenum func);
+void GlState_Disable(GLenum cap);
+void GlState_LineWidth(float width);
+void GlState_UniformMatrix4fv(GLint location, const float* value);
+
+void GlDebug_Label(GLenum identifier, GLuint name, const char* label); // Funções definidas em gldebug.cpp
+void GlDebug_PushGroup(const char* name);
+void GlDebug_PopGroup();
+
+const GLchar* const debugvertexshader_source = ""
+"#version 330\n"
+"layout (location = 0) in vec3 position;\n"
+"layout (location = 1) in vec3 color;\n"
+"uniform mat4 view;\n"
+"uniform mat4 projection;\n"
+"out vec3 lineColor;\n"
+"void main()\n"
+"{\n"
+    "gl_Position = projection * view * vec4(position, 1.0);\n"
+    "lineColor = color;\n"
+"}\n"
+"\0";
+
+const GLchar* const debugfragmentshader_source = ""
+"#version 330\n"
+"in vec3 lineColor;\n"
+"out vec3 fragColor;\n"
+"void main()\n"
+"{\n"
+    "fragColor = lineColor;\n"
+"}\n"
+"\0";
+
+namespace
+{
+    // Vértice de uma linha, em coordenadas do mundo
+    struct DebugVertex
+    {
+        float x, y, z;
+        float r, g, b;
+    };
+}
+
+GLuint debugVAO;
+GLuint debugVBO;
+GLuint debugprogram_id;
+GLint debugview_uniform;
+GLint debugprojection_uniform;
+size_t debugbuffer_capacity = 0; // Em vértices
+
+// Vértices pedidos desde o último DebugDraw_Flush(), dois por linha
+std::vector<DebugVertex> debug_vertices;
+
+void DebugDraw_Init()
+{
+    GLuint debugvertexshader_id = glCreateShader(GL_VERTEX_SHADER);
+    TextRendering_LoadShader(debugvertexshader_source, debugvertexshader_id);
+
+    GLuint debugfragmentshader_id = glCreateShader(GL_FRAGMENT_SHADER);
+    TextRendering_LoadShader(debugfragmentshader_source, debugfragmentshader_id);
+
+    debugprogram_id = CreateGpuProgram(debugvertexshader_id, debugfragmentshader_id);
+    debugview_uniform = glGetUniformLocation(debugprogram_id, "view");
+    debugprojection_uniform = glGetUniformLocation(debugprogram_id, "projection");
+    GlDebug_Label(GL_PROGRAM, debugprogram_id, "DebugDraw");
+    glCheckError();
+
+    glGenVertexArrays(1, &debugVAO);
+    glGenBuffers(1, &debugVBO);
+    glBindVertexArray(debugVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, debugVBO);
+    GlDebug_Label(GL_VERTEX_ARRAY, debugVAO, "DebugDraw");
+    GlDebug_Label(GL_BUFFER, debugVBO, "DebugDraw");
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(DebugVertex), (void*)0);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(DebugVertex), (void*)(3 * sizeof(float)));
+    glEnableVertexAttribArray(1);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+    glCheckError();
+}
+
+void DebugDraw_Line(const glm::vec4& a, const glm::vec4& b, const glm::vec3& color)
+{
+    DebugVertex v[2] = {
+        { a.x, a.y, a.z, color.r, color.g, color.b },
+        { b.x, b.y, b.z, color.r, color.g, color.b }
+    };
+    debug_vertices.insert(debug_vertices.end(), v, v + 2);
+}
+
+// As 12 arestas da caixa [min, max] do espaço do modelo, levadas ao mundo
+// pela matriz "model"
+void DebugDraw_Box(const glm::mat4& model, const glm::vec3& min, const glm::vec3& max, const glm::vec3& color)
+{
+    // O bit k do índice do canto escolhe "max" (1) ou "min" (0) no eixo k
+    glm::vec4 corners[8];
+    for (int i = 0; i < 8; ++i)
+    {
+        glm::vec4 p((i & 1) ? max.x : min.x, (i & 2) ? max.y : min.y, (i & 4) ? max.z : min.z, 1.0f);
+        corners[i] = model * p;
+    }
+
+    // Cada aresta liga dois cantos que diferem em um só eixo
+    for (int i = 0; i < 8; ++i)
+    {
+        for (int k = 1; k < 8; k <<= 1)
+        {
+            if (!(i & k))
+                DebugDraw_Line(corners[i], corners[i | k], color);
+        }
+    }
+}
+
+void DebugDraw_Aabb(const glm::vec3& min, const glm::vec3& max, const glm::vec3& color)
+{
+    DebugDraw_Box(glm::mat4(1.0f), min, max, color);
+}
+
+// Eixos X (vermelho), Y (verde) e Z (azul) do sistema de coordenadas definido
+// pela matriz "model", com comprimento "size" no espaço do modelo
+void DebugDraw_Frame(const glm::mat4& model, float size)
+{
+    glm::vec4 origin = model * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+    DebugDraw_Line(origin, model * glm::vec4(size, 0.0f, 0.0f, 1.0f), glm::vec3(1.0f, 0.0f, 0.0f));
+    DebugDraw_Line(origin, model * glm::vec4(0.0f, size, 0.0f, 1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    DebugDraw_Line(origin, model * glm::vec4(0.0f, 0.0f, size, 1.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+}
+
+// Desenha as linhas acumuladas no quadro e esvazia a lista. Com "draw" igual
+// a false (renderizador por software), as linhas são só descartadas.
+void DebugDraw_Flush(const glm::mat4& view, const glm::mat4& projection, bool draw)
+{
+    if (debug_vertices.empty())
+        return;
+    if (!draw)
+    {
+        debug_vertices.clear();
+        return;
+    }
+
+    GlDebug_PushGroup("DebugDraw");
+
+    // O buffer só cresce; o conteúdo antigo é descartado ("orphaning") para
+    // que a CPU não espere a GPU terminar o quadro anterior
+    GlState_BindBuffer(GL_ARRAY_BUFFER, debugVBO);
+    if (debug_vertices.size() > debugbuffer_capacity)
+        debugbuffer_capacity = debug_vertices.size() * 2;
+    glBufferData(GL_ARRAY_BUFFER, debugbuffer_capacity * sizeof(DebugVertex), NULL, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, debug_vertices.size() * sizeof(DebugVertex), debug_vertices.data());
+
+    // As linhas são desenhadas no mesmo estado de profundidade da cena
+    GlState_UseProgram(debugprogram_id);
+    GlState_UniformMatrix4fv(debugview_uniform, glm::value_ptr(view));
+    GlState_UniformMatrix4fv(debugprojection_uniform, glm::value_ptr(projection));
+    GlState_BindVertexArray(debugVAO);
+    GlState_DepthFunc(GL_LESS);
+    GlState_Disable(GL_BLEND);
+    GlState_LineWidth(2.0f);
+
+    glDrawArrays(GL_LINES, 0, (GLsizei)debug_vertices.size());
+    Profiler_CountDrawCalls(1);
+    GlDebug_PopGroup();
+
+    debug_vertices.clear();
+}
+#endif // NDEBUG
@@ -0,0 +1,151 @@
+// Resolução dinâmica (argumento "--dynres MS"): a cena 3D é desenhada em um
+// FBO, em uma fração da resolução da janela, e depois ampliada para a janela
+// com filtragem bilinear (glBlitFramebuffer). O texto continua sendo desenhado
+// direto na janela, em resolução nativa.
+//
+// A fração ("escala", a mesma nos dois eixos) é ajustada a cada quadro a
+// partir do tempo de GPU da cena medido pelo profiler, para que ele fique
+// perto do tempo alvo. O custo da cena é tratado como proporcional ao número
+// de pixels, isto é, ao quadrado da escala. Como as medidas chegam alguns
+// quadros atrasadas (PROFILER_GPU_LATENCY), a escala só anda uma fração do
+// caminho a cada quadro, para não oscilar.
+//
+// O FBO tem sempre o tamanho da janela; escalas menores usam só o canto
+// inferior esquerdo dele (glViewport), e mudar de escala não realoca nada.
+// A ampliação usa glBlitFramebuffer em vez de um shader de pós-processamento:
+// no llvmpipe, um passe de tela cheia amostrando uma textura custa mais do que
+// a cena inteira.
+#include <cstdio>
+#include <algorithm>
+#include <cmath>
+
+#include <glad/glad.h>
+
+#define DYNRES_MIN_SCALE 0.5f
+#define DYNRES_MAX_SCALE 1.0f
+
+// Fração da diferença para a escala desejada percorrida a cada quadro
+#define DYNRES_GAIN 0.1f
+
+// As dimensões usadas são múltiplos de DYNRES_ALIGN pixels, para que
+// variações mínimas da escala não mudem a imagem a cada quadro
+#define DYNRES_ALIGN 8
+
+bool dynres_enabled = false;
+double dynres_target_ms = 0.0;
+float dynres_scale = DYNRES_MAX_SCALE;
+int dynres_width = 0, dynres_height = 0;     // Tamanho da janela e do FBO
+int dynres_scene_width = 0, dynres_scene_height = 0;
+
+GLint dynres_output_fbo = 0; // Framebuffer da janela (ou do modo headless)
+GLuint dynres_fbo = 0;
+GLuint dynres_color_rb = 0;
+GLuint dynres_depth_rb = 0;
+
+// Estatísticas da escala, para DynRes_PrintSummary()
+double dynres_scale_sum = 0.0;
+float dynres_scale_min = DYNRES_MAX_SCALE;
+int dynres_frames = 0;
+
+static void DynRes_Allocate()
+{
+    glBindRenderbuffer(GL_RENDERBUFFER, dynres_color_rb);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, dynres_width, dynres_height);
+    glBindRenderbuffer(GL_RENDERBUFFER, dynres_depth_rb);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, dynres_width, dynres_height);
+}
+
+// Liga a resolução dinâmica, com tempo alvo de "target_ms" milissegundos para
+// a cena. Deve ser chamada com o framebuffer da janela ligado.
+bool DynRes_Init(double target_ms)
+{
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &dynres_output_fbo);
+    if (dynres_width <= 0 || dynres_height <= 0)
+    {
+        GLint viewport[4];
+        glGetIntegerv(GL_VIEWPORT, viewport);
+        dynres_width = viewport[2];
+        dynres_height = viewport[3];
+    }
+
+    glGenRenderbuffers(1, &dynres_color_rb);
+    glGenRenderbuffers(1, &dynres_depth_rb);
+    DynRes_Allocate();
+
+    glGenFramebuffers(1, &dynres_fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, dynres_fbo);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, dynres_color_rb);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, dynres_depth_rb);
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    glBindFramebuffer(GL_FRAMEBUFFER, dynres_output_fbo);
+    if (status != GL_FRAMEBUFFER_COMPLETE)
+    {
+        fprintf(stderr, "ERROR: dynamic resolution framebuffer is incomplete.\n");
+        return false;
+    }
+
+    dynres_target_ms = target_ms;
+    dynres_enabled = true;
+    return true;
+}
+
+// Novo tamanho da janela (chamada pelo callback de redimensionamento, mesmo
+// com a resolução dinâmica desligada)
+void DynRes_Resize(int width, int height)
+{
+    dynres_width = width;
+    dynres_height = height;
+    if (dynres_enabled && width > 0 && height > 0)
+        DynRes_Allocate();
+}
+
+// Ajusta a escala a partir do tempo de GPU da cena em um quadro recente, em
+// milissegundos (negativo se ainda não há medida)
+void DynRes_Update(double scene_gpu_ms)
+{
+    if (!dynres_enabled || scene_gpu_ms <= 0.0)
+        return;
+    float desired = dynres_scale * (float)std::sqrt(dynres_target_ms / scene_gpu_ms);
+    desired = std::min(std::max(desired, DYNRES_MIN_SCALE), DYNRES_MAX_SCALE);
+    dynres_scale += (desired - dynres_scale) * DYNRES_GAIN;
+}
+
+// Passa a desenhar no FBO, na escala atual
+void DynRes_BeginScene()
+{
+    if (!dynres_enabled)
+        return;
+
+    dynres_scene_width = std::min(dynres_width, std::max(DYNRES_ALIGN,
+        (int)(dynres_width * dynres_scale / DYNRES_ALIGN + 0.5f) * DYNRES_ALIGN));
+    dynres_scene_height = std::min(dynres_height, std::max(DYNRES_ALIGN,
+        (int)(dynres_height * dynres_scale / DYNRES_ALIGN + 0.5f) * DYNRES_ALIGN));
+
+    glBindFramebuffer(GL_FRAMEBUFFER, dynres_fbo);
+    glViewport(0, 0, dynres_scene_width, dynres_scene_height);
+
+    dynres_scale_sum += dynres_scale;
+    dynres_scale_min = std::min(dynres_scale_min, dynres_scale);
+    ++dynres_frames;
+}
+
+// Amplia a cena para o framebuffer da janela e volta a desenhar nele
+void DynRes_EndScene()
+{
+    if (!dynres_enabled)
+        return;
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, dynres_fbo);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, dynres_output_fbo);
+    glBlitFramebuffer(0, 0, dynres_scene_width, dynres_scene_height, 0, 0, dynres_width, dynres_height,
+                      GL_COLOR_BUFFER_BIT, GL_LINEAR);
+    glBindFramebuffer(GL_FRAMEBUFFER, dynres_output_fbo);
+    glViewport(0, 0, dynres_width, dynres_height);
+}
+
+void DynRes_PrintSummary()
+{
+    if (dynres_frames > 0)
+        printf("Dynamic resolution: target %.2f ms, scale avg %.3f, min %.3f, last %.3f\n",
+               dynres_target_ms, dynres_scale_sum / dynres_frames, dynres_scale_min, dynres_scale);
+}
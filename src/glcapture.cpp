@@ -0,0 +1,1309 @@
+// Captura e reprodução das chamadas OpenGL, para medir o custo do driver
+// sem a lógica do jogo (argumentos "--capture ARQUIVO" e "--glreplay
+// ARQUIVO").
+//
+// A captura troca os ponteiros de função carregados pela GLAD (glad_glClear,
+// ...) por funções que gravam a chamada, os argumentos e os dados enviados
+// (buffers, texturas, código dos shaders) antes de repassá-la ao driver. Sem
+// "--capture" os ponteiros não são alterados e não há custo nenhum. São
+// gravadas todas as chamadas da inicialização (criação de shaders, buffers,
+// VAOs e texturas) e as dos quadros escolhidos; os quadros anteriores não são
+// gravados, e por isso o cache de estado é esvaziado no primeiro quadro
+// gravado (veja main.cpp), para que ele envie de novo todo o estado que usa.
+// Só são embrulhadas as funções usadas para desenhar; consultas (glGet*),
+// as consultas de tempo do profiler e o FBO do modo headless ficam de fora.
+//
+// O arquivo é binário: um cabeçalho seguido de registros com o número da
+// função (16 bits), o instante da chamada em microssegundos desde o início da
+// captura (32 bits) e os argumentos, na ordem do protótipo. Identificadores
+// de objetos (buffers, VAOs, programas, ...) são gravados como retornados
+// pelo driver e trocados pelos novos na reprodução.
+//
+// A reprodução cria um contexto headless do tamanho gravado, executa a
+// inicialização e repete os quadros GLREPLAY_LOOPS vezes (mais uma volta de
+// aquecimento, descartada), medindo o tempo de cada chamada e de cada quadro
+// até o fim da renderização (glFinish()).
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <utility>
+#include <algorithm>
+
+#include <glad/glad.h>
+
+bool Headless_Init(int width, int height, int samples); // Funções definidas em headless.cpp
+void Headless_Terminate();
+bool Headless_SaveFrame(const char* filename);
+
+#define GLCAPTURE_VERSION 1
+#define GLREPLAY_LOOPS 10
+
+namespace
+{
+    const char GLCAPTURE_MAGIC[8] = "GLCAPT";
+
+    // Funções gravadas. Novas funções devem ser acrescentadas no fim, para
+    // que arquivos antigos continuem legíveis.
+    enum GlCall
+    {
+        GLCALL_FRAME_BEGIN,
+        GLCALL_FRAME_END,
+        GLCALL_CREATE_SHADER,
+        GLCALL_SHADER_SOURCE,
+        GLCALL_COMPILE_SHADER,
+        GLCALL_CREATE_PROGRAM,
+        GLCALL_ATTACH_SHADER,
+        GLCALL_LINK_PROGRAM,
+        GLCALL_DELETE_SHADER,
+        GLCALL_DELETE_PROGRAM,
+        GLCALL_USE_PROGRAM,
+        GLCALL_GET_UNIFORM_LOCATION,
+        GLCALL_UNIFORM_1I,
+        GLCALL_UNIFORM_4F,
+        GLCALL_UNIFORM_4FV,
+        GLCALL_UNIFORM_MATRIX_4FV,
+        GLCALL_GEN_TEXTURES,
+        GLCALL_GEN_SAMPLERS,
+        GLCALL_SAMPLER_PARAMETERI,
+        GLCALL_PIXEL_STOREI,
+        GLCALL_ACTIVE_TEXTURE,
+        GLCALL_BIND_TEXTURE,
+        GLCALL_TEX_IMAGE_2D,
+        GLCALL_GENERATE_MIPMAP,
+        GLCALL_BIND_SAMPLER,
+        GLCALL_GEN_VERTEX_ARRAYS,
+        GLCALL_BIND_VERTEX_ARRAY,
+        GLCALL_GEN_BUFFERS,
+        GLCALL_BIND_BUFFER,
+        GLCALL_BUFFER_DATA,
+        GLCALL_BUFFER_SUB_DATA,
+        GLCALL_VERTEX_ATTRIB_POINTER,
+        GLCALL_ENABLE_VERTEX_ATTRIB_ARRAY,
+        GLCALL_ENABLE,
+        GLCALL_DISABLE,
+        GLCALL_CULL_FACE,
+        GLCALL_FRONT_FACE,
+        GLCALL_BLEND_FUNC,
+        GLCALL_DEPTH_FUNC,
+        GLCALL_POLYGON_MODE,
+        GLCALL_LINE_WIDTH,
+        GLCALL_VIEWPORT,
+        GLCALL_CLEAR_COLOR,
+        GLCALL_CLEAR,
+        GLCALL_DRAW_ARRAYS,
+        GLCALL_DRAW_ELEMENTS,
+        GLCALL_DRAW_ELEMENTS_INSTANCED,
+        GLCALL_SAMPLER_PARAMETERF,
+        NUM_GLCALLS
+    };
+
+    const char* const glcall_names[NUM_GLCALLS] = {
+        "(frame begin)", "(frame end)", "glCreateShader", "glShaderSource", "glCompileShader",
+        "glCreateProgram", "glAttachShader", "glLinkProgram", "glDeleteShader", "glDeleteProgram",
+        "glUseProgram", "glGetUniformLocation", "glUniform1i", "glUniform4f", "glUniform4fv",
+        "glUniformMatrix4fv", "glGenTextures", "glGenSamplers", "glSamplerParameteri", "glPixelStorei",
+        "glActiveTexture", "glBindTexture", "glTexImage2D", "glGenerateMipmap", "glBindSampler",
+        "glGenVertexArrays", "glBindVertexArray", "glGenBuffers", "glBindBuffer", "glBufferData",
+        "glBufferSubData", "glVertexAttribPointer", "glEnableVertexAttribArray", "glEnable", "glDisable",
+        "glCullFace", "glFrontFace", "glBlendFunc", "glDepthFunc", "glPolygonMode",
+        "glLineWidth", "glViewport", "glClearColor", "glClear", "glDrawArrays",
+        "glDrawElements", "glDrawElementsInstanced", "glSamplerParameterf"
+    };
+
+    struct GlCaptureHeader
+    {
+        char magic[8];
+        uint32_t version;
+        int32_t width, height;    // Viewport no início da captura
+        int32_t first_frame;
+        int32_t num_frames;
+    };
+
+    enum GlCaptureState
+    {
+        CAPTURE_OFF,    // Sem captura, ou captura terminada
+        CAPTURE_INIT,   // Gravando a inicialização, antes do primeiro quadro
+        CAPTURE_SKIP,   // Quadros anteriores aos escolhidos: não gravados
+        CAPTURE_FRAMES  // Gravando os quadros escolhidos
+    };
+}
+
+FILE* glcapture_file = NULL;
+int glcapture_state = CAPTURE_OFF;
+int glcapture_first_frame = 0;
+int glcapture_num_frames = 0;
+int glcapture_frames_done = 0;
+unsigned long glcapture_calls = 0;
+unsigned long glcapture_bytes = 0;
+GLint glcapture_unpack_alignment = 4;
+std::chrono::steady_clock::time_point glcapture_epoch;
+
+// Registros ainda não escritos no arquivo; esvaziado a cada quadro
+std::vector<unsigned char> glcapture_buffer;
+
+// ----------------------------------------------------------------------------
+// Gravação
+
+static void GlCapture_PutBytes(const void* data, size_t size)
+{
+    const unsigned char* bytes = (const unsigned char*)data;
+    glcapture_buffer.insert(glcapture_buffer.end(), bytes, bytes + size);
+}
+
+template <typename T>
+static void GlCapture_Put(T value)
+{
+    GlCapture_PutBytes(&value, sizeof(T));
+}
+
+// Dados apontados por um argumento: tamanho (32 bits) e bytes. Um ponteiro
+// nulo é gravado como tamanho 0xFFFFFFFF.
+static void GlCapture_PutPayload(const void* data, size_t size)
+{
+    GlCapture_Put<uint32_t>(data ? (uint32_t)size : 0xFFFFFFFFu);
+    if (data)
+        GlCapture_PutBytes(data, size);
+}
+
+static void GlCapture_PutPointer(const void* pointer)
+{
+    GlCapture_Put<uint64_t>((uint64_t)(uintptr_t)pointer);
+}
+
+static void GlCapture_PutNames(GLsizei n, const GLuint* names)
+{
+    GlCapture_Put<int32_t>(n);
+    GlCapture_PutBytes(names, n * sizeof(GLuint));
+}
+
+// Começa o registro de uma chamada. Retorna false se ela não deve ser gravada.
+static bool GlCapture_Call(GlCall call)
+{
+    if (glcapture_state != CAPTURE_INIT && glcapture_state != CAPTURE_FRAMES)
+        return false;
+    uint32_t time = (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - glcapture_epoch).count();
+    GlCapture_Put<uint16_t>((uint16_t)call);
+    GlCapture_Put<uint32_t>(time);
+    ++glcapture_calls;
+    return true;
+}
+
+static void GlCapture_Flush()
+{
+    if (!glcapture_file || glcapture_buffer.empty())
+        return;
+    fwrite(glcapture_buffer.data(), 1, glcapture_buffer.size(), glcapture_file);
+    glcapture_bytes += glcapture_buffer.size();
+    glcapture_buffer.clear();
+}
+
+// Tamanho em bytes de uma imagem enviada por glTexImage2D(), com o alinhamento
+// das linhas definido por GL_UNPACK_ALIGNMENT
+static size_t GlCapture_ImageSize(GLsizei width, GLsizei height, GLenum format, GLenum type)
+{
+    size_t components = format == GL_RED ? 1 : format == GL_RG ? 2 : format == GL_RGB || format == GL_BGR ? 3 : 4;
+    size_t component_size = type == GL_FLOAT ? 4 : type == GL_UNSIGNED_SHORT || type == GL_HALF_FLOAT ? 2 : 1;
+    size_t row = width * components * component_size;
+    size_t stride = (row + glcapture_unpack_alignment - 1) / glcapture_unpack_alignment * glcapture_unpack_alignment;
+    return height > 0 ? stride * (height - 1) + row : 0;
+}
+
+// Ponteiros originais da GLAD, chamados pelas funções abaixo
+#define GLCAPTURE_REAL(name) static decltype(glad_##name) real_##name;
+GLCAPTURE_REAL(glCreateShader) GLCAPTURE_REAL(glShaderSource) GLCAPTURE_REAL(glCompileShader)
+GLCAPTURE_REAL(glCreateProgram) GLCAPTURE_REAL(glAttachShader) GLCAPTURE_REAL(glLinkProgram)
+GLCAPTURE_REAL(glDeleteShader) GLCAPTURE_REAL(glDeleteProgram) GLCAPTURE_REAL(glUseProgram)
+GLCAPTURE_REAL(glGetUniformLocation) GLCAPTURE_REAL(glUniform1i) GLCAPTURE_REAL(glUniform4f)
+GLCAPTURE_REAL(glUniform4fv) GLCAPTURE_REAL(glUniformMatrix4fv) GLCAPTURE_REAL(glGenTextures)
+GLCAPTURE_REAL(glGenSamplers) GLCAPTURE_REAL(glSamplerParameteri) GLCAPTURE_REAL(glPixelStorei)
+GLCAPTURE_REAL(glActiveTexture) GLCAPTURE_REAL(glBindTexture) GLCAPTURE_REAL(glTexImage2D)
+GLCAPTURE_REAL(glGenerateMipmap) GLCAPTURE_REAL(glBindSampler) GLCAPTURE_REAL(glGenVertexArrays)
+GLCAPTURE_REAL(glBindVertexArray) GLCAPTURE_REAL(glGenBuffers) GLCAPTURE_REAL(glBindBuffer)
+GLCAPTURE_REAL(glBufferData) GLCAPTURE_REAL(glBufferSubData) GLCAPTURE_REAL(glVertexAttribPointer)
+GLCAPTURE_REAL(glEnableVertexAttribArray) GLCAPTURE_REAL(glEnable) GLCAPTURE_REAL(glDisable)
+GLCAPTURE_REAL(glCullFace) GLCAPTURE_REAL(glFrontFace) GLCAPTURE_REAL(glBlendFunc)
+GLCAPTURE_REAL(glDepthFunc) GLCAPTURE_REAL(glPolygonMode) GLCAPTURE_REAL(glLineWidth)
+GLCAPTURE_REAL(glViewport) GLCAPTURE_REAL(glClearColor) GLCAPTURE_REAL(glClear)
+GLCAPTURE_REAL(glDrawArrays) GLCAPTURE_REAL(glDrawElements) GLCAPTURE_REAL(glDrawElementsInstanced)
+GLCAPTURE_REAL(glSamplerParameterf)
+#undef GLCAPTURE_REAL
+
+static GLuint APIENTRY capture_glCreateShader(GLenum type)
+{
+    GLuint shader = real_glCreateShader(type);
+    if (GlCapture_Call(GLCALL_CREATE_SHADER))
+    {
+        GlCapture_Put<uint32_t>(type);
+        GlCapture_Put<uint32_t>(shader);
+    }
+    return shader;
+}
+
+static void APIENTRY capture_glShaderSource(GLuint shader, GLsizei count, const GLchar* const* string, const GLint* length)
+{
+    if (GlCapture_Call(GLCALL_SHADER_SOURCE))
+    {
+        GlCapture_Put<uint32_t>(shader);
+        GlCapture_Put<int32_t>(count);
+        for (GLsizei i = 0; i < count; ++i)
+            GlCapture_PutPayload(string[i], length && length[i] >= 0 ? length[i] : strlen(string[i]));
+    }
+    real_glShaderSource(shader, count, string, length);
+}
+
+static void APIENTRY capture_glCompileShader(GLuint shader)
+{
+    if (GlCapture_Call(GLCALL_COMPILE_SHADER))
+        GlCapture_Put<uint32_t>(shader);
+    real_glCompileShader(shader);
+}
+
+static GLuint APIENTRY capture_glCreateProgram()
+{
+    GLuint program = real_glCreateProgram();
+    if (GlCapture_Call(GLCALL_CREATE_PROGRAM))
+        GlCapture_Put<uint32_t>(program);
+    return program;
+}
+
+static void APIENTRY capture_glAttachShader(GLuint program, GLuint shader)
+{
+    if (GlCapture_Call(GLCALL_ATTACH_SHADER))
+    {
+        GlCapture_Put<uint32_t>(program);
+        GlCapture_Put<uint32_t>(shader);
+    }
+    real_glAttachShader(program, shader);
+}
+
+static void APIENTRY capture_glLinkProgram(GLuint program)
+{
+    if (GlCapture_Call(GLCALL_LINK_PROGRAM))
+        GlCapture_Put<uint32_t>(program);
+    real_glLinkProgram(program);
+}
+
+static void APIENTRY capture_glDeleteShader(GLuint shader)
+{
+    if (GlCapture_Call(GLCALL_DELETE_SHADER))
+        GlCapture_Put<uint32_t>(shader);
+    real_glDeleteShader(shader);
+}
+
+static void APIENTRY capture_glDeleteProgram(GLuint program)
+{
+    if (GlCapture_Call(GLCALL_DELETE_PROGRAM))
+        GlCapture_Put<uint32_t>(program);
+    real_glDeleteProgram(program);
+}
+
+static void APIENTRY capture_glUseProgram(GLuint program)
+{
+    if (GlCapture_Call(GLCALL_USE_PROGRAM))
+        GlCapture_Put<uint32_t>(program);
+    real_glUseProgram(program);
+}
+
+static GLint APIENTRY capture_glGetUniformLocation(GLuint program, const GLchar* name)
+{
+    GLint location = real_glGetUniformLocation(program, name);
+    if (GlCapture_Call(GLCALL_GET_UNIFORM_LOCATION))
+    {
+        GlCapture_Put<uint32_t>(program);
+        GlCapture_PutPayload(name, strlen(name));
+        GlCapture_Put<int32_t>(location);
+    }
+    return location;
+}
+
+static void APIENTRY capture_glUniform1i(GLint location, GLint v0)
+{
+    if (GlCapture_Call(GLCALL_UNIFORM_1I))
+    {
+        GlCapture_Put<int32_t>(location);
+        GlCapture_Put<int32_t>(v0);
+    }
+    real_glUniform1i(location, v0);
+}
+
+static void APIENTRY capture_glUniform4f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2, GLfloat v3)
+{
+    if (GlCapture_Call(GLCALL_UNIFORM_4F))
+    {
+        const float v[4] = { v0, v1, v2, v3 };
+        GlCapture_Put<int32_t>(location);
+        GlCapture_PutBytes(v, sizeof(v));
+    }
+    real_glUniform4f(location, v0, v1, v2, v3);
+}
+
+static void APIENTRY capture_glUniform4fv(GLint location, GLsizei count, const GLfloat* value)
+{
+    if (GlCapture_Call(GLCALL_UNIFORM_4FV))
+    {
+        GlCapture_Put<int32_t>(location);
+        GlCapture_Put<int32_t>(count);
+        GlCapture_PutBytes(value, 4 * count * sizeof(GLfloat));
+    }
+    real_glUniform4fv(location, count, value);
+}
+
+static void APIENTRY capture_glUniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value)
+{
+    if (GlCapture_Call(GLCALL_UNIFORM_MATRIX_4FV))
+    {
+        GlCapture_Put<int32_t>(location);
+        GlCapture_Put<int32_t>(count);
+        GlCapture_Put<uint8_t>(transpose);
+        GlCapture_PutBytes(value, 16 * count * sizeof(GLfloat));
+    }
+    real_glUniformMatrix4fv(location, count, transpose, value);
+}
+
+static void APIENTRY capture_glGenTextures(GLsizei n, GLuint* textures)
+{
+    real_glGenTextures(n, textures);
+    if (GlCapture_Call(GLCALL_GEN_TEXTURES))
+        GlCapture_PutNames(n, textures);
+}
+
+static void APIENTRY capture_glGenSamplers(GLsizei n, GLuint* samplers)
+{
+    real_glGenSamplers(n, samplers);
+    if (GlCapture_Call(GLCALL_GEN_SAMPLERS))
+        GlCapture_PutNames(n, samplers);
+}
+
+static void APIENTRY capture_glSamplerParameteri(GLuint sampler, GLenum pname, GLint param)
+{
+    if (GlCapture_Call(GLCALL_SAMPLER_PARAMETERI))
+    {
+        GlCapture_Put<uint32_t>(sampler);
+        GlCapture_Put<uint32_t>(pname);
+        GlCapture_Put<int32_t>(param);
+    }
+    real_glSamplerParameteri(sampler, pname, param);
+}
+
+static void APIENTRY capture_glSamplerParameterf(GLuint sampler, GLenum pname, GLfloat param)
+{
+    if (GlCapture_Call(GLCALL_SAMPLER_PARAMETERF))
+    {
+        GlCapture_Put<uint32_t>(sampler);
+        GlCapture_Put<uint32_t>(pname);
+        GlCapture_Put<float>(param);
+    }
+    real_glSamplerParameterf(sampler, pname, param);
+}
+
+static void APIENTRY capture_glPixelStorei(GLenum pname, GLint param)
+{
+    if (pname == GL_UNPACK_ALIGNMENT)
+        glcapture_unpack_alignment = param;
+    if (GlCapture_Call(GLCALL_PIXEL_STOREI))
+    {
+        GlCapture_Put<uint32_t>(pname);
+        GlCapture_Put<int32_t>(param);
+    }
+    real_glPixelStorei(pname, param);
+}
+
+static void APIENTRY capture_glActiveTexture(GLenum texture)
+{
+    if (GlCapture_Call(GLCALL_ACTIVE_TEXTURE))
+        GlCapture_Put<uint32_t>(texture);
+    real_glActiveTexture(texture);
+}
+
+static void APIENTRY capture_glBindTexture(GLenum target, GLuint texture)
+{
+    if (GlCapture_Call(GLCALL_BIND_TEXTURE))
+    {
+        GlCapture_Put<uint32_t>(target);
+        GlCapture_Put<uint32_t>(texture);
+    }
+    real_glBindTexture(target, texture);
+}
+
+static void APIENTRY capture_glTexImage2D(GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height,
+                                          GLint border, GLenum format, GLenum type, const void* pixels)
+{
+    if (GlCapture_Call(GLCALL_TEX_IMAGE_2D))
+    {
+        GlCapture_Put<uint32_t>(target);
+        GlCapture_Put<int32_t>(level);
+        GlCapture_Put<int32_t>(internalformat);
+        GlCapture_Put<int32_t>(width);
+        GlCapture_Put<int32_t>(height);
+        GlCapture_Put<int32_t>(border);
+        GlCapture_Put<uint32_t>(format);
+        GlCapture_Put<uint32_t>(type);
+        GlCapture_PutPayload(pixels, GlCapture_ImageSize(width, height, format, type));
+    }
+    real_glTexImage2D(target, level, internalformat, width, height, border, format, type, pixels);
+}
+
+static void APIENTRY capture_glGenerateMipmap(GLenum target)
+{
+    if (GlCapture_Call(GLCALL_GENERATE_MIPMAP))
+        GlCapture_Put<uint32_t>(target);
+    real_glGenerateMipmap(target);
+}
+
+static void APIENTRY capture_glBindSampler(GLuint unit, GLuint sampler)
+{
+    if (GlCapture_Call(GLCALL_BIND_SAMPLER))
+    {
+        GlCapture_Put<uint32_t>(unit);
+        GlCapture_Put<uint32_t>(sampler);
+    }
+    real_glBindSampler(unit, sampler);
+}
+
+static void APIENTRY capture_glGenVertexArrays(GLsizei n, GLuint* arrays)
+{
+    real_glGenVertexArrays(n, arrays);
+    if (GlCapture_Call(GLCALL_GEN_VERTEX_ARRAYS))
+        GlCapture_PutNames(n, arrays);
+}
+
+static void APIENTRY capture_glBindVertexArray(GLuint array)
+{
+    if (GlCapture_Call(GLCALL_BIND_VERTEX_ARRAY))
+        GlCapture_Put<uint32_t>(array);
+    real_glBindVertexArray(array);
+}
+
+static void APIENTRY capture_glGenBuffers(GLsizei n, GLuint* buffers)
+{
+    real_glGenBuffers(n, buffers);
+    if (GlCapture_Call(GLCALL_GEN_BUFFERS))
+        GlCapture_PutNames(n, buffers);
+}
+
+static void APIENTRY capture_glBindBuffer(GLenum target, GLuint buffer)
+{
+    if (GlCapture_Call(GLCALL_BIND_BUFFER))
+    {
+        GlCapture_Put<uint32_t>(target);
+        GlCapture_Put<uint32_t>(buffer);
+    }
+    real_glBindBuffer(target, buffer);
+}
+
+static void APIENTRY capture_glBufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage)
+{
+    if (GlCapture_Call(GLCALL_BUFFER_DATA))
+    {
+        GlCapture_Put<uint32_t>(target);
+        GlCapture_Put<uint64_t>(size);
+        GlCapture_Put<uint32_t>(usage);
+        GlCapture_PutPayload(data, size);
+    }
+    real_glBufferData(target, size, data, usage);
+}
+
+static void APIENTRY capture_glBufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void* data)
+{
+    if (GlCapture_Call(GLCALL_BUFFER_SUB_DATA))
+    {
+        GlCapture_Put<uint32_t>(target);
+        GlCapture_Put<uint64_t>(offset);
+        GlCapture_PutPayload(data, size);
+    }
+    real_glBufferSubData(target, offset, size, data);
+}
+
+// "pointer" é um deslocamento dentro do GL_ARRAY_BUFFER ligado
+static void APIENTRY capture_glVertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized,
+                                                   GLsizei stride, const void* pointer)
+{
+    if (GlCapture_Call(GLCALL_VERTEX_ATTRIB_POINTER))
+    {
+        GlCapture_Put<uint32_t>(index);
+        GlCapture_Put<int32_t>(size);
+        GlCapture_Put<uint32_t>(type);
+        GlCapture_Put<uint8_t>(normalized);
+        GlCapture_Put<int32_t>(stride);
+        GlCapture_PutPointer(pointer);
+    }
+    real_glVertexAttribPointer(index, size, type, normalized, stride, pointer);
+}
+
+static void APIENTRY capture_glEnableVertexAttribArray(GLuint index)
+{
+    if (GlCapture_Call(GLCALL_ENABLE_VERTEX_ATTRIB_ARRAY))
+        GlCapture_Put<uint32_t>(index);
+    real_glEnableVertexAttribArray(index);
+}
+
+static void APIENTRY capture_glEnable(GLenum cap)
+{
+    if (GlCapture_Call(GLCALL_ENABLE))
+        GlCapture_Put<uint32_t>(cap);
+    real_glEnable(cap);
+}
+
+static void APIENTRY capture_glDisable(GLenum cap)
+{
+    if (GlCapture_Call(GLCALL_DISABLE))
+        GlCapture_Put<uint32_t>(cap);
+    real_glDisable(cap);
+}
+
+static void APIENTRY capture_glCullFace(GLenum mode)
+{
+    if (GlCapture_Call(GLCALL_CULL_FACE))
+        GlCapture_Put<uint32_t>(mode);
+    real_glCullFace(mode);
+}
+
+static void APIENTRY capture_glFrontFace(GLenum mode)
+{
+    if (GlCapture_Call(GLCALL_FRONT_FACE))
+        GlCapture_Put<uint32_t>(mode);
+    real_glFrontFace(mode);
+}
+
+static void APIENTRY capture_glBlendFunc(GLenum sfactor, GLenum dfactor)
+{
+    if (GlCapture_Call(GLCALL_BLEND_FUNC))
+    {
+        GlCapture_Put<uint32_t>(sfactor);
+        GlCapture_Put<uint32_t>(dfactor);
+    }
+    real_glBlendFunc(sfactor, dfactor);
+}
+
+static void APIENTRY capture_glDepthFunc(GLenum func)
+{
+    if (GlCapture_Call(GLCALL_DEPTH_FUNC))
+        GlCapture_Put<uint32_t>(func);
+    real_glDepthFunc(func);
+}
+
+static void APIENTRY capture_glPolygonMode(GLenum face, GLenum mode)
+{
+    if (GlCapture_Call(GLCALL_POLYGON_MODE))
+    {
+        GlCapture_Put<uint32_t>(face);
+        GlCapture_Put<uint32_t>(mode);
+    }
+    real_glPolygonMode(face, mode);
+}
+
+static void APIENTRY capture_glLineWidth(GLfloat width)
+{
+    if (GlCapture_Call(GLCALL_LINE_WIDTH))
+        GlCapture_Put<float>(width);
+    real_glLineWidth(width);
+}
+
+static void APIENTRY capture_glViewport(GLint x, GLint y, GLsizei width, GLsizei height)
+{
+    if (GlCapture_Call(GLCALL_VIEWPORT))
+    {
+        const int32_t v[4] = { x, y, width, height };
+        GlCapture_PutBytes(v, sizeof(v));
+    }
+    real_glViewport(x, y, width, height);
+}
+
+static void APIENTRY capture_glClearColor(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha)
+{
+    if (GlCapture_Call(GLCALL_CLEAR_COLOR))
+    {
+        const float v[4] = { red, green, blue, alpha };
+        GlCapture_PutBytes(v, sizeof(v));
+    }
+    real_glClearColor(red, green, blue, alpha);
+}
+
+static void APIENTRY capture_glClear(GLbitfield mask)
+{
+    if (GlCapture_Call(GLCALL_CLEAR))
+        GlCapture_Put<uint32_t>(mask);
+    real_glClear(mask);
+}
+
+static void APIENTRY capture_glDrawArrays(GLenum mode, GLint first, GLsizei count)
+{
+    if (GlCapture_Call(GLCALL_DRAW_ARRAYS))
+    {
+        GlCapture_Put<uint32_t>(mode);
+        GlCapture_Put<int32_t>(first);
+        GlCapture_Put<int32_t>(count);
+    }
+    real_glDrawArrays(mode, first, count);
+}
+
+// "indices" é um deslocamento dentro do GL_ELEMENT_ARRAY_BUFFER do VAO
+static void APIENTRY capture_glDrawElements(GLenum mode, GLsizei count, GLenum type, const void* indices)
+{
+    if (GlCapture_Call(GLCALL_DRAW_ELEMENTS))
+    {
+        GlCapture_Put<uint32_t>(mode);
+        GlCapture_Put<int32_t>(count);
+        GlCapture_Put<uint32_t>(type);
+        GlCapture_PutPointer(indices);
+    }
+    real_glDrawElements(mode, count, type, indices);
+}
+
+static void APIENTRY capture_glDrawElementsInstanced(GLenum mode, GLsizei count, GLenum type, const void* indices,
+                                                     GLsizei instancecount)
+{
+    if (GlCapture_Call(GLCALL_DRAW_ELEMENTS_INSTANCED))
+    {
+        GlCapture_Put<uint32_t>(mode);
+        GlCapture_Put<int32_t>(count);
+        GlCapture_Put<uint32_t>(type);
+        GlCapture_PutPointer(indices);
+        GlCapture_Put<int32_t>(instancecount);
+    }
+    real_glDrawElementsInstanced(mode, count, type, indices, instancecount);
+}
+
+// Troca (install = true) ou restaura os ponteiros da GLAD
+static void GlCapture_Install(bool install)
+{
+#define GLCAPTURE_WRAP(name) \
+    if (install) { real_##name = glad_##name; glad_##name = capture_##name; } \
+    else glad_##name = real_##name;
+    GLCAPTURE_WRAP(glCreateShader) GLCAPTURE_WRAP(glShaderSource) GLCAPTURE_WRAP(glCompileShader)
+    GLCAPTURE_WRAP(glCreateProgram) GLCAPTURE_WRAP(glAttachShader) GLCAPTURE_WRAP(glLinkProgram)
+    GLCAPTURE_WRAP(glDeleteShader) GLCAPTURE_WRAP(glDeleteProgram) GLCAPTURE_WRAP(glUseProgram)
+    GLCAPTURE_WRAP(glGetUniformLocation) GLCAPTURE_WRAP(glUniform1i) GLCAPTURE_WRAP(glUniform4f)
+    GLCAPTURE_WRAP(glUniform4fv) GLCAPTURE_WRAP(glUniformMatrix4fv) GLCAPTURE_WRAP(glGenTextures)
+    GLCAPTURE_WRAP(glGenSamplers) GLCAPTURE_WRAP(glSamplerParameteri) GLCAPTURE_WRAP(glPixelStorei)
+    GLCAPTURE_WRAP(glActiveTexture) GLCAPTURE_WRAP(glBindTexture) GLCAPTURE_WRAP(glTexImage2D)
+    GLCAPTURE_WRAP(glGenerateMipmap) GLCAPTURE_WRAP(glBindSampler) GLCAPTURE_WRAP(glGenVertexArrays)
+    GLCAPTURE_WRAP(glBindVertexArray) GLCAPTURE_WRAP(glGenBuffers) GLCAPTURE_WRAP(glBindBuffer)
+    GLCAPTURE_WRAP(glBufferData) GLCAPTURE_WRAP(glBufferSubData) GLCAPTURE_WRAP(glVertexAttribPointer)
+    GLCAPTURE_WRAP(glEnableVertexAttribArray) GLCAPTURE_WRAP(glEnable) GLCAPTURE_WRAP(glDisable)
+    GLCAPTURE_WRAP(glCullFace) GLCAPTURE_WRAP(glFrontFace) GLCAPTURE_WRAP(glBlendFunc)
+    GLCAPTURE_WRAP(glDepthFunc) GLCAPTURE_WRAP(glPolygonMode) GLCAPTURE_WRAP(glLineWidth)
+    GLCAPTURE_WRAP(glViewport) GLCAPTURE_WRAP(glClearColor) GLCAPTURE_WRAP(glClear)
+    GLCAPTURE_WRAP(glDrawArrays) GLCAPTURE_WRAP(glDrawElements) GLCAPTURE_WRAP(glDrawElementsInstanced)
+    GLCAPTURE_WRAP(glSamplerParameterf)
+#undef GLCAPTURE_WRAP
+}
+
+// Começa a captura. Deve ser chamada logo depois de carregar as funções com a
+// GLAD, antes de qualquer outra chamada OpenGL da inicialização. Serão
+// gravados "num_frames" quadros a partir do quadro "first_frame".
+bool GlCapture_Open(const char* filename, int first_frame, int num_frames)
+{
+    glcapture_file = fopen(filename, "wb");
+    if (!glcapture_file)
+    {
+        fprintf(stderr, "ERROR: cannot open \"%s\" for writing.\n", filename);
+        return false;
+    }
+
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+
+    GlCaptureHeader header;
+    memcpy(header.magic, GLCAPTURE_MAGIC, sizeof(header.magic));
+    header.version = GLCAPTURE_VERSION;
+    header.width = viewport[2];
+    header.height = viewport[3];
+    header.first_frame = first_frame;
+    header.num_frames = num_frames;
+    fwrite(&header, sizeof(header), 1, glcapture_file);
+
+    glcapture_first_frame = first_frame;
+    glcapture_num_frames = num_frames;
+    glcapture_epoch = std::chrono::steady_clock::now();
+    glcapture_state = CAPTURE_INIT;
+    GlCapture_Install(true);
+    return true;
+}
+
+// Termina a captura (antes do fim dos quadros, se o programa for fechado)
+void GlCapture_Close()
+{
+    if (glcapture_state == CAPTURE_OFF)
+        return;
+    GlCapture_Flush();
+    fclose(glcapture_file);
+    glcapture_file = NULL;
+    GlCapture_Install(false);
+    glcapture_state = CAPTURE_OFF;
+    printf("GL capture: %d frames, %lu calls, %lu bytes\n", glcapture_frames_done, glcapture_calls,
+           glcapture_bytes + (unsigned long)sizeof(GlCaptureHeader));
+}
+
+// Chamada no início de cada quadro. Retorna true no primeiro quadro gravado,
+// quando todo o estado usado no quadro deve ser enviado de novo.
+bool GlCapture_BeginFrame(int frame)
+{
+    if (glcapture_state == CAPTURE_OFF)
+        return false;
+
+    if (glcapture_state == CAPTURE_INIT)
+    {
+        GlCapture_Flush();
+        glcapture_state = CAPTURE_SKIP;
+    }
+    if (frame < glcapture_first_frame)
+        return false;
+
+    bool first = glcapture_state == CAPTURE_SKIP;
+    glcapture_state = CAPTURE_FRAMES;
+    GlCapture_Call(GLCALL_FRAME_BEGIN);
+    GlCapture_Put<int32_t>(frame);
+    return first;
+}
+
+// Chamada quando todos os comandos do quadro já foram enviados
+void GlCapture_EndFrame()
+{
+    if (glcapture_state != CAPTURE_FRAMES)
+        return;
+    GlCapture_Call(GLCALL_FRAME_END);
+    GlCapture_Flush();
+    if (++glcapture_frames_done >= glcapture_num_frames)
+        GlCapture_Close();
+}
+
+// ----------------------------------------------------------------------------
+// Reprodução
+
+namespace
+{
+    // Leitura dos registros gravados. Uma leitura além do fim dos dados (captura
+    // truncada ou corrompida) lança std::runtime_error, tratada em
+    // GlCapture_Replay() antes que o valor chegue ao driver.
+    struct GlReader
+    {
+        const unsigned char* p;
+        const unsigned char* end;
+
+        void Require(size_t size)
+        {
+            if (size > (size_t)(end - p))
+                throw std::runtime_error("truncated GL capture");
+        }
+
+        template <typename T>
+        T Get()
+        {
+            Require(sizeof(T));
+            T value;
+            memcpy(&value, p, sizeof(T));
+            p += sizeof(T);
+            return value;
+        }
+
+        const void* GetBytes(size_t size)
+        {
+            Require(size);
+            const void* data = p;
+            p += size;
+            return data;
+        }
+
+        // Número de elementos que vêm a seguir, cada um com pelo menos
+        // "element_size" bytes
+        GLsizei GetCount(size_t element_size)
+        {
+            int32_t n = Get<int32_t>();
+            if (n < 0)
+                throw std::runtime_error("negative count in GL capture");
+            Require(n * element_size);
+            return n;
+        }
+
+        // Retorna NULL para um ponteiro nulo gravado
+        const void* GetPayload(uint32_t* size = NULL)
+        {
+            uint32_t n = Get<uint32_t>();
+            if (size)
+                *size = n == 0xFFFFFFFFu ? 0 : n;
+            return n == 0xFFFFFFFFu ? NULL : GetBytes(n);
+        }
+    };
+
+    typedef std::map<GLuint, GLuint> GlNameMap;
+
+    // Identificadores gravados -> identificadores criados na reprodução
+    struct GlReplayNames
+    {
+        GlNameMap shaders, programs, textures, samplers, vertex_arrays, buffers;
+        std::map<std::pair<GLuint, GLint>, GLint> locations; // (programa, localização) gravados
+        GLuint program;                                      // Programa atual, gravado
+    };
+
+    GLuint GlReplay_Map(const GlNameMap& names, GLuint name)
+    {
+        GlNameMap::const_iterator it = names.find(name);
+        return it == names.end() ? name : it->second;
+    }
+
+    GLint GlReplay_Location(const GlReplayNames& names, GLint location)
+    {
+        std::map<std::pair<GLuint, GLint>, GLint>::const_iterator it = names.locations.find(std::make_pair(names.program, location));
+        return it == names.locations.end() ? location : it->second;
+    }
+
+    void GlReplay_Names(GlReader& r, GlNameMap& names, void (APIENTRY *gen)(GLsizei, GLuint*))
+    {
+        GLsizei n = r.GetCount(sizeof(uint32_t));
+        std::vector<GLuint> created(n);
+        gen(n, created.data());
+        for (GLsizei i = 0; i < n; ++i)
+            names[r.Get<uint32_t>()] = created[i];
+    }
+
+    // Executa a chamada "call", cujo cabeçalho já foi lido
+    void GlReplay_Call(GlReader& r, GlReplayNames& names, GlCall call)
+    {
+        switch (call)
+        {
+        case GLCALL_FRAME_BEGIN:
+            r.Get<int32_t>();
+            break;
+        case GLCALL_FRAME_END:
+            break;
+        case GLCALL_CREATE_SHADER:
+        {
+            GLenum type = r.Get<uint32_t>();
+            names.shaders[r.Get<uint32_t>()] = glCreateShader(type);
+            break;
+        }
+        case GLCALL_SHADER_SOURCE:
+        {
+            GLuint shader = GlReplay_Map(names.shaders, r.Get<uint32_t>());
+            GLsizei count = r.GetCount(sizeof(uint32_t)); // Tamanho de cada string
+            std::vector<const GLchar*> strings(count);
+            std::vector<GLint> lengths(count);
+            for (GLsizei i = 0; i < count; ++i)
+            {
+                uint32_t size;
+                strings[i] = (const GLchar*)r.GetPayload(&size);
+                lengths[i] = (GLint)size;
+            }
+            glShaderSource(shader, count, strings.data(), lengths.data());
+            break;
+        }
+        case GLCALL_COMPILE_SHADER:
+            glCompileShader(GlReplay_Map(names.shaders, r.Get<uint32_t>()));
+            break;
+        case GLCALL_CREATE_PROGRAM:
+            names.programs[r.Get<uint32_t>()] = glCreateProgram();
+            break;
+        case GLCALL_ATTACH_SHADER:
+        {
+            GLuint program = GlReplay_Map(names.programs, r.Get<uint32_t>());
+            glAttachShader(program, GlReplay_Map(names.shaders, r.Get<uint32_t>()));
+            break;
+        }
+        case GLCALL_LINK_PROGRAM:
+            glLinkProgram(GlReplay_Map(names.programs, r.Get<uint32_t>()));
+            break;
+        case GLCALL_DELETE_SHADER:
+            glDeleteShader(GlReplay_Map(names.shaders, r.Get<uint32_t>()));
+            break;
+        case GLCALL_DELETE_PROGRAM:
+            glDeleteProgram(GlReplay_Map(names.programs, r.Get<uint32_t>()));
+            break;
+        case GLCALL_USE_PROGRAM:
+            names.program = r.Get<uint32_t>();
+            glUseProgram(GlReplay_Map(names.programs, names.program));
+            break;
+        case GLCALL_GET_UNIFORM_LOCATION:
+        {
+            GLuint program = r.Get<uint32_t>();
+            uint32_t size;
+            const char* name = (const char*)r.GetPayload(&size);
+            GLint location = glGetUniformLocation(GlReplay_Map(names.programs, program), std::string(name, size).c_str());
+            names.locations[std::make_pair(program, r.Get<int32_t>())] = location;
+            break;
+        }
+        case GLCALL_UNIFORM_1I:
+        {
+            GLint location = GlReplay_Location(names, r.Get<int32_t>());
+            glUniform1i(location, r.Get<int32_t>());
+            break;
+        }
+        case GLCALL_UNIFORM_4F:
+        {
+            GLint location = GlReplay_Location(names, r.Get<int32_t>());
+            const float* v = (const float*)r.GetBytes(4 * sizeof(float));
+            glUniform4f(location, v[0], v[1], v[2], v[3]);
+            break;
+        }
+        case GLCALL_UNIFORM_4FV:
+        {
+            GLint location = GlReplay_Location(names, r.Get<int32_t>());
+            GLsizei count = r.Get<int32_t>();
+            glUniform4fv(location, count, (const GLfloat*)r.GetBytes(4 * count * sizeof(GLfloat)));
+            break;
+        }
+        case GLCALL_UNIFORM_MATRIX_4FV:
+        {
+            GLint location = GlReplay_Location(names, r.Get<int32_t>());
+            GLsizei count = r.Get<int32_t>();
+            GLboolean transpose = r.Get<uint8_t>();
+            glUniformMatrix4fv(location, count, transpose, (const GLfloat*)r.GetBytes(16 * count * sizeof(GLfloat)));
+            break;
+        }
+        case GLCALL_GEN_TEXTURES:
+            GlReplay_Names(r, names.textures, glGenTextures);
+            break;
+        case GLCALL_GEN_SAMPLERS:
+            GlReplay_Names(r, names.samplers, glGenSamplers);
+            break;
+        case GLCALL_SAMPLER_PARAMETERI:
+        {
+            GLuint sampler = GlReplay_Map(names.samplers, r.Get<uint32_t>());
+            GLenum pname = r.Get<uint32_t>();
+            glSamplerParameteri(sampler, pname, r.Get<int32_t>());
+            break;
+        }
+        case GLCALL_SAMPLER_PARAMETERF:
+        {
+            GLuint sampler = GlReplay_Map(names.samplers, r.Get<uint32_t>());
+            GLenum pname = r.Get<uint32_t>();
+            glSamplerParameterf(sampler, pname, r.Get<float>());
+            break;
+        }
+        case GLCALL_PIXEL_STOREI:
+        {
+            GLenum pname = r.Get<uint32_t>();
+            glPixelStorei(pname, r.Get<int32_t>());
+            break;
+        }
+        case GLCALL_ACTIVE_TEXTURE:
+            glActiveTexture(r.Get<uint32_t>());
+            break;
+        case GLCALL_BIND_TEXTURE:
+        {
+            GLenum target = r.Get<uint32_t>();
+            glBindTexture(target, GlReplay_Map(names.textures, r.Get<uint32_t>()));
+            break;
+        }
+        case GLCALL_TEX_IMAGE_2D:
+        {
+            GLenum target = r.Get<uint32_t>();
+            GLint level = r.Get<int32_t>();
+            GLint internalformat = r.Get<int32_t>();
+            GLsizei width = r.Get<int32_t>();
+            GLsizei height = r.Get<int32_t>();
+            GLint border = r.Get<int32_t>();
+            GLenum format = r.Get<uint32_t>();
+            GLenum type = r.Get<uint32_t>();
+            glTexImage2D(target, level, internalformat, width, height, border, format, type, r.GetPayload());
+            break;
+        }
+        case GLCALL_GENERATE_MIPMAP:
+            glGenerateMipmap(r.Get<uint32_t>());
+            break;
+        case GLCALL_BIND_SAMPLER:
+        {
+            GLuint unit = r.Get<uint32_t>();
+            glBindSampler(unit, GlReplay_Map(names.samplers, r.Get<uint32_t>()));
+            break;
+        }
+        case GLCALL_GEN_VERTEX_ARRAYS:
+            GlReplay_Names(r, names.vertex_arrays, glGenVertexArrays);
+            break;
+        case GLCALL_BIND_VERTEX_ARRAY:
+            glBindVertexArray(GlReplay_Map(names.vertex_arrays, r.Get<uint32_t>()));
+            break;
+        case GLCALL_GEN_BUFFERS:
+            GlReplay_Names(r, names.buffers, glGenBuffers);
+            break;
+        case GLCALL_BIND_BUFFER:
+        {
+            GLenum target = r.Get<uint32_t>();
+            glBindBuffer(target, GlReplay_Map(names.buffers, r.Get<uint32_t>()));
+            break;
+        }
+        case GLCALL_BUFFER_DATA:
+        {
+            GLenum target = r.Get<uint32_t>();
+            GLsizeiptr size = (GLsizeiptr)r.Get<uint64_t>();
+            GLenum usage = r.Get<uint32_t>();
+            uint32_t payload_size;
+            const void* data = r.GetPayload(&payload_size);
+            if (data && (GLsizeiptr)payload_size != size)
+                throw std::runtime_error("glBufferData size does not match its data");
+            glBufferData(target, size, data, usage);
+            break;
+        }
+        case GLCALL_BUFFER_SUB_DATA:
+        {
+            GLenum target = r.Get<uint32_t>();
+            GLintptr offset = (GLintptr)r.Get<uint64_t>();
+            uint32_t size;
+            const void* data = r.GetPayload(&size);
+            glBufferSubData(target, offset, size, data);
+            break;
+        }
+        case GLCALL_VERTEX_ATTRIB_POINTER:
+        {
+            GLuint index = r.Get<uint32_t>();
+            GLint size = r.Get<int32_t>();
+            GLenum type = r.Get<uint32_t>();
+            GLboolean normalized = r.Get<uint8_t>();
+            GLsizei stride = r.Get<int32_t>();
+            glVertexAttribPointer(index, size, type, normalized, stride, (const void*)(uintptr_t)r.Get<uint64_t>());
+            break;
+        }
+        case GLCALL_ENABLE_VERTEX_ATTRIB_ARRAY:
+            glEnableVertexAttribArray(r.Get<uint32_t>());
+            break;
+        case GLCALL_ENABLE:
+            glEnable(r.Get<uint32_t>());
+            break;
+        case GLCALL_DISABLE:
+            glDisable(r.Get<uint32_t>());
+            break;
+        case GLCALL_CULL_FACE:
+            glCullFace(r.Get<uint32_t>());
+            break;
+        case GLCALL_FRONT_FACE:
+            glFrontFace(r.Get<uint32_t>());
+            break;
+        case GLCALL_BLEND_FUNC:
+        {
+            GLenum sfactor = r.Get<uint32_t>();
+            glBlendFunc(sfactor, r.Get<uint32_t>());
+            break;
+        }
+        case GLCALL_DEPTH_FUNC:
+            glDepthFunc(r.Get<uint32_t>());
+            break;
+        case GLCALL_POLYGON_MODE:
+        {
+            GLenum face = r.Get<uint32_t>();
+            glPolygonMode(face, r.Get<uint32_t>());
+            break;
+        }
+        case GLCALL_LINE_WIDTH:
+            glLineWidth(r.Get<float>());
+            break;
+        case GLCALL_VIEWPORT:
+        {
+            const int32_t* v = (const int32_t*)r.GetBytes(4 * sizeof(int32_t));
+            glViewport(v[0], v[1], v[2], v[3]);
+            break;
+        }
+        case GLCALL_CLEAR_COLOR:
+        {
+            const float* v = (const float*)r.GetBytes(4 * sizeof(float));
+            glClearColor(v[0], v[1], v[2], v[3]);
+            break;
+        }
+        case GLCALL_CLEAR:
+            glClear(r.Get<uint32_t>());
+            break;
+        case GLCALL_DRAW_ARRAYS:
+        {
+            GLenum mode = r.Get<uint32_t>();
+            GLint first = r.Get<int32_t>();
+            glDrawArrays(mode, first, r.Get<int32_t>());
+            break;
+        }
+        case GLCALL_DRAW_ELEMENTS:
+        {
+            GLenum mode = r.Get<uint32_t>();
+            GLsizei count = r.Get<int32_t>();
+            GLenum type = r.Get<uint32_t>();
+            glDrawElements(mode, count, type, (const void*)(uintptr_t)r.Get<uint64_t>());
+            break;
+        }
+        case GLCALL_DRAW_ELEMENTS_INSTANCED:
+        {
+            GLenum mode = r.Get<uint32_t>();
+            GLsizei count = r.Get<int32_t>();
+            GLenum type = r.Get<uint32_t>();
+            const void* indices = (const void*)(uintptr_t)r.Get<uint64_t>();
+            glDrawElementsInstanced(mode, count, type, indices, r.Get<int32_t>());
+            break;
+        }
+        default:
+            break;
+        }
+    }
+
+    struct GlCallStats
+    {
+        unsigned long calls;
+        double seconds;
+    };
+
+    bool GlReplay_CompareStats(const std::pair<int, GlCallStats>& a, const std::pair<int, GlCallStats>& b)
+    {
+        return a.second.seconds > b.second.seconds;
+    }
+}
+
+// Modo "--glreplay ARQUIVO": reproduz uma captura e mostra o tempo por quadro
+// e por função. Com "dump_dir", grava as imagens dos quadros da primeira volta,
+// numeradas como na captura.
+int GlCapture_Replay(const char* filename, const char* dump_dir)
+{
+    FILE* file = fopen(filename, "rb");
+    if (!file)
+    {
+        fprintf(stderr, "ERROR: cannot open \"%s\".\n", filename);
+        return 1;
+    }
+    std::vector<unsigned char> data;
+    unsigned char chunk[65536];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), file)) > 0)
+        data.insert(data.end(), chunk, chunk + n);
+    fclose(file);
+
+    GlCaptureHeader header;
+    if (data.size() < sizeof(header) || (memcpy(&header, data.data(), sizeof(header)),
+        memcmp(header.magic, GLCAPTURE_MAGIC, sizeof(header.magic)) != 0 || header.version != GLCAPTURE_VERSION))
+    {
+        fprintf(stderr, "ERROR: \"%s\" is not a GL capture (version %d).\n", filename, GLCAPTURE_VERSION);
+        return 1;
+    }
+
+    if (!Headless_Init(header.width, header.height, 0))
+        return 1;
+
+    GlReader r = { data.data() + sizeof(header), data.data() + data.size() };
+    GlReplayNames names;
+    names.program = 0;
+
+    std::vector<GlCallStats> stats(NUM_GLCALLS);
+    std::vector<double> frame_times;
+    int num_frames = 0;
+
+    // Uma captura truncada ou corrompida interrompe a leitura (GlReader)
+    try
+    {
+        // Inicialização: tudo até o primeiro quadro
+        const unsigned char* frames = NULL;
+        while (r.p < r.end)
+        {
+            const unsigned char* record = r.p;
+            GlCall call = (GlCall)r.Get<uint16_t>();
+            r.Get<uint32_t>();
+            if (call >= NUM_GLCALLS)
+            {
+                fprintf(stderr, "ERROR: unknown call %d in \"%s\".\n", (int)call, filename);
+                Headless_Terminate();
+                return 1;
+            }
+            if (call == GLCALL_FRAME_BEGIN)
+            {
+                frames = record;
+                break;
+            }
+            GlReplay_Call(r, names, call);
+        }
+        glFinish();
+        if (!frames)
+        {
+            fprintf(stderr, "ERROR: \"%s\" has no frames.\n", filename);
+            Headless_Terminate();
+            return 1;
+        }
+
+        // A volta 0 aquece o driver (compilação dos shaders, alocações) e não
+        // entra nas estatísticas
+        for (int loop = 0; loop <= GLREPLAY_LOOPS; ++loop)
+        {
+            r.p = frames;
+            int frame = 0, captured_frame = 0;
+            std::chrono::steady_clock::time_point frame_start;
+            while (r.p < r.end)
+            {
+                GlCall call = (GlCall)r.Get<uint16_t>();
+                r.Get<uint32_t>();
+                if (call >= NUM_GLCALLS)
+                {
+                    fprintf(stderr, "ERROR: unknown call %d in \"%s\".\n", (int)call, filename);
+                    Headless_Terminate();
+                    return 1;
+                }
+
+                std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+                if (call == GLCALL_FRAME_BEGIN)
+                {
+                    frame_start = start;
+                    captured_frame = r.Get<int32_t>();
+                    continue;
+                }
+                GlReplay_Call(r, names, call);
+                if (call == GLCALL_FRAME_END)
+                {
+                    glFinish();
+                    if (loop > 0)
+                        frame_times.push_back(std::chrono::duration<double>(std::chrono::steady_clock::now() - frame_start).count());
+                    if (loop == 0 && dump_dir)
+                    {
+                        char filename[512];
+                        snprintf(filename, sizeof(filename), "%s/replay_%05d.png", dump_dir, captured_frame);
+                        Headless_SaveFrame(filename);
+                    }
+                    ++frame;
+                    continue;
+                }
+                if (loop > 0)
+                {
+                    stats[call].calls += 1;
+                    stats[call].seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                }
+            }
+            num_frames = frame;
+        }
+    }
+    catch (const std::runtime_error&)
+    {
+        fprintf(stderr, "ERROR: \"%s\" is truncated or corrupt.\n", filename);
+        Headless_Terminate();
+        return 1;
+    }
+
+    if (frame_times.empty())
+    {
+        fprintf(stderr, "ERROR: \"%s\" has no complete frames.\n", filename);
+        Headless_Terminate();
+        return 1;
+    }
+
+    double sum = 0.0;
+    for (size_t i = 0; i < frame_times.size(); ++i)
+        sum += frame_times[i];
+    std::sort(frame_times.begin(), frame_times.end());
+    printf("GL replay: %d frames x %d loops, avg %.3f ms, min %.3f ms, median %.3f ms, max %.3f ms\n",
+           num_frames, GLREPLAY_LOOPS, 1000.0 * sum / frame_times.size(), 1000.0 * frame_times.front(),
+           1000.0 * frame_times[frame_times.size() / 2], 1000.0 * frame_times.back());
+
+    // Tempo de CPU de cada função (envio ao driver, sem esperar a GPU),
+    // da mais cara para a mais barata
+    std::vector< std::pair<int, GlCallStats> > sorted;
+    for (int c = 0; c < NUM_GLCALLS; ++c)
+    {
+        if (stats[c].calls > 0)
+            sorted.push_back(std::make_pair(c, stats[c]));
+    }
+    std::sort(sorted.begin(), sorted.end(), GlReplay_CompareStats);
+    printf("%-28s %12s %14s %12s\n", "call", "calls/frame", "ms/frame", "ns/call");
+    for (size_t i = 0; i < sorted.size(); ++i)
+    {
+        const GlCallStats& s = sorted[i].second;
+        printf("%-28s %12.1f %14.4f %12.1f\n", glcall_names[sorted[i].first], (double)s.calls / frame_times.size(),
+               1000.0 * s.seconds / frame_times.size(), 1e9 * s.seconds / s.calls);
+    }
+
+    Headless_Terminate();
+    return 0;
+}
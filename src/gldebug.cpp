@@ -0,0 +1,175 @@
+// Mensagens de depuração do OpenGL (GL_KHR_debug): o driver informa erros,
+// usos indevidos e avisos de desempenho por um callback, sem que a CPU precise
+// parar e esperar a GPU a cada glGetError(). Os objetos principais recebem
+// nomes (glObjectLabel) e cada passo do quadro fica dentro de um grupo
+// (glPushDebugGroup), o que aparece em ferramentas como RenderDoc e apitrace.
+//
+// A GLAD deste projeto só carrega o OpenGL 3.3 core, então as funções da
+// extensão são carregadas aqui. Sem a extensão, GlDebug_Active() retorna false
+// e glCheckError() (em utils.h) volta a consultar glGetError().
+//
+// Nas compilações de release (NDEBUG) este arquivo fica vazio e as funções
+// declaradas em main.cpp são trocadas por funções vazias.
+#ifndef NDEBUG
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <string>
+
+#include <glad/glad.h>
+
+// Constantes e protótipos de GL_KHR_debug (núcleo do OpenGL 4.3); o tipo
+// GLDEBUGPROC já vem de glad.h
+#define GL_DEBUG_OUTPUT                   0x92E0
+#define GL_DEBUG_SOURCE_API               0x8246
+#define GL_DEBUG_SOURCE_WINDOW_SYSTEM     0x8247
+#define GL_DEBUG_SOURCE_SHADER_COMPILER   0x8248
+#define GL_DEBUG_SOURCE_THIRD_PARTY       0x8249
+#define GL_DEBUG_SOURCE_APPLICATION       0x824A
+#define GL_DEBUG_TYPE_ERROR               0x824C
+#define GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR 0x824D
+#define GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR  0x824E
+#define GL_DEBUG_TYPE_PORTABILITY         0x824F
+#define GL_DEBUG_TYPE_PERFORMANCE         0x8250
+#define GL_DEBUG_SEVERITY_HIGH            0x9146
+#define GL_DEBUG_SEVERITY_MEDIUM          0x9147
+#define GL_DEBUG_SEVERITY_LOW             0x9148
+#define GL_DEBUG_SEVERITY_NOTIFICATION    0x826B
+
+typedef void (APIENTRY *PFNGLDEBUGMESSAGECALLBACKPROC)(GLDEBUGPROC callback, const void* user);
+typedef void (APIENTRY *PFNGLDEBUGMESSAGECONTROLPROC)(GLenum source, GLenum type, GLenum severity, GLsizei count,
+                                                      const GLuint* ids, GLboolean enabled);
+typedef void (APIENTRY *PFNGLOBJECTLABELPROC)(GLenum identifier, GLuint name, GLsizei length, const GLchar* label);
+typedef void (APIENTRY *PFNGLPUSHDEBUGGROUPPROC)(GLenum source, GLuint id, GLsizei length, const GLchar* message);
+typedef void (APIENTRY *PFNGLPOPDEBUGGROUPPROC)();
+
+// Depois de GLDEBUG_MAX_REPEATS mensagens iguais, as seguintes são descartadas
+// (um erro repetido a cada quadro encheria o terminal). O texto é comparado
+// porque drivers como o Mesa usam o mesmo identificador para todos os erros.
+#define GLDEBUG_MAX_REPEATS 10
+
+PFNGLDEBUGMESSAGECALLBACKPROC gldebug_DebugMessageCallback = NULL;
+PFNGLDEBUGMESSAGECONTROLPROC gldebug_DebugMessageControl = NULL;
+PFNGLOBJECTLABELPROC gldebug_ObjectLabel = NULL;
+PFNGLPUSHDEBUGGROUPPROC gldebug_PushDebugGroup = NULL;
+PFNGLPOPDEBUGGROUPPROC gldebug_PopDebugGroup = NULL;
+bool gldebug_active = false;
+
+// O callback pode ser chamado por uma thread do driver
+std::mutex gldebug_mutex;
+std::map<std::string, int> gldebug_repeats;
+
+static const char* GlDebug_SourceName(GLenum source)
+{
+    switch (source)
+    {
+        case GL_DEBUG_SOURCE_API:             return "API";
+        case GL_DEBUG_SOURCE_WINDOW_SYSTEM:   return "WINDOW_SYSTEM";
+        case GL_DEBUG_SOURCE_SHADER_COMPILER: return "SHADER_COMPILER";
+        case GL_DEBUG_SOURCE_THIRD_PARTY:     return "THIRD_PARTY";
+        case GL_DEBUG_SOURCE_APPLICATION:     return "APPLICATION";
+        default:                              return "OTHER";
+    }
+}
+
+static const char* GlDebug_TypeName(GLenum type)
+{
+    switch (type)
+    {
+        case GL_DEBUG_TYPE_ERROR:               return "ERROR";
+        case GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR: return "DEPRECATED_BEHAVIOR";
+        case GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR:  return "UNDEFINED_BEHAVIOR";
+        case GL_DEBUG_TYPE_PORTABILITY:         return "PORTABILITY";
+        case GL_DEBUG_TYPE_PERFORMANCE:         return "PERFORMANCE";
+        default:                                return "OTHER";
+    }
+}
+
+static const char* GlDebug_SeverityName(GLenum severity)
+{
+    switch (severity)
+    {
+        case GL_DEBUG_SEVERITY_HIGH:   return "high";
+        case GL_DEBUG_SEVERITY_MEDIUM: return "medium";
+        case GL_DEBUG_SEVERITY_LOW:    return "low";
+        default:                       return "notification";
+    }
+}
+
+static void APIENTRY GlDebug_Callback(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length,
+                                      const GLchar* message, const void* user)
+{
+    std::string text(message, length >= 0 ? length : strlen(message));
+    std::lock_guard<std::mutex> lock(gldebug_mutex);
+    int repeats = ++gldebug_repeats[text];
+    if (repeats > GLDEBUG_MAX_REPEATS)
+        return;
+
+    FILE* out = type == GL_DEBUG_TYPE_ERROR || severity == GL_DEBUG_SEVERITY_HIGH ? stderr : stdout;
+    fprintf(out, "%s: OpenGL %s %s (%s, id %u): %.*s\n", type == GL_DEBUG_TYPE_ERROR ? "ERROR" : "WARNING",
+            GlDebug_SourceName(source), GlDebug_TypeName(type), GlDebug_SeverityName(severity), id, (int)text.size(), text.c_str());
+    if (repeats == GLDEBUG_MAX_REPEATS)
+        fprintf(out, "(further copies of this OpenGL message are suppressed)\n");
+}
+
+// Liga as mensagens de depuração, se o contexto tiver GL_KHR_debug. "load" é
+// a mesma função usada para carregar a GLAD (glfwGetProcAddress ou
+// eglGetProcAddress).
+bool GlDebug_Init(GLADloadproc load)
+{
+    bool supported = GLVersion.major > 4 || (GLVersion.major == 4 && GLVersion.minor >= 3);
+    GLint num_extensions = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &num_extensions);
+    for (GLint i = 0; i < num_extensions && !supported; ++i)
+        supported = strcmp((const char*)glGetStringi(GL_EXTENSIONS, i), "GL_KHR_debug") == 0;
+    if (!supported)
+    {
+        printf("OpenGL: GL_KHR_debug not available, checking glGetError() instead.\n");
+        return false;
+    }
+
+    gldebug_DebugMessageCallback = (PFNGLDEBUGMESSAGECALLBACKPROC) load("glDebugMessageCallback");
+    gldebug_DebugMessageControl = (PFNGLDEBUGMESSAGECONTROLPROC) load("glDebugMessageControl");
+    gldebug_ObjectLabel = (PFNGLOBJECTLABELPROC) load("glObjectLabel");
+    gldebug_PushDebugGroup = (PFNGLPUSHDEBUGGROUPPROC) load("glPushDebugGroup");
+    gldebug_PopDebugGroup = (PFNGLPOPDEBUGGROUPPROC) load("glPopDebugGroup");
+    if (!gldebug_DebugMessageCallback || !gldebug_DebugMessageControl || !gldebug_ObjectLabel ||
+        !gldebug_PushDebugGroup || !gldebug_PopDebugGroup)
+        return false;
+
+    // GL_DEBUG_OUTPUT_SYNCHRONOUS fica desligado: as mensagens chegam quando o
+    // driver processa os comandos, sem serializar cada chamada. As notificações
+    // (inclusive as dos próprios grupos) são descartadas.
+    gldebug_DebugMessageCallback(GlDebug_Callback, NULL);
+    gldebug_DebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DEBUG_SEVERITY_NOTIFICATION, 0, NULL, GL_FALSE);
+    glEnable(GL_DEBUG_OUTPUT);
+    gldebug_active = true;
+    return true;
+}
+
+bool GlDebug_Active()
+{
+    return gldebug_active;
+}
+
+// Dá um nome ao objeto "name" do tipo "identifier" (GL_BUFFER, GL_TEXTURE,
+// GL_VERTEX_ARRAY, GL_PROGRAM, GL_SAMPLER, ...; veja utils.h)
+void GlDebug_Label(GLenum identifier, GLuint name, const char* label)
+{
+    if (gldebug_active)
+        gldebug_ObjectLabel(identifier, name, -1, label);
+}
+
+void GlDebug_PushGroup(const char* name)
+{
+    if (gldebug_active)
+        gldebug_PushDebugGroup(GL_DEBUG_SOURCE_APPLICATION, 0, -1, name);
+}
+
+void GlDebug_PopGroup()
+{
+    if (gldebug_active)
+        gldebug_PopDebugGroup();
+}
+#endif // NDEBUG
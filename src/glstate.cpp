@@ -0,0 +1,263 @@
+// Cache do estado do OpenGL: guarda uma cópia do programa, VAO, buffers,
+// texturas, samplers, capacidades (glEnable) e valores de uniforms atuais, e
+// só repassa ao driver as chamadas que de fato mudam alguma coisa. As
+// chamadas repassadas são contadas pelo profiler como envios de uniforms ou
+// trocas de estado; as descartadas, como "elided".
+//
+// O cache só enxerga as chamadas feitas através destas funções. Código que
+// altera o mesmo estado chamando o OpenGL diretamente (a inicialização, por
+// exemplo) deve chamar GlState_Reset() em seguida. Só a thread de
+// renderização usa estas funções.
+#include <cstring>
+#include <map>
+#include <vector>
+
+#include <glad/glad.h>
+
+void Profiler_CountUniforms(int n); // Funções definidas em profiler.cpp
+void Profiler_CountStateChanges(int n);
+void Profiler_CountElided(int n);
+
+#define GLSTATE_MAX_TEXTURE_UNITS 32
+#define GLSTATE_UNKNOWN 0xFFFFFFFFu // Valor que nunca é igual ao do driver
+
+namespace
+{
+    // Último valor enviado para um uniform do programa, em bytes
+    struct UniformShadow
+    {
+        GLenum type;
+        std::vector<unsigned char> data;
+    };
+
+    // Capacidades de glEnable()/glDisable() guardadas no cache; as demais são
+    // sempre repassadas
+    const GLenum glstate_caps[] = { GL_BLEND, GL_DEPTH_TEST, GL_CULL_FACE };
+    const int GLSTATE_NUM_CAPS = sizeof(glstate_caps) / sizeof(glstate_caps[0]);
+}
+
+GLuint glstate_program;
+GLuint glstate_vertex_array;
+GLuint glstate_array_buffer;
+GLuint glstate_active_texture;
+GLuint glstate_textures[GLSTATE_MAX_TEXTURE_UNITS];
+GLuint glstate_samplers[GLSTATE_MAX_TEXTURE_UNITS];
+GLuint glstate_caps_enabled[GLSTATE_NUM_CAPS];
+GLuint glstate_blend_src, glstate_blend_dst;
+GLuint glstate_depth_func;
+GLuint glstate_polygon_mode;
+float glstate_line_width;
+
+// Uniforms de cada programa, indexados pela localização. "glstate_uniforms"
+// aponta para os do programa atual.
+std::map<GLuint, std::vector<UniformShadow> > glstate_program_uniforms;
+std::vector<UniformShadow>* glstate_uniforms = NULL;
+
+// Esquece todo o estado guardado: a próxima chamada de cada tipo sempre chega
+// ao driver
+void GlState_Reset()
+{
+    glstate_program = GLSTATE_UNKNOWN;
+    glstate_vertex_array = GLSTATE_UNKNOWN;
+    glstate_array_buffer = GLSTATE_UNKNOWN;
+    glstate_active_texture = GLSTATE_UNKNOWN;
+    for (int i = 0; i < GLSTATE_MAX_TEXTURE_UNITS; ++i)
+    {
+        glstate_textures[i] = GLSTATE_UNKNOWN;
+        glstate_samplers[i] = GLSTATE_UNKNOWN;
+    }
+    for (int i = 0; i < GLSTATE_NUM_CAPS; ++i)
+        glstate_caps_enabled[i] = GLSTATE_UNKNOWN;
+    glstate_blend_src = glstate_blend_dst = GLSTATE_UNKNOWN;
+    glstate_depth_func = GLSTATE_UNKNOWN;
+    glstate_polygon_mode = GLSTATE_UNKNOWN;
+    glstate_line_width = -1.0f;
+    glstate_program_uniforms.clear();
+    glstate_uniforms = NULL;
+}
+
+// Atualiza "shadow" com "value" e retorna true se ele mudou
+static bool GlState_Changed(GLuint& shadow, GLuint value)
+{
+    if (shadow == value)
+    {
+        Profiler_CountElided(1);
+        return false;
+    }
+    shadow = value;
+    Profiler_CountStateChanges(1);
+    return true;
+}
+
+void GlState_UseProgram(GLuint program)
+{
+    if (!GlState_Changed(glstate_program, program))
+        return;
+    glUseProgram(program);
+    glstate_uniforms = &glstate_program_uniforms[program];
+}
+
+// Esquece os uniforms de um programa que foi apagado, já que o mesmo
+// identificador pode ser reaproveitado pelo driver
+void GlState_DeleteProgram(GLuint program)
+{
+    glDeleteProgram(program);
+    glstate_program_uniforms.erase(program);
+    if (glstate_program == program)
+    {
+        glstate_program = GLSTATE_UNKNOWN;
+        glstate_uniforms = NULL;
+    }
+}
+
+void GlState_BindVertexArray(GLuint vertex_array)
+{
+    if (GlState_Changed(glstate_vertex_array, vertex_array))
+        glBindVertexArray(vertex_array);
+}
+
+// Só GL_ARRAY_BUFFER é guardado: GL_ELEMENT_ARRAY_BUFFER faz parte do VAO
+void GlState_BindBuffer(GLenum target, GLuint buffer)
+{
+    if (target != GL_ARRAY_BUFFER)
+    {
+        Profiler_CountStateChanges(1);
+        glBindBuffer(target, buffer);
+    }
+    else if (GlState_Changed(glstate_array_buffer, buffer))
+        glBindBuffer(target, buffer);
+}
+
+// Liga "texture" (GL_TEXTURE_2D) e "sampler" à unidade de textura "unit"
+void GlState_BindTexture(GLuint unit, GLuint texture)
+{
+    if (GlState_Changed(glstate_textures[unit], texture))
+    {
+        if (GlState_Changed(glstate_active_texture, unit))
+            glActiveTexture(GL_TEXTURE0 + unit);
+        glBindTexture(GL_TEXTURE_2D, texture);
+    }
+}
+
+void GlState_BindSampler(GLuint unit, GLuint sampler)
+{
+    if (GlState_Changed(glstate_samplers[unit], sampler))
+        glBindSampler(unit, sampler);
+}
+
+static void GlState_SetCapability(GLenum cap, bool enabled)
+{
+    for (int i = 0; i < GLSTATE_NUM_CAPS; ++i)
+    {
+        if (glstate_caps[i] != cap)
+            continue;
+        if (!GlState_Changed(glstate_caps_enabled[i], enabled))
+            return;
+        break;
+    }
+    if (enabled)
+        glEnable(cap);
+    else
+        glDisable(cap);
+}
+
+void GlState_Enable(GLenum cap)
+{
+    GlState_SetCapability(cap, true);
+}
+
+void GlState_Disable(GLenum cap)
+{
+    GlState_SetCapability(cap, false);
+}
+
+void GlState_BlendFunc(GLenum src, GLenum dst)
+{
+    // Os dois fatores contam como uma só troca de estado
+    if (glstate_blend_src == src && glstate_blend_dst == dst)
+    {
+        Profiler_CountElided(1);
+        return;
+    }
+    glstate_blend_src = src;
+    glstate_blend_dst = dst;
+    Profiler_CountStateChanges(1);
+    glBlendFunc(src, dst);
+}
+
+void GlState_DepthFunc(GLenum func)
+{
+    if (GlState_Changed(glstate_depth_func, func))
+        glDepthFunc(func);
+}
+
+// Sempre para GL_FRONT_AND_BACK, a única face aceita no perfil core
+void GlState_PolygonMode(GLenum mode)
+{
+    if (GlState_Changed(glstate_polygon_mode, mode))
+        glPolygonMode(GL_FRONT_AND_BACK, mode);
+}
+
+void GlState_LineWidth(float width)
+{
+    if (glstate_line_width == width)
+    {
+        Profiler_CountElided(1);
+        return;
+    }
+    glstate_line_width = width;
+    Profiler_CountStateChanges(1);
+    glLineWidth(width);
+}
+
+// Compara "size" bytes com o último valor enviado para o uniform "location"
+// do programa atual, e guarda o novo valor se for diferente. Localizações -1
+// (uniforms que não existem no programa) são ignoradas, como no OpenGL.
+static bool GlState_UniformChanged(GLint location, GLenum type, const void* value, size_t size)
+{
+    if (location < 0)
+        return false;
+    if (!glstate_uniforms)
+    {
+        Profiler_CountUniforms(1);
+        return true;
+    }
+    if ((size_t)location >= glstate_uniforms->size())
+        glstate_uniforms->resize(location + 1);
+
+    UniformShadow& shadow = (*glstate_uniforms)[location];
+    if (shadow.type == type && shadow.data.size() == size && memcmp(shadow.data.data(), value, size) == 0)
+    {
+        Profiler_CountElided(1);
+        return false;
+    }
+    shadow.type = type;
+    shadow.data.assign((const unsigned char*)value, (const unsigned char*)value + size);
+    Profiler_CountUniforms(1);
+    return true;
+}
+
+void GlState_Uniform1i(GLint location, GLint value)
+{
+    if (GlState_UniformChanged(location, GL_INT, &value, sizeof(value)))
+        glUniform1i(location, value);
+}
+
+void GlState_Uniform4f(GLint location, float x, float y, float z, float w)
+{
+    const float value[4] = { x, y, z, w };
+    if (GlState_UniformChanged(location, GL_FLOAT_VEC4, value, sizeof(value)))
+        glUniform4f(location, x, y, z, w);
+}
+
+void GlState_Uniform4fv(GLint location, GLsizei count, const float* value)
+{
+    if (GlState_UniformChanged(location, GL_FLOAT_VEC4, value, 4 * count * sizeof(float)))
+        glUniform4fv(location, count, value);
+}
+
+void GlState_UniformMatrix4fv(GLint location, const float* value)
+{
+    if (GlState_UniformChanged(location, GL_FLOAT_MAT4, value, 16 * sizeof(float)))
+        glUniformMatrix4fv(location, 1, GL_FALSE, value);
+}
@@ -0,0 +1,301 @@
+// Modo "headless": renderização sem janela, para máquinas sem display e sem
+// GPU (ex.: Mesa llvmpipe). Criamos um contexto OpenGL 3.3 "surfaceless" com
+// EGL e renderizamos em um framebuffer object (FBO) em vez da janela da GLFW.
+// Os frames podem ser salvos em arquivos PNG.
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include <glad/glad.h>
+
+#if defined(__linux__)
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+// Dimensões do framebuffer offscreen. Utilizadas também por textrendering.cpp
+// quando não existe janela.
+int g_HeadlessWidth = 800;
+int g_HeadlessHeight = 800;
+
+GLuint headless_fbo = 0;
+GLuint headless_color_rb = 0;
+GLuint headless_depth_rb = 0;
+
+// Com MSAA, o FBO acima tem várias amostras por pixel e é resolvido neste
+// outro antes de glReadPixels()
+int headless_samples = 0;
+GLuint headless_resolve_fbo = 0;
+GLuint headless_resolve_rb = 0;
+
+#if defined(__linux__)
+EGLDisplay headless_display = EGL_NO_DISPLAY;
+EGLContext headless_context = EGL_NO_CONTEXT;
+
+// Cria um contexto OpenGL 3.3 core sem superfície (EGL_MESA_platform_surfaceless,
+// com fallback para o display padrão) e um FBO com cor RGBA8 e profundidade de
+// 24 bits, com "samples" amostras por pixel (0 = sem MSAA), o qual fica ligado
+// como framebuffer de desenho.
+bool Headless_Init(int width, int height, int samples)
+{
+    g_HeadlessWidth = width;
+    g_HeadlessHeight = height;
+
+    PFNEGLGETPLATFORMDISPLAYEXTPROC eglGetPlatformDisplayEXT =
+        (PFNEGLGETPLATFORMDISPLAYEXTPROC) eglGetProcAddress("eglGetPlatformDisplayEXT");
+
+    if (eglGetPlatformDisplayEXT)
+        headless_display = eglGetPlatformDisplayEXT(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+    if (headless_display == EGL_NO_DISPLAY)
+        headless_display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+    EGLint major, minor;
+    if (headless_display == EGL_NO_DISPLAY || !eglInitialize(headless_display, &major, &minor))
+    {
+        fprintf(stderr, "ERROR: eglInitialize() failed.\n");
+        return false;
+    }
+
+    // Não criamos nenhuma superfície EGL (o destino é o FBO), então qualquer
+    // tipo de superfície serve.
+    const EGLint config_attribs[] = {
+        EGL_SURFACE_TYPE, 0,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_NONE
+    };
+    EGLConfig config;
+    EGLint num_configs = 0;
+    eglChooseConfig(headless_display, config_attribs, &config, 1, &num_configs);
+
+    if (num_configs == 0 || !eglBindAPI(EGL_OPENGL_API))
+    {
+        fprintf(stderr, "ERROR: no EGL config with desktop OpenGL support.\n");
+        return false;
+    }
+
+    const EGLint context_attribs[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 3,
+        EGL_CONTEXT_MINOR_VERSION, 3,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+#ifndef NDEBUG
+        EGL_CONTEXT_OPENGL_DEBUG, EGL_TRUE, // Mensagens de GL_KHR_debug (gldebug.cpp)
+#endif
+        EGL_NONE
+    };
+    headless_context = eglCreateContext(headless_display, config, EGL_NO_CONTEXT, context_attribs);
+
+    if (headless_context == EGL_NO_CONTEXT ||
+        !eglMakeCurrent(headless_display, EGL_NO_SURFACE, EGL_NO_SURFACE, headless_context))
+    {
+        fprintf(stderr, "ERROR: cannot create a surfaceless OpenGL 3.3 context.\n");
+        return false;
+    }
+
+    gladLoadGLLoader((GLADloadproc) eglGetProcAddress);
+
+    GLint max_samples = 0;
+    glGetIntegerv(GL_MAX_SAMPLES, &max_samples);
+    if (samples > max_samples)
+    {
+        fprintf(stderr, "WARNING: %d samples per pixel requested, using %d.\n", samples, max_samples);
+        samples = max_samples;
+    }
+    headless_samples = samples;
+
+    if (samples > 0)
+    {
+        glGenFramebuffers(1, &headless_resolve_fbo);
+        glBindFramebuffer(GL_FRAMEBUFFER, headless_resolve_fbo);
+
+        glGenRenderbuffers(1, &headless_resolve_rb);
+        glBindRenderbuffer(GL_RENDERBUFFER, headless_resolve_rb);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, headless_resolve_rb);
+    }
+
+    glGenFramebuffers(1, &headless_fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, headless_fbo);
+
+    glGenRenderbuffers(1, &headless_color_rb);
+    glBindRenderbuffer(GL_RENDERBUFFER, headless_color_rb);
+    glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples, GL_RGBA8, width, height);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, headless_color_rb);
+
+    glGenRenderbuffers(1, &headless_depth_rb);
+    glBindRenderbuffer(GL_RENDERBUFFER, headless_depth_rb);
+    glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples, GL_DEPTH_COMPONENT24, width, height);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, headless_depth_rb);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    {
+        fprintf(stderr, "ERROR: headless framebuffer is incomplete.\n");
+        return false;
+    }
+
+    glViewport(0, 0, width, height);
+    return true;
+}
+
+void Headless_Terminate()
+{
+    glDeleteFramebuffers(1, &headless_fbo);
+    glDeleteRenderbuffers(1, &headless_color_rb);
+    glDeleteRenderbuffers(1, &headless_depth_rb);
+    if (headless_samples > 0)
+    {
+        glDeleteFramebuffers(1, &headless_resolve_fbo);
+        glDeleteRenderbuffers(1, &headless_resolve_rb);
+    }
+
+    eglMakeCurrent(headless_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    eglDestroyContext(headless_display, headless_context);
+    eglTerminate(headless_display);
+}
+
+// Carrega funções OpenGL fora das da GLAD (ex.: GL_KHR_debug)
+void* Headless_GetProcAddress(const char* name)
+{
+    return (void*) eglGetProcAddress(name);
+}
+#else
+bool Headless_Init(int width, int height, int samples)
+{
+    fprintf(stderr, "ERROR: headless mode is only supported on Linux (EGL).\n");
+    return false;
+}
+
+void Headless_Terminate()
+{
+}
+
+void* Headless_GetProcAddress(const char* name)
+{
+    return NULL;
+}
+#endif
+
+// Funções auxiliares para escrita de PNG sem dependências externas. Os dados
+// são gravados em blocos "stored" (sem compressão) do formato deflate.
+static unsigned int PNG_Crc32(unsigned int crc, const unsigned char* data, size_t len)
+{
+    static unsigned int table[256];
+    static bool table_ready = false;
+    if (!table_ready)
+    {
+        for (unsigned int n = 0; n < 256; ++n)
+        {
+            unsigned int c = n;
+            for (int k = 0; k < 8; ++k)
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : (c >> 1);
+            table[n] = c;
+        }
+        table_ready = true;
+    }
+
+    crc = ~crc;
+    for (size_t i = 0; i < len; ++i)
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+static void PNG_PutU32(std::vector<unsigned char>& out, unsigned int v)
+{
+    out.push_back((v >> 24) & 0xFF);
+    out.push_back((v >> 16) & 0xFF);
+    out.push_back((v >> 8) & 0xFF);
+    out.push_back(v & 0xFF);
+}
+
+static void PNG_WriteChunk(FILE* file, const char* type, const std::vector<unsigned char>& data)
+{
+    std::vector<unsigned char> chunk;
+    PNG_PutU32(chunk, (unsigned int)data.size());
+    chunk.insert(chunk.end(), type, type + 4);
+    chunk.insert(chunk.end(), data.begin(), data.end());
+    PNG_PutU32(chunk, PNG_Crc32(0, &chunk[4], chunk.size() - 4));
+    fwrite(chunk.data(), 1, chunk.size(), file);
+}
+
+// Salva uma imagem RGB de 8 bits por canal em um arquivo PNG. As linhas de
+// "pixels" estão na ordem do OpenGL (de baixo para cima).
+bool WritePNG(const char* filename, const unsigned char* pixels, int width, int height)
+{
+    FILE* file = fopen(filename, "wb");
+    if (!file)
+    {
+        fprintf(stderr, "ERROR: Cannot open file \"%s\".\n", filename);
+        return false;
+    }
+
+    const unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    fwrite(signature, 1, 8, file);
+
+    std::vector<unsigned char> header;
+    PNG_PutU32(header, width);
+    PNG_PutU32(header, height);
+    header.push_back(8); // Bits por canal
+    header.push_back(2); // RGB
+    header.push_back(0);
+    header.push_back(0);
+    header.push_back(0);
+    PNG_WriteChunk(file, "IHDR", header);
+
+    // Linhas com o byte de filtro (0 = nenhum), invertidas verticalmente
+    const size_t stride = 3 * width;
+    std::vector<unsigned char> raw;
+    raw.reserve((stride + 1) * height);
+    for (int y = height - 1; y >= 0; --y)
+    {
+        raw.push_back(0);
+        raw.insert(raw.end(), pixels + y * stride, pixels + (y + 1) * stride);
+    }
+
+    std::vector<unsigned char> zdata;
+    zdata.push_back(0x78);
+    zdata.push_back(0x01);
+    unsigned int a = 1, b = 0;
+    for (size_t pos = 0; pos < raw.size(); pos += 65535)
+    {
+        size_t len = raw.size() - pos < 65535 ? raw.size() - pos : 65535;
+        zdata.push_back(pos + len == raw.size() ? 1 : 0);
+        zdata.push_back(len & 0xFF);
+        zdata.push_back((len >> 8) & 0xFF);
+        zdata.push_back(~len & 0xFF);
+        zdata.push_back((~len >> 8) & 0xFF);
+        zdata.insert(zdata.end(), raw.begin() + pos, raw.begin() + pos + len);
+        for (size_t i = pos; i < pos + len; ++i)
+        {
+            a = (a + raw[i]) % 65521;
+            b = (b + a) % 65521;
+        }
+    }
+    PNG_PutU32(zdata, (b << 16) | a);
+    PNG_WriteChunk(file, "IDAT", zdata);
+    PNG_WriteChunk(file, "IEND", std::vector<unsigned char>());
+
+    fclose(file);
+    return true;
+}
+
+// Lê o framebuffer atual (o FBO no modo headless) e salva em um arquivo PNG.
+bool Headless_SaveFrame(const char* filename)
+{
+    std::vector<unsigned char> pixels(3 * g_HeadlessWidth * g_HeadlessHeight);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    if (headless_samples > 0)
+    {
+        // Não é possível ler um framebuffer com várias amostras diretamente
+        GLint fbo = 0;
+        glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &fbo);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, headless_resolve_fbo);
+        glBlitFramebuffer(0, 0, g_HeadlessWidth, g_HeadlessHeight, 0, 0, g_HeadlessWidth, g_HeadlessHeight,
+                          GL_COLOR_BUFFER_BIT, GL_NEAREST);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, headless_resolve_fbo);
+        glReadPixels(0, 0, g_HeadlessWidth, g_HeadlessHeight, GL_RGB, GL_UNSIGNED_BYTE, pixels.data());
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    }
+    else
+        glReadPixels(0, 0, g_HeadlessWidth, g_HeadlessHeight, GL_RGB, GL_UNSIGNED_BYTE, pixels.data());
+    return WritePNG(filename, pixels.data(), g_HeadlessWidth, g_HeadlessHeight);
+}
@@ -0,0 +1,204 @@
+// Gravação e reprodução das entradas do jogo (argumentos "--record ARQUIVO" e
+// "--replay ARQUIVO"). Como a simulação avança em passos fixos e o gerador de
+// números aleatórios é inicializado com uma semente conhecida, basta guardar
+// a semente e, para cada tecla, o número do passo em que ela foi aplicada
+// para reproduzir exatamente a mesma partida.
+//
+// Formato do arquivo (binário, little-endian):
+//   cabeçalho: "FCGI", versão (uint32), semente (uint32), passos por segundo (uint32)
+//   obstáculos: Z mínimo e máximo em que aparecem (int32), Z em que são
+//               removidos (float), reservado (uint32)
+//   eventos:   passo (uint32), tecla (int16), ação (uint8), reservado (uint8)
+// O último evento tem tecla -1 e marca o passo em que a gravação terminou.
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include <stdint.h>
+
+bool Quality_ValidObstacleWindow(int spawn_near, int spawn_far, float behind_z); // Função definida em quality.cpp
+
+namespace
+{
+    const char INPUTLOG_MAGIC[4] = { 'F', 'C', 'G', 'I' };
+    const uint32_t INPUTLOG_VERSION = 6; // 2: semente do gerador da partida (GameState), e não de rand()
+                                         // 3: obstáculos calculados a partir do instante em que apareceram
+                                         // 4: colisão testada ao longo de todo o passo
+                                         // 5: colisão com as malhas dos obstáculos e o corpo inteiro
+                                         // 6: janela dos obstáculos, que depende do nível de qualidade
+    const int16_t INPUTLOG_END = -1;
+
+    struct InputLogHeader
+    {
+        char magic[4];
+        uint32_t version;
+        uint32_t seed;
+        uint32_t tick_rate;
+    };
+
+    // Valores fixos da janela dos obstáculos antes da versão 6
+    const int32_t INPUTLOG_V5_SPAWN_NEAR = 25;
+    const int32_t INPUTLOG_V5_SPAWN_FAR = 65;
+    const float INPUTLOG_V5_BEHIND_Z = -20.0f;
+
+    struct InputLogObstacles
+    {
+        int32_t spawn_near;
+        int32_t spawn_far;
+        float behind_z;
+        uint32_t reserved;
+    };
+
+    struct InputLogEvent
+    {
+        uint32_t tick;
+        int16_t key;
+        uint8_t action;
+        uint8_t reserved;
+    };
+
+    static_assert(sizeof(InputLogHeader) == 16, "InputLogHeader deve ter 16 bytes");
+    static_assert(sizeof(InputLogObstacles) == 16, "InputLogObstacles deve ter 16 bytes");
+    static_assert(sizeof(InputLogEvent) == 8, "InputLogEvent deve ter 8 bytes");
+}
+
+FILE* inputlog_file = NULL;
+
+std::vector<InputLogEvent> inputlog_events;
+size_t inputlog_next = 0;
+
+// Cria o arquivo de gravação e escreve o cabeçalho, com a janela em que os
+// obstáculos aparecem e são removidos (veja quality.h)
+bool InputLog_OpenWrite(const char* filename, unsigned int seed, unsigned int tick_rate,
+                        int spawn_near, int spawn_far, float behind_z)
+{
+    inputlog_file = fopen(filename, "wb");
+    if (!inputlog_file)
+    {
+        fprintf(stderr, "ERROR: cannot open \"%s\" for writing.\n", filename);
+        return false;
+    }
+
+    InputLogHeader header;
+    memcpy(header.magic, INPUTLOG_MAGIC, sizeof(header.magic));
+    header.version = INPUTLOG_VERSION;
+    header.seed = seed;
+    header.tick_rate = tick_rate;
+    fwrite(&header, sizeof(header), 1, inputlog_file);
+
+    InputLogObstacles obstacles = { spawn_near, spawn_far, behind_z, 0 };
+    fwrite(&obstacles, sizeof(obstacles), 1, inputlog_file);
+    return true;
+}
+
+// Grava uma tecla aplicada pela simulação no passo "tick"
+void InputLog_Write(unsigned int tick, int key, int action)
+{
+    if (!inputlog_file)
+        return;
+
+    InputLogEvent event = { tick, (int16_t)key, (uint8_t)action, 0 };
+    fwrite(&event, sizeof(event), 1, inputlog_file);
+}
+
+// Grava o marcador de fim com o último passo simulado e fecha o arquivo
+void InputLog_CloseWrite(unsigned int last_tick)
+{
+    if (!inputlog_file)
+        return;
+
+    InputLogEvent event = { last_tick, INPUTLOG_END, 0, 0 };
+    fwrite(&event, sizeof(event), 1, inputlog_file);
+    fclose(inputlog_file);
+    inputlog_file = NULL;
+}
+
+// Carrega uma gravação inteira para a memória. Retorna a semente, a janela dos
+// obstáculos e o passo em que a gravação terminou. Gravações da versão 5 são
+// aceitas com a janela fixa da época.
+bool InputLog_OpenRead(const char* filename, unsigned int tick_rate, unsigned int* seed, unsigned int* last_tick,
+                       int* spawn_near, int* spawn_far, float* behind_z)
+{
+    FILE* file = fopen(filename, "rb");
+    if (!file)
+    {
+        fprintf(stderr, "ERROR: cannot open \"%s\" for reading.\n", filename);
+        return false;
+    }
+
+    InputLogHeader header;
+    if (fread(&header, sizeof(header), 1, file) != 1
+        || memcmp(header.magic, INPUTLOG_MAGIC, sizeof(header.magic)) != 0
+        || (header.version != INPUTLOG_VERSION && header.version != 5))
+    {
+        fprintf(stderr, "ERROR: \"%s\" is not an input recording.\n", filename);
+        fclose(file);
+        return false;
+    }
+
+    if (header.tick_rate != tick_rate)
+    {
+        fprintf(stderr, "ERROR: \"%s\" was recorded at %u ticks/s, but the simulation runs at %u ticks/s.\n",
+                filename, header.tick_rate, tick_rate);
+        fclose(file);
+        return false;
+    }
+
+    InputLogObstacles obstacles = { INPUTLOG_V5_SPAWN_NEAR, INPUTLOG_V5_SPAWN_FAR, INPUTLOG_V5_BEHIND_Z, 0 };
+    if (header.version >= 6 && fread(&obstacles, sizeof(obstacles), 1, file) != 1)
+    {
+        fprintf(stderr, "ERROR: \"%s\" is truncated.\n", filename);
+        fclose(file);
+        return false;
+    }
+    if (!Quality_ValidObstacleWindow(obstacles.spawn_near, obstacles.spawn_far, obstacles.behind_z))
+    {
+        fprintf(stderr, "ERROR: \"%s\" has an invalid obstacle window (spawn %d-%d, behind %g).\n",
+                filename, (int)obstacles.spawn_near, (int)obstacles.spawn_far, obstacles.behind_z);
+        fclose(file);
+        return false;
+    }
+
+    inputlog_events.clear();
+    inputlog_next = 0;
+    *last_tick = 0;
+
+    InputLogEvent event;
+    bool ended = false;
+    while (fread(&event, sizeof(event), 1, file) == 1)
+    {
+        if (event.key == INPUTLOG_END)
+        {
+            ended = true;
+            *last_tick = event.tick;
+            break;
+        }
+        inputlog_events.push_back(event);
+        *last_tick = event.tick;
+    }
+    fclose(file);
+
+    // Uma gravação interrompida (ex.: o programa foi encerrado à força) ainda
+    // pode ser reproduzida até o último evento gravado.
+    if (!ended)
+        fprintf(stderr, "WARNING: \"%s\" has no end marker; replaying up to the last event.\n", filename);
+
+    *seed = header.seed;
+    *spawn_near = obstacles.spawn_near;
+    *spawn_far = obstacles.spawn_far;
+    *behind_z = obstacles.behind_z;
+    return true;
+}
+
+// Retorna, um de cada vez, os eventos gravados no passo "tick". Deve ser
+// chamada com passos crescentes.
+bool InputLog_Read(unsigned int tick, int* key, int* action)
+{
+    if (inputlog_next >= inputlog_events.size() || inputlog_events[inputlog_next].tick != tick)
+        return false;
+
+    *key = inputlog_events[inputlog_next].key;
+    *action = inputlog_events[inputlog_next].action;
+    ++inputlog_next;
+    return true;
+}
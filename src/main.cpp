@@ -1,11 +1,16 @@
 #define STB_IMAGE_IMPLEMENTATION
 #define TINYOBJLOADER_IMPLEMENTATION
 #include <cmath>
+#include <cstddef>
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
+#include <ctime>
 
+#ifdef _WIN32
 #include <windows.h>
 #include <mmsystem.h>
+#endif
 
 // Headers abaixo são específicos de C++
 #include <map>
@@ -17,7 +22,12 @@
 #include <sstream>
 #include <stdexcept>
 #include <algorithm>
-#include <list>
+#include <random>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
 
 // Headers das bibliotecas OpenGL
 #include <glad/glad.h>   // Criação de contexto OpenGL 3.3
@@ -26,7 +36,9 @@
 // Headers da biblioteca GLM: criação de matrizes e vetores.
 #include <glm/mat4x4.hpp>
 #include <glm/vec4.hpp>
+#include <glm/common.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include <glm/gtc/matrix_transform.hpp>
 
 // Headers da biblioteca para carregar modelos obj
 #include <tiny_obj_loader.h>
@@ -35,6 +47,8 @@
 // Headers locais, definidos na pasta "include/"
 #include "utils.h"
 #include "matrices.h"
+#include "triplebuffer.h"
+#include "quality.h"
 
 #define PI 3.141592f
 
@@ -59,10 +73,193 @@ GLuint CreateGpuProgram(GLuint vertex_shader_id, GLuint fragment_shader_id); //
 void TextRendering_Init();
 float TextRendering_LineHeight(GLFWwindow* window);
 float TextRendering_CharWidth(GLFWwindow* window);
-void TextRendering_ShowPoints(GLFWwindow* window);
-void TextRendering_ShowStartMessage(GLFWwindow* window);
+struct FrameSnapshot;
+void TextRendering_ShowPoints(GLFWwindow* window, const FrameSnapshot& snapshot);
+void TextRendering_ShowStartMessage(GLFWwindow* window, const FrameSnapshot& snapshot);
 void TextRendering_PrintString(GLFWwindow* window, const std::string &str, float x, float y, float scale = 1.0f);
-
+void TextRendering_BuildSdfAtlas();
+size_t TextRendering_LayoutString(const std::string &str, float x, float y, float sx, float sy, std::vector<float>& quads);
+
+// Declaração das funções do modo "headless" (sem janela). Estas funções estão
+// definidas no arquivo "headless.cpp".
+bool Headless_Init(int width, int height, int samples);
+void Headless_Terminate();
+bool Headless_SaveFrame(const char* filename);
+void* Headless_GetProcAddress(const char* name);
+bool WritePNG(const char* filename, const unsigned char* pixels, int width, int height);
+
+// Declaração das funções do renderizador por software (argumento
+// "--software"). Estas funções estão definidas no arquivo "softrender.cpp".
+bool SoftRender_Init(int width, int height, int num_threads);
+int SoftRender_AddVertexArray(const std::vector<float>& positions, const std::vector<float>& normals,
+                              const std::vector<float>& texcoords, const std::vector<float>& colors,
+                              const std::vector<unsigned int>& indices);
+void SoftRender_AddTexture(int unit, const unsigned char* data, int width, int height);
+void SoftRender_SetCamera(const glm::mat4& view, const glm::mat4& projection);
+void SoftRender_BindVertexArray(int vertex_array);
+void SoftRender_SetModel(const glm::mat4& model);
+void SoftRender_SetObjectId(int object_id);
+void SoftRender_SetBBox(const glm::vec4& bbox_min, const glm::vec4& bbox_max);
+void SoftRender_SetSpecular(bool enabled);
+void SoftRender_BeginFrame(const glm::vec3& clear_color);
+void SoftRender_DrawElements(size_t first_index, size_t num_indices);
+void SoftRender_EndFrame();
+const unsigned char* SoftRender_GetPixels();
+
+// Declaração das funções de gravação e reprodução das entradas (argumentos
+// "--record" e "--replay"). Definidas no arquivo "inputlog.cpp".
+bool InputLog_OpenWrite(const char* filename, unsigned int seed, unsigned int tick_rate,
+                        int spawn_near, int spawn_far, float behind_z);
+void InputLog_Write(unsigned int tick, int key, int action);
+void InputLog_CloseWrite(unsigned int last_tick);
+bool InputLog_OpenRead(const char* filename, unsigned int tick_rate, unsigned int* seed, unsigned int* last_tick,
+                       int* spawn_near, int* spawn_far, float* behind_z);
+bool InputLog_Read(unsigned int tick, int* key, int* action);
+
+// Declaração das funções do profiler de quadros (tecla F e argumento
+// "--trace ARQUIVO"). Definidas no arquivo "profiler.cpp".
+void Profiler_Init(bool gpu, bool tracing);
+void Profiler_SetThreadName(const char* name);
+void Profiler_BeginScope(const char* name);
+void Profiler_EndScope();
+void Profiler_BeginGpuScope(const char* name);
+void Profiler_EndGpuScope();
+void Profiler_CountDrawCalls(int n);
+void Profiler_CountUniforms(int n);
+void Profiler_CountStateChanges(int n);
+void Profiler_BeginFrame();
+void Profiler_EndFrame();
+void Profiler_ToggleOverlay();
+void Profiler_DrawOverlay(GLFWwindow* window);
+void Profiler_PrintSummary();
+bool Profiler_WriteTrace(const char* filename);
+double Profiler_LastGpuTime(const char* name);
+
+// Declaração das funções do cache de estado do OpenGL, que descartam as
+// chamadas que não mudam nada. Definidas no arquivo "glstate.cpp".
+void GlState_Reset();
+void GlState_UseProgram(GLuint program);
+void GlState_DeleteProgram(GLuint program);
+void GlState_BindVertexArray(GLuint vertex_array);
+void GlState_BindBuffer(GLenum target, GLuint buffer);
+void GlState_BindTexture(GLuint unit, GLuint texture);
+void GlState_BindSampler(GLuint unit, GLuint sampler);
+void GlState_Enable(GLenum cap);
+void GlState_Disable(GLenum cap);
+void GlState_BlendFunc(GLenum src, GLenum dst);
+void GlState_DepthFunc(GLenum func);
+void GlState_PolygonMode(GLenum mode);
+void GlState_LineWidth(float width);
+void GlState_Uniform1i(GLint location, GLint value);
+void GlState_Uniform4f(GLint location, float x, float y, float z, float w);
+void GlState_Uniform4fv(GLint location, GLsizei count, const float* value);
+void GlState_UniformMatrix4fv(GLint location, const float* value);
+
+// Declaração das funções de captura e reprodução das chamadas OpenGL
+// (argumentos "--capture ARQUIVO" e "--glreplay ARQUIVO"). Definidas no
+// arquivo "glcapture.cpp".
+bool GlCapture_Open(const char* filename, int first_frame, int num_frames);
+void GlCapture_Close();
+bool GlCapture_BeginFrame(int frame);
+void GlCapture_EndFrame();
+int GlCapture_Replay(const char* filename, const char* dump_dir);
+
+// Declaração das funções da resolução dinâmica (argumento "--dynres MS"), que
+// desenha a cena em um FBO de resolução ajustada pelo tempo de GPU. Definidas
+// no arquivo "dynres.cpp".
+bool DynRes_Init(double target_ms);
+void DynRes_Resize(int width, int height);
+void DynRes_Update(double scene_gpu_ms);
+void DynRes_BeginScene();
+void DynRes_EndScene();
+void DynRes_PrintSummary();
+
+// Declaração das funções dos níveis de qualidade (argumentos "--quality
+// NIVEL" e "--quality-config ARQUIVO"). Definidas no arquivo "quality.cpp".
+bool Quality_SetPreset(QualitySettings& q, const char* name);
+bool Quality_LoadFile(QualitySettings& q, const char* filename);
+void Quality_Print(const QualitySettings& q);
+
+// Declaração das rotinas de transformação em lote (SSE/AVX). Definidas no
+// arquivo "transforms.cpp".
+glm::mat4 Transform_Multiply(const glm::mat4& a, const glm::mat4& b);
+void Transform_MultiplyBatch(const glm::mat4* a, const glm::mat4* b, glm::mat4* out, size_t count);
+void Transform_TranslateBatch(glm::mat4* m, size_t count, const glm::vec3& t);
+void Transform_TranslateZBatch(glm::mat4* m, const float* dz, size_t count);
+glm::mat4 Transform_AffineInverse(const glm::mat4& m);
+void Transform_AffineInverseBatch(const glm::mat4* in, glm::mat4* out, size_t count);
+void Transform_EvaluateHierarchy(const int* parents, const glm::mat4* locals, glm::mat4* worlds, size_t count);
+
+// Declaração do teste de colisão contínuo com os obstáculos (fase ampla por
+// pista e fase estreita em SIMD). Definido no arquivo "collision.cpp".
+size_t Collision_PlayerSweep(const float player[6], const float* boxes, const float* motion, const unsigned char* lanes, size_t count,
+                             unsigned int* hits, float* times);
+
+// Declaração das funções da BVH de triângulos das malhas, usada nas
+// colisões com a geometria dos obstáculos. Definidas no arquivo "bvh.cpp".
+int Bvh_Build(const float* triangles, size_t count);
+void Bvh_Release(int bvh);
+size_t Bvh_NodeCount(int bvh);
+void Bvh_NodeBounds(int bvh, size_t node, glm::vec3& min, glm::vec3& max);
+void Bvh_Bounds(int bvh, glm::vec3& min, glm::vec3& max);
+bool Bvh_OverlapsBox(int bvh, const glm::mat4& model, const glm::vec3& boxMin, const glm::vec3& boxMax);
+float Bvh_Raycast(int bvh, const glm::mat4& model, const glm::vec3& origin, const glm::vec3& direction, float maxT);
+
+// Declaração das funções dos clipes de animação amostrados, que produzem os
+// ângulos das articulações do personagem. Definidas no arquivo "animation.cpp".
+int Animation_CreateClip(const float* poses, size_t channels, size_t frames, float sampleRate, bool loop);
+void Animation_EvaluateBatch(const int* clips, const float* times, const int* fromClips, const float* fromTimes,
+                             const float* weights, size_t count, float* out);
+
+// Declaração das funções de desenho de depuração (linhas, caixas e eixos
+// acumulados durante o quadro e desenhados de uma só vez). Definidas no
+// arquivo "debugdraw.cpp"; nas compilações de release (NDEBUG) são funções
+// vazias e o desenho de depuração desaparece.
+#ifndef NDEBUG
+void DebugDraw_Init();
+void DebugDraw_Line(const glm::vec4& a, const glm::vec4& b, const glm::vec3& color);
+void DebugDraw_Box(const glm::mat4& model, const glm::vec3& min, const glm::vec3& max, const glm::vec3& color);
+void DebugDraw_Aabb(const glm::vec3& min, const glm::vec3& max, const glm::vec3& color);
+void DebugDraw_Frame(const glm::mat4& model, float size);
+void DebugDraw_Flush(const glm::mat4& view, const glm::mat4& projection, bool draw);
+#else
+inline void DebugDraw_Init() {}
+inline void DebugDraw_Line(const glm::vec4&, const glm::vec4&, const glm::vec3&) {}
+inline void DebugDraw_Box(const glm::mat4&, const glm::vec3&, const glm::vec3&, const glm::vec3&) {}
+inline void DebugDraw_Aabb(const glm::vec3&, const glm::vec3&, const glm::vec3&) {}
+inline void DebugDraw_Frame(const glm::mat4&, float) {}
+inline void DebugDraw_Flush(const glm::mat4&, const glm::mat4&, bool) {}
+#endif
+
+// Declaração das funções de depuração do OpenGL (mensagens assíncronas de
+// GL_KHR_debug, nomes de objetos e grupos por passo do quadro). Definidas no
+// arquivo "gldebug.cpp"; vazias nas compilações de release (NDEBUG).
+#ifndef NDEBUG
+bool GlDebug_Init(GLADloadproc load);
+void GlDebug_Label(GLenum identifier, GLuint name, const char* label);
+void GlDebug_PushGroup(const char* name);
+void GlDebug_PopGroup();
+#else
+inline bool GlDebug_Init(GLADloadproc) { return false; }
+inline void GlDebug_Label(GLenum, GLuint, const char*) {}
+inline void GlDebug_PushGroup(const char*) {}
+inline void GlDebug_PopGroup() {}
+#endif
+
+// Declaração das funções de medição de desempenho (argumento "--bench
+// ARQUIVO"). Definidas no arquivo "bench.cpp".
+typedef void (*BenchFunction)(void* data);
+void Bench_Sink(float value);
+void Bench_PrintHeader();
+void Bench_Run(const char* name, BenchFunction fn, void* data, double items = 1.0);
+bool Bench_WriteJson(const char* filename);
+
+// Mede o tempo de CPU do bloco onde é declarado
+struct ProfileScope
+{
+    ProfileScope(const char* name) { Profiler_BeginScope(name); }
+    ~ProfileScope() { Profiler_EndScope(); }
+};
 
 // Funções callback para comunicação com o sistema operacional e interação do
 // usuário. Veja mais comentários nas definições das mesmas, abaixo.
@@ -72,22 +269,286 @@ void KeyCallback(GLFWwindow* window, int key, int scancode, int action, int mode
 void MouseButtonCallback(GLFWwindow* window, int button, int action, int mods);
 void CursorPosCallback(GLFWwindow* window, double xpos, double ypos);
 void ScrollCallback(GLFWwindow* window, double xoffset, double yoffset);
+void WindowRefreshCallback(GLFWwindow* window);
+
+// Renderização sob demanda na tela inicial (antes de ENTER), só no modo com
+// janela: em vez de redesenhar a mesma imagem sem parar, o loop espera por
+// eventos com glfwWaitEventsTimeout(). Cada evento que muda a imagem (tecla,
+// mouse, redimensionamento, janela exposta) chama InvalidateFrame(), que
+// mantém a renderização contínua por IDLE_SETTLE_TIME segundos: o bastante
+// para a simulação aplicar a tecla e a pose interpolada parar de mudar. Sem
+// eventos, um quadro é desenhado a cada IDLE_REDRAW_INTERVAL segundos.
+#define IDLE_SETTLE_TIME 0.25
+#define IDLE_REDRAW_INTERVAL 1.0
+double g_ContinuousUntil = 0.0;
+void InvalidateFrame();
+void WaitForInvalidation(GLFWwindow* window);
+
+// A simulação do jogo (movimentação do personagem, obstáculos e colisões)
+// avança em passos de tempo fixos, independentes da taxa de quadros. Cada
+// quadro executa tantos passos quantos couberem no tempo acumulado e desenha
+// o estado interpolado entre os dois últimos passos.
+#define SIM_TICK_RATE 120
+#define SIM_DT (1.0 / SIM_TICK_RATE)
+
+// Máximo de tempo simulado por quadro, evitando que um quadro lento gere
+// cada vez mais passos de simulação
+#define SIM_MAX_FRAME_TIME 0.25
+
+// Velocidades dos obstáculos ao longo do eixo Z do modelo
+#define OBSTACLE_SPEED -10.0f
+#define BUS_SPEED 30.0f
+
+// Altura da base do torso em relação aos pés (ver BuildCharacter())
+#define CHARACTER_LEG_HEIGHT 1.83f
+
+// Instante do relógio (GameTime()) que corresponde ao tempo zero da simulação
+double g_SimClockBase = 0.0;
+
+// Nível de qualidade em uso (veja quality.h). Definido antes de abrir a janela
+// e constante durante todo o jogo; a janela dos obstáculos vem da gravação
+// quando há "--replay".
+QualitySettings g_Quality;
+
+// Semente do gerador de números aleatórios usado pela simulação ("--seed N").
+// Junto com as teclas gravadas por "--record", reproduz a partida.
+unsigned int g_RandomSeed = 0;
+
+// Reprodução de uma gravação ("--replay ARQUIVO"): as teclas do jogo vêm do
+// arquivo, e as do usuário são ignoradas. A reprodução termina no passo
+// g_ReplayLastTick.
+bool g_Replaying = false;
+unsigned int g_ReplayLastTick = 0;
+
+// Pose do personagem e posição da câmera: tudo o que a simulação altera e que
+// é desenhado por BuildCharacter() e BuildCamera().
+struct CharacterPose
+{
+    float torsoPositionX, torsoPositionY;
+    float rightForearmAngleZ, rightForearmAngleX;
+    float leftForearmAngleZ, leftForearmAngleX;
+    float rightArmAngleX, rightArmAngleZ;
+    float leftArmAngleX, leftArmAngleZ;
+    float leftLegAngleX, leftLegAngleZ;
+    float rightLegAngleX, rightLegAngleZ;
+    float leftLowerLegAngleX, leftLowerLegAngleZ;
+    float rightLowerLegAngleX, rightLowerLegAngleZ;
+    glm::vec4 cameraPosition;
+};
+
+// Os ângulos das articulações são os floats consecutivos de
+// rightForearmAngleZ a rightLowerLegAngleZ, e são os canais dos clipes de
+// animação (veja PoseAngles()).
+#define CHARACTER_POSE_ANGLES 16
+
+// Clipes de animação do personagem, gerados em BuildAnimationClips()
+enum CharacterClip
+{
+    CLIP_IDLE,
+    CLIP_RUN,
+    CLIP_JUMP,
+    CLIP_FALL,
+    NUM_CHARACTER_CLIPS
+};
+
+// Amostras por segundo das tabelas de pose
+#define ANIMATION_SAMPLE_RATE 60.0f
+
+// Duração da subida do pulo, que também é a da transição para a pose do pulo
+#define JUMP_DURATION 0.4
+
+// Clipe que o personagem está tocando. A simulação só troca de clipe; a pose
+// é calculada a partir do tempo, ao desenhar. Uma transição parte da pose do
+// clipe anterior no instante da troca e chega ao novo clipe em
+// "blendDuration" segundos.
+struct CharacterAnimation
+{
+    int clip;            // CharacterClip
+    double startTime;    // Tempo da simulação em que o clipe começou
+    int fromClip;
+    float fromTime;      // Instante de "fromClip" em que a transição começou
+    float blendDuration;
+};
+
+// Tipos de obstáculo. Os parâmetros de cada tipo estão em g_ObstacleKinds.
+enum ObstacleType
+{
+    OBSTACLE_COW,
+    OBSTACLE_BLOCKADE,
+    OBSTACLE_BUS,
+    NUM_OBSTACLE_TYPES
+};
+
+struct ObstacleKind
+{
+    float speed;        // Velocidade ao longo do eixo Z do modelo
+    const char* model;  // Malha desenhada, usada também nas colisões
+};
+
+const ObstacleKind g_ObstacleKinds[NUM_OBSTACLE_TYPES] = {
+    { OBSTACLE_SPEED, "../../data/cow.obj" },          // OBSTACLE_COW
+    { OBSTACLE_SPEED, "../../data/roadBlockade.obj" }, // OBSTACLE_BLOCKADE
+    { BUS_SPEED,      "../../data/bus.obj" }           // OBSTACLE_BUS
+};
+
+// Forma de colisão de cada tipo de obstáculo: a BVH dos triângulos da malha
+// e a caixa que a envolve, no espaço do modelo. Preenchida por
+// BuildObstacleShape() ao carregar os modelos, antes de a simulação começar.
+struct ObstacleShape
+{
+    int bvh;
+    glm::vec3 center;
+    glm::vec3 half;
+};
+
+ObstacleShape g_ObstacleShapes[NUM_OBSTACLE_TYPES];
+
+// Número máximo de obstáculos simultâneos. Com 0.3 obstáculos por segundo,
+// cada um visível por menos de 10 segundos, nunca passamos de uns poucos.
+#define MAX_OBSTACLES 64
+
+// Obstáculos em jogo, com um vetor de tamanho fixo para cada campo
+// (structure of arrays): as passagens de ObstacleTransforms(), da colisão e
+// da remoção percorrem a memória sequencialmente e nada é alocado durante a
+// partida. Um obstáculo removido é substituído pelo último.
+//
+// Um obstáculo guarda somente a transformação do instante em que apareceu
+// (posição, rotação e escala do modelo): como a velocidade é constante, a
+// posição em qualquer instante é calculada diretamente por
+// ObstacleTransforms(), sem acumular uma multiplicação (e o seu erro de
+// arredondamento) a cada passo.
+struct ObstaclePool
+{
+    size_t count;
+    glm::mat4 base[MAX_OBSTACLES];      // Transformação no instante spawnTime
+    double spawnTime[MAX_OBSTACLES];    // Tempo da simulação em que o obstáculo apareceu
+    float speed[MAX_OBSTACLES];         // Copiada de g_ObstacleKinds
+    unsigned char lane[MAX_OBSTACLES];  // Pista em que apareceu: 0, 1 ou 2
+    unsigned char type[MAX_OBSTACLES];  // ObstacleType
+};
+
+// Uma tecla do jogo, aplicada pela simulação no início de um passo
+struct InputEvent
+{
+    int key;
+    int action;
+};
+
+// Todo o estado de uma partida. A simulação só lê e escreve o GameState que
+// recebe, de modo que várias partidas independentes podem ser simuladas ao
+// mesmo tempo (veja RunBatch()).
+struct GameState
+{
+    unsigned int tick;  // Número de passos já executados
+    double time;        // Tempo da simulação, em segundos: tick * dt
+    bool started;
+    float startTime;
+
+    CharacterPose pose;      // Os ângulos vêm de "animation", e não da simulação
+    CharacterAnimation animation;
+    bool spacePressed;
+    bool jumpSound;          // Um pulo começou neste passo
+
+    //Matriz que guarda o deslocamento e resizing do torso jogador
+    glm::mat4 chestModel;
+
+    ObstaclePool obstacles;
+
+    int movement;
+    double timeWhenSpacePressed;
+    double timeWhenLeftPressed;
+    double timeWhenRightPressed;
+    int track;
+
+    // Gerador de números aleatórios próprio da partida
+    std::minstd_rand random;
+};
+
+// Coloca a partida no estado inicial, com o gerador inicializado com "seed"
+void ResetGameState(GameState& s, unsigned int seed);
+// Executa um passo de "dt" segundos: aplica as teclas e move personagem e obstáculos
+void SimulationStep(GameState& s, const std::vector<InputEvent>& input, double dt);
+void ApplyInputEvent(GameState& s, const InputEvent& event);
 
 //Teste de colisão do jogador com o plano do chão
 bool PlayerFloorColision(float floorY, float playerLowerY);
 //Teste de colisão do joagor com um obstáculo
-bool PlayerObstacleColision(glm::mat4 &m, float height, float width, float depth, char type);
-//Função que monta o personagem e trata de sua movimentação
-void BuildCharacter(double currentTime, GLint model_uniform, GLint render_as_black_uniforms, GLuint program_id);
+bool PlayerObstacleColision(const GameState& s, const glm::mat4& m, int type);
+//Testa a caixa do personagem, deslocada de "motion" durante o passo, contra os triângulos do obstáculo
+bool PlayerObstacleMeshColision(const float player[6], const glm::mat4& m, int type, const float motion[3]);
+//Termina a partida quando o personagem bate em um obstáculo
+void KillPlayer(GameState& s);
+//Função que trata da movimentação do personagem (um passo da simulação)
+void UpdateCharacter(GameState& s, double dt);
 //Cria cada um dos obstáculos randomicamente
-void AddRandomObstacles();
-//Função que itera sobre os obstáculos e os move
-void MoveObstacles();
-//Testa se o obstáculo está no campo de visão do jogador
-bool IsBehind(const glm::mat4& m);
+void AddRandomObstacles(GameState& s);
+//Testa as colisões com os obstáculos na posição do fim do passo e remove os que ficaram para trás
+void UpdateObstacles(GameState& s, double dt);
+//Calcula a transformação de cada obstáculo no instante "time"; "out" deve ter espaço para MAX_OBSTACLES matrizes
+void ObstacleTransforms(const ObstaclePool& obstacles, double time, glm::mat4* out);
+//Funções que adicionam, removem e copiam obstáculos
+bool ObstaclePool_Add(ObstaclePool& pool, int type, int lane, double spawnTime, const glm::mat4& base);
+void ObstaclePool_Remove(ObstaclePool& pool, size_t i);
+void ObstaclePool_Copy(const ObstaclePool& from, ObstaclePool& to);
+//Calcula as caixas de colisão (centro e metade do tamanho) do personagem e dos obstáculos
+void PlayerBox(const GameState& s, float box[6]);
+void ObstacleBoxes(const glm::mat4* transforms, const unsigned char* types, size_t count, float* boxes);
+//Calcula o deslocamento de cada obstáculo durante um passo
+void ObstacleMotion(const glm::mat4* transforms, const float* speeds, size_t count, float dt, float* motion);
+#ifndef NDEBUG
+//Desenha as caixas de colisão dos obstáculos e os nós das suas BVHs
+void DrawCollisionBoxes(const ObstaclePool& obstacles, const glm::mat4* transforms);
+#endif
+
+// Partida mostrada na tela. Pertence à thread da simulação.
+GameState g_Game;
+
+// Modo "--batch N": simula N partidas independentes, sem renderização, em
+// paralelo, e mostra quantas partidas por segundo são simuladas com 1 até
+// "--threads" threads.
+int RunBatch(int num_games, int max_threads, unsigned int seed);
+int RunBenchmarks(const char* json_filename);
+
+CharacterPose LerpCharacterPose(const CharacterPose& a, const CharacterPose& b, float alpha);
+//Função que monta o personagem na pose dada
+void BuildCharacter(const CharacterPose& pose, GLint render_as_black_uniform);
+
+// Estado imutável publicado pela simulação a cada passo: tudo o que a
+// renderização precisa para desenhar um quadro. A simulação roda em uma
+// thread própria (no modo com janela) e a renderização só lê o snapshot mais
+// recente, através de um buffer triplo sem travas.
+struct FrameSnapshot
+{
+    CharacterPose previousPose; // Pose no passo anterior
+    CharacterPose currentPose;  // Pose neste passo
+    double time;                // Tempo da simulação após este passo
+    double gameTime;            // GameState::time após este passo
+    bool started;
+    CharacterAnimation animation;
+    float points;               // Pontuação mostrada no HUD
+    ObstaclePool obstacles;
+};
+
+TripleBuffer<FrameSnapshot> g_Snapshots;
+
+// Pose do personagem antes do último passo da simulação
+CharacterPose g_PreviousPose;
+
+// Teclas que alteram o estado do jogo não são tratadas diretamente em
+// KeyCallback(): são enfileiradas e aplicadas pela simulação no início do
+// próximo passo, na thread da simulação. Na tela inicial a thread da
+// simulação dorme em g_PendingInputAdded até chegar uma tecla.
+std::vector<InputEvent> g_PendingInput;
+std::mutex g_PendingInputMutex;
+std::condition_variable g_PendingInputAdded;
+
+// Executa os passos de simulação pendentes até o instante "now" e publica o
+// snapshot resultante
+void AdvanceSimulation(double now);
+void FillSnapshot(FrameSnapshot& snapshot);
+void SimulationThread();
+std::atomic<bool> g_SimulationRunning(false);
 
-//Matriz que guarda o deslocamento e resizing do torso jogador
-glm::mat4 chestModel;
 
 // Estrutura que representa um modelo geométrico carregado a partir de um
 // arquivo ".obj". Veja https://en.wikipedia.org/wiki/Wavefront_.obj_file .
@@ -119,6 +580,9 @@ struct ObjModel
 void BuildTrianglesAndAddToVirtualScene(ObjModel*); // Constrói representação de um ObjModel como malha de triângulos para renderização
 void DrawPlane(GLint render_as_black_uniform);
 void ComputeNormals(ObjModel* model); // Computa normais de um ObjModel, caso não existam.
+void ModelTriangles(ObjModel* model, std::vector<float>& triangles); // Copia as posições dos vértices de cada triângulo
+void BuildObstacleShape(int type, ObjModel* model); // Constrói a forma de colisão de um tipo de obstáculo a partir da sua malha
+void LoadObstacleShapes(); // Carrega os modelos dos obstáculos só para construir as formas de colisão (modos sem janela)
 GLuint BuildTriangles(); // Constrói triângulos para renderização
 void LoadShadersFromFiles(); // Carrega os shaders de vértice e fragmento, criando um programa de GPU
 void LoadTextureImage(const char* filename); // Função que carrega imagens de textura
@@ -161,6 +625,18 @@ struct SceneObject2
     glm::vec3    bbox_max;
 };
 
+// Atributos e índices de um ObjModel montados por BuildModelVertices(), antes
+// de serem copiados para a GPU
+struct ModelVertices
+{
+    std::vector<GLuint>       indices;
+    std::vector<float>        model_coefficients;
+    std::vector<float>        normal_coefficients;
+    std::vector<float>        texture_coefficients;
+    std::vector<SceneObject2> objects;
+};
+void BuildModelVertices(ObjModel* model, ModelVertices& out);
+
 // Abaixo definimos variáveis globais utilizadas em várias funções do código.
 
 // A cena virtual é uma lista de objetos nomeados, guardados em um dicionário
@@ -197,7 +673,6 @@ float default_camera_yaw = PI / 2;
 float camera_yaw = default_camera_yaw;
 float g_CameraDistance = 3.5f; // Distância da câmera para a origem
 
-glm::vec4 camera_position_c  = glm::vec4(-0.05f, 2.0f, -6.3f, 1.0f); // Ponto "c", centro da câmera
 glm::vec4 camera_up_vector   = glm::vec4(0.0f,1.0f,0.0f,0.0f); // Vetor "up"
 glm::vec4 camera_view_vector = glm::vec4(cos(camera_yaw) * cos(camera_pitch) , sin(camera_pitch), sin(camera_yaw) * cos(camera_pitch), 0.0f);
 glm::vec4 w = -camera_view_vector;
@@ -205,81 +680,29 @@ glm::vec4 u = crossproduct(camera_up_vector, w);
 
 bool free_cam_enabled = true;
 
-/**
-    OBSTACLES
-*/
-
-std::list<glm::mat4> cows;
-std::list<glm::mat4> blockades;
-std::list<glm::mat4> busses;
-
-/**
-    MOVIMENTACAO
-*/
+void BuildCamera(GLint view_uniform, GLint projection_uniform, const glm::vec4& camera_position);
 
-int movement = 0;
-double timeWhenSpacePressed = 0;
-double timeWhenLeftPressed = 0;
-double timeWhenRightPressed = 0;
-char legUp = 'n';
-char prevLegUp = 'n';
+void fall(GameState& s, double dt);
+void jump(GameState& s, double dt);
 
-int track = 1;
+// Movimentos das articulações usados para gerar os clipes de animação
+void liftLeftLeg(CharacterPose& pose, double dt);
+void liftRightLeg(CharacterPose& pose, double dt);
+void fallAngles(CharacterPose& pose, double dt);
+void lowLeftLeg(CharacterPose& pose, double dt);
+void lowRightLeg(CharacterPose& pose, double dt);
+void moveLeftArmBackwards(CharacterPose& pose, int dir, double dt);
+void moveRightArmBackwards(CharacterPose& pose, int dir, double dt);
+void moveLeftArmForwards(CharacterPose& pose, int dir, double dt);
+void moveRightArmForwards(CharacterPose& pose, int dir, double dt);
 
-bool started = false;
-
-// Variáveis que controlam rotação do antebraço direito
-float g_RightForearmAngleZ = 0.0f;
-float g_RightForearmAngleX = 0.0f;
-
-// Variáveis que controlam rotação do antebraço esquerdo
-float g_LeftForearmAngleZ = 0.0f;
-float g_LeftForearmAngleX = 0.0f;
-
-// Variáveis que controlam rotação do braço direito
-float g_RightArmAngleX = 0.0f;
-float g_RightArmAngleZ = 0.0f;
-
-// Variáveis que controlam rotação do braço esquerdo
-float g_LeftArmAngleX = 0.0f;
-float g_LeftArmAngleZ = 0.0f;
-
-// Variáveis que controlam translação do torso
-float g_TorsoPositionX = 0.0f;
-float g_TorsoPositionY = 0.0f;
-
-// Variáveis que controlam rotação da perna esquerda
-float g_LeftLegAngleX = 0.0f;
-float g_LeftLegAngleZ = 0.0f;
-
-// Variáveis que controlam rotação da perna direita
-float g_RightLegAngleX = 0.0f;
-float g_RightLegAngleZ = 0.0f;
-
-// Variáveis que controlam rotação da canela esquerda
-float g_LeftLowerLegAngleX = 0.0f;
-float g_LeftLowerLegAngleZ = 0.0f;
-
-// Variáveis que controlam rotação da canela direita
-float g_RightLowerLegAngleX = 0.0f;
-float g_RightLowerLegAngleZ = 0.0f;
-
-float startTime = 0;
-
-void BuildCamera(GLint view_uniform, GLint projection_uniform);
-
-void liftLeftLeg();
-void liftRightLeg();
-void fall();
-void jump();
-void smoothTransition();
-void clearAngles();
-void lowLeftLeg();
-void lowRightLeg();
-void moveLeftArmBackwards(int dir);
-void moveRightArmBackwards(int dir);
-void moveLeftArmForwards(int dir);
-void moveRightArmForwards(int dir);
+float* PoseAngles(CharacterPose& pose);
+void BuildAnimationClips(); // Gera as tabelas de pose dos clipes do personagem
+// Troca o clipe tocado, com uma transição de "blendDuration" segundos
+void PlayAnimation(CharacterAnimation& a, int clip, double time, float blendDuration);
+// Ângulos de "count" personagens no instante "time": um vetor de "count"
+// floats para cada um dos CHARACTER_POSE_ANGLES ângulos
+void EvaluateCharacterAnimations(const CharacterAnimation* animations, size_t count, double time, float* angles);
 
 
 // Variável que controla o tipo de projeção utilizada: perspectiva ou ortográfica.
@@ -287,7 +710,12 @@ bool g_UsePerspectiveProjection = true;
 
 // Variável que controla se o texto informativo será mostrado na tela.
 bool g_ShowInfoText = true;
-double timeDelta;
+
+// Variáveis que controlam os desenhos de depuração (veja "debugdraw.cpp"):
+// eixos XYZ do mundo e de cada cubo do personagem, e caixas de colisão dos
+// obstáculos junto com os nós das suas BVHs.
+bool g_ShowAxes = false;
+bool g_ShowCollisionBoxes = false;
 
 // Variáveis que definem um programa de GPU (shaders). Veja função LoadShadersFromFiles().
 GLuint vertex_shader_id;
@@ -300,81 +728,362 @@ GLint object_id_uniform;
 GLint bbox_min_uniform;
 GLint bbox_max_uniform;
 GLint render_as_black_uniform;
+GLint draw_character_uniform;
+GLint cube_outline_uniform;
+GLint specular_uniform;
+GLint character_poses_uniform;
 
 // Número de texturas carregadas pela função LoadTextureImage()
 GLuint g_NumLoadedTextures = 0;
 
+// Modo "headless" (argumento "--headless N"): renderiza N frames em um FBO,
+// sem janela, avançando o tempo em passos fixos de 1/60 s. Com "--dump DIR"
+// cada frame é salvo como PNG em DIR, e "--start" inicia o jogo como se ENTER
+// tivesse sido pressionado.
+bool g_Headless = false;
+int g_HeadlessFrames = 0;
+const char* g_HeadlessDumpDir = NULL;
+double g_HeadlessTime = 0.0;
+
+// Modo "--software": junto com "--headless N", renderiza na CPU (arquivo
+// "softrender.cpp") sem nenhum contexto OpenGL.
+bool g_SoftwareRendering = false;
+
+// Número máximo de threads ("--threads N") do modo "--software" e do modo
+// "--batch" (padrão: número de núcleos).
+int g_NumThreads = 0;
+
+// Tempo atual em segundos: o relógio da GLFW, ou o tempo simulado no modo headless.
+double GameTime()
+{
+    return g_Headless ? g_HeadlessTime : glfwGetTime();
+}
+
+// Funções que enviam o estado de desenho para a GPU ou, no modo "--software",
+// para o renderizador por software. Equivalem às chamadas OpenGL de mesmo nome.
+// Com OpenGL passam pelo cache de "glstate.cpp", que descarta (e conta) as
+// chamadas redundantes.
+void SetModelMatrix(const glm::mat4& M)
+{
+    if (g_SoftwareRendering)
+    {
+        Profiler_CountUniforms(1);
+        SoftRender_SetModel(M);
+    }
+    else
+        GlState_UniformMatrix4fv(model_uniform, glm::value_ptr(M));
+}
+
+void SetObjectId(int object_id)
+{
+    if (g_SoftwareRendering)
+    {
+        Profiler_CountUniforms(1);
+        SoftRender_SetObjectId(object_id);
+    }
+    else
+        GlState_Uniform1i(object_id_uniform, object_id);
+}
+
+void SetRenderAsBlack(GLint render_as_black_uniform, bool render_as_black)
+{
+    if (!g_SoftwareRendering)
+        GlState_Uniform1i(render_as_black_uniform, render_as_black);
+}
+
+// O renderizador por software não desenha as arestas dos cubos
+void SetCubeOutline(bool cube_outline)
+{
+    if (!g_SoftwareRendering)
+        GlState_Uniform1i(cube_outline_uniform, cube_outline);
+}
+
+void BindVertexArray(GLuint vertex_array_object_id)
+{
+    if (g_SoftwareRendering)
+    {
+        Profiler_CountStateChanges(1);
+        SoftRender_BindVertexArray(vertex_array_object_id);
+    }
+    else
+        GlState_BindVertexArray(vertex_array_object_id);
+}
+
+// O renderizador por software só desenha triângulos; linhas (arestas dos
+// cubos e eixos) são ignoradas.
+void DrawElements(GLenum mode, GLsizei count, void* first_index)
+{
+    Profiler_CountDrawCalls(1);
+    if (!g_SoftwareRendering)
+        glDrawElements(mode, count, GL_UNSIGNED_INT, first_index);
+    else if (mode == GL_TRIANGLES)
+        SoftRender_DrawElements((size_t)first_index / sizeof(GLuint), count);
+}
+
+// Desenho instanciado; só usado com OpenGL
+void DrawElementsInstanced(GLenum mode, GLsizei count, void* first_index, GLsizei instances)
+{
+    Profiler_CountDrawCalls(1);
+    glDrawElementsInstanced(mode, count, GL_UNSIGNED_INT, first_index, instances);
+}
+
 //int main()
 int main(int argc, char* argv[])
 {
-    // Inicializamos a biblioteca GLFW, utilizada para criar uma janela do
-    // sistema operacional, onde poderemos renderizar com OpenGL.
-    int success = glfwInit();
-    if (!success)
+    // Tratamos os argumentos de linha de comando. O primeiro argumento que
+    // não é uma opção é o nome de um modelo ".obj" extra a ser carregado.
+    const char* extra_model_filename = NULL;
+    const char* record_filename = NULL;
+    const char* replay_filename = NULL;
+    bool autostart = false;
+    bool seeded = false;
+    int batch_games = 0;
+    const char* trace_filename = NULL;
+    const char* bench_filename = NULL;
+    const char* capture_filename = NULL;
+    int capture_first_frame = 60;
+    int capture_num_frames = 60;
+    const char* glreplay_filename = NULL;
+    double dynres_target_ms = 0.0;
+    const char* quality_name = "medium";
+    const char* quality_filename = NULL;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--headless" && i + 1 < argc)
+        {
+            g_Headless = true;
+            g_HeadlessFrames = atoi(argv[++i]);
+        }
+        else if (arg == "--dump" && i + 1 < argc)
+            g_HeadlessDumpDir = argv[++i];
+        else if (arg == "--start")
+            autostart = true;
+        else if (arg == "--software")
+            g_SoftwareRendering = true;
+        else if (arg == "--threads" && i + 1 < argc)
+            g_NumThreads = atoi(argv[++i]);
+        else if (arg == "--record" && i + 1 < argc)
+            record_filename = argv[++i];
+        else if (arg == "--replay" && i + 1 < argc)
+            replay_filename = argv[++i];
+        else if (arg == "--trace" && i + 1 < argc)
+            trace_filename = argv[++i];
+        else if (arg == "--bench" && i + 1 < argc)
+            bench_filename = argv[++i];
+        else if (arg == "--capture" && i + 1 < argc)
+            capture_filename = argv[++i];
+        else if (arg == "--capture-frames" && i + 2 < argc)
+        {
+            capture_first_frame = atoi(argv[++i]);
+            capture_num_frames = atoi(argv[++i]);
+        }
+        else if (arg == "--glreplay" && i + 1 < argc)
+            glreplay_filename = argv[++i];
+        else if (arg == "--dynres" && i + 1 < argc)
+            dynres_target_ms = atof(argv[++i]);
+        else if (arg == "--quality" && i + 1 < argc)
+            quality_name = argv[++i];
+        else if (arg == "--quality-config" && i + 1 < argc)
+            quality_filename = argv[++i];
+        else if (arg == "--batch" && i + 1 < argc)
+            batch_games = atoi(argv[++i]);
+        else if (arg == "--seed" && i + 1 < argc)
+        {
+            g_RandomSeed = (unsigned int)strtoul(argv[++i], NULL, 10);
+            seeded = true;
+        }
+        else if (arg.compare(0, 2, "--") != 0 && !extra_model_filename)
+            extra_model_filename = argv[i];
+        else
+            fprintf(stderr, "WARNING: ignoring argument \"%s\".\n", argv[i]);
+    }
+
+    GLFWwindow* window = NULL;
+
+    if (g_SoftwareRendering && !g_Headless)
+    {
+        fprintf(stderr, "ERROR: --software requires --headless N.\n");
+        std::exit(EXIT_FAILURE);
+    }
+
+    if (g_SoftwareRendering && capture_filename)
+    {
+        fprintf(stderr, "ERROR: --capture requires OpenGL.\n");
+        std::exit(EXIT_FAILURE);
+    }
+
+    if (g_SoftwareRendering && dynres_target_ms > 0.0)
     {
-        fprintf(stderr, "ERROR: glfwInit() failed.\n");
+        fprintf(stderr, "ERROR: --dynres requires OpenGL.\n");
         std::exit(EXIT_FAILURE);
     }
 
-    // Definimos o callback para impressão de erros da GLFW no terminal
-    glfwSetErrorCallback(ErrorCallback);
+    // A captura não grava as chamadas de framebuffer e renderbuffer usadas
+    // pela resolução dinâmica; a reprodução desenharia quadros errados
+    if (capture_filename && dynres_target_ms > 0.0)
+    {
+        fprintf(stderr, "ERROR: --capture cannot be combined with --dynres.\n");
+        std::exit(EXIT_FAILURE);
+    }
 
-    // Pedimos para utilizar OpenGL versão 3.3 (ou superior)
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    // O arquivo de configuração parte do nível escolhido com "--quality"
+    if (!Quality_SetPreset(g_Quality, quality_name))
+        std::exit(EXIT_FAILURE);
+    if (quality_filename && !Quality_LoadFile(g_Quality, quality_filename))
+        std::exit(EXIT_FAILURE);
 
-    // Pedimos para utilizar o perfil "core", isto é, utilizaremos somente as
-    // funções modernas de OpenGL.
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    // A resolução dinâmica amplia a cena com glBlitFramebuffer(), que não
+    // aceita um destino com várias amostras por pixel
+    if (dynres_target_ms > 0.0 && g_Quality.msaa_samples > 0)
+    {
+        fprintf(stderr, "WARNING: MSAA is disabled with --dynres.\n");
+        g_Quality.msaa_samples = 0;
+    }
 
-    // Criamos uma janela do sistema operacional, com 800 colunas e 480 linhas
-    // de pixels, e com título "INF01047 ...".
-    GLFWwindow* window;
-    window = glfwCreateWindow(800, 800, "Vale Surfers | INF01047 - Julia Eidelwein (00274700) & Lucas Hagen (00274698)", NULL, NULL);
+    // O modo "--glreplay" só reproduz as chamadas OpenGL gravadas, sem o jogo.
+    // Com "--dump DIR" salva os quadros reproduzidos.
+    if (glreplay_filename)
+        return GlCapture_Replay(glreplay_filename, g_HeadlessDumpDir);
 
-    if (!window)
+    // Na reprodução a semente vem da gravação. Com "--headless 0" renderizamos
+    // quantos quadros forem necessários para chegar ao fim da gravação.
+    if (replay_filename)
     {
-        glfwTerminate();
-        fprintf(stderr, "ERROR: glfwCreateWindow() failed.\n");
+        if (!InputLog_OpenRead(replay_filename, SIM_TICK_RATE, &g_RandomSeed, &g_ReplayLastTick,
+                               &g_Quality.spawn_near, &g_Quality.spawn_far, &g_Quality.behind_z))
+            std::exit(EXIT_FAILURE);
+        g_Replaying = true;
+        if (g_Headless && g_HeadlessFrames <= 0)
+            g_HeadlessFrames = (int)std::ceil(g_ReplayLastTick * SIM_DT * 60.0) + 1;
+    }
+    else if (!seeded)
+        g_RandomSeed = (unsigned int)time(NULL);
+
+    if (record_filename && !InputLog_OpenWrite(record_filename, g_RandomSeed, SIM_TICK_RATE,
+                                               g_Quality.spawn_near, g_Quality.spawn_far, g_Quality.behind_z))
         std::exit(EXIT_FAILURE);
+
+    // O modo "--batch" não abre janela nem cria contexto OpenGL
+    if (batch_games > 0)
+        return RunBatch(batch_games, g_NumThreads, g_RandomSeed);
+
+    // Tabelas de pose do personagem, usadas ao desenhar e no "--bench"
+    BuildAnimationClips();
+
+    // O modo "--bench" também roda somente na CPU
+    if (bench_filename)
+        return RunBenchmarks(bench_filename);
+
+    if (g_SoftwareRendering)
+    {
+        // Sem GPU: todo o pipeline (vértices, rasterização e iluminação) roda na CPU.
+        if (!SoftRender_Init(800, 800, g_NumThreads))
+            std::exit(EXIT_FAILURE);
+        FramebufferSizeCallback(NULL, 800, 800);
     }
+    else if (g_Headless)
+    {
+        // Sem janela: criamos um contexto OpenGL offscreen e desenhamos em um FBO.
+        if (!Headless_Init(800, 800, g_Quality.msaa_samples))
+            std::exit(EXIT_FAILURE);
+        FramebufferSizeCallback(NULL, 800, 800);
+    }
+    else
+    {
+        // Inicializamos a biblioteca GLFW, utilizada para criar uma janela do
+        // sistema operacional, onde poderemos renderizar com OpenGL.
+        int success = glfwInit();
+        if (!success)
+        {
+            fprintf(stderr, "ERROR: glfwInit() failed.\n");
+            std::exit(EXIT_FAILURE);
+        }
 
-    // Definimos a função de callback que será chamada sempre que o usuário
-    // pressionar alguma tecla do teclado ...
-    glfwSetKeyCallback(window, KeyCallback);
-    // ... ou clicar os botões do mouse ...
-    glfwSetMouseButtonCallback(window, MouseButtonCallback);
-    // ... ou movimentar o cursor do mouse em cima da janela ...
-    glfwSetCursorPosCallback(window, CursorPosCallback);
-    // ... ou rolar a "rodinha" do mouse.
-    glfwSetScrollCallback(window, ScrollCallback);
+        // Definimos o callback para impressão de erros da GLFW no terminal
+        glfwSetErrorCallback(ErrorCallback);
 
-    // Definimos a função de callback que será chamada sempre que a janela for
-    // redimensionada, por consequência alterando o tamanho do "framebuffer"
-    // (região de memória onde são armazenados os pixels da imagem).
-    glfwSetFramebufferSizeCallback(window, FramebufferSizeCallback);
-    glfwSetWindowSize(window, 800, 800); // Forçamos a chamada do callback acima, para definir g_ScreenRatio.
+        // Pedimos para utilizar OpenGL versão 3.3 (ou superior)
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
 
-    // Indicamos que as chamadas OpenGL deverão renderizar nesta janela
-    glfwMakeContextCurrent(window);
+        // Pedimos para utilizar o perfil "core", isto é, utilizaremos somente as
+        // funções modernas de OpenGL.
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
-    // Carregamento de todas funções definidas por OpenGL 3.3, utilizando a
-    // biblioteca GLAD.
-    gladLoadGLLoader((GLADloadproc) glfwGetProcAddress);
+        // Amostras por pixel do framebuffer da janela (MSAA)
+        glfwWindowHint(GLFW_SAMPLES, g_Quality.msaa_samples);
 
-    // Imprimimos no terminal informações sobre a GPU do sistema
-    const GLubyte *vendor      = glGetString(GL_VENDOR);
-    const GLubyte *renderer    = glGetString(GL_RENDERER);
-    const GLubyte *glversion   = glGetString(GL_VERSION);
-    const GLubyte *glslversion = glGetString(GL_SHADING_LANGUAGE_VERSION);
+#ifndef NDEBUG
+        // Contexto de depuração, para as mensagens de GL_KHR_debug (gldebug.cpp)
+        glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, GL_TRUE);
+#endif
 
-    printf("GPU: %s, %s, OpenGL %s, GLSL %s\n", vendor, renderer, glversion, glslversion);
+        // Criamos uma janela do sistema operacional, com 800 colunas e 480 linhas
+        // de pixels, e com título "INF01047 ...".
+        window = glfwCreateWindow(800, 800, "Vale Surfers | INF01047 - Julia Eidelwein (00274700) & Lucas Hagen (00274698)", NULL, NULL);
 
-    // Carregamos os shaders de vértices e de fragmentos que serão utilizados
-    // para renderização. Veja slide 217 e 219 do documento no Moodle
-    // "Aula_03_Rendering_Pipeline_Grafico.pdf".
+        if (!window)
+        {
+            glfwTerminate();
+            fprintf(stderr, "ERROR: glfwCreateWindow() failed.\n");
+            std::exit(EXIT_FAILURE);
+        }
 
-    LoadShadersFromFiles();
+        // Definimos a função de callback que será chamada sempre que o usuário
+        // pressionar alguma tecla do teclado ...
+        glfwSetKeyCallback(window, KeyCallback);
+        // ... ou clicar os botões do mouse ...
+        glfwSetMouseButtonCallback(window, MouseButtonCallback);
+        // ... ou movimentar o cursor do mouse em cima da janela ...
+        glfwSetCursorPosCallback(window, CursorPosCallback);
+        // ... ou rolar a "rodinha" do mouse.
+        glfwSetScrollCallback(window, ScrollCallback);
+        // ... ou quando parte da janela precisa ser redesenhada.
+        glfwSetWindowRefreshCallback(window, WindowRefreshCallback);
+
+        // Definimos a função de callback que será chamada sempre que a janela for
+        // redimensionada, por consequência alterando o tamanho do "framebuffer"
+        // (região de memória onde são armazenados os pixels da imagem).
+        glfwSetFramebufferSizeCallback(window, FramebufferSizeCallback);
+        glfwSetWindowSize(window, 800, 800); // Forçamos a chamada do callback acima, para definir g_ScreenRatio.
+
+        // Indicamos que as chamadas OpenGL deverão renderizar nesta janela
+        glfwMakeContextCurrent(window);
+
+        // Carregamento de todas funções definidas por OpenGL 3.3, utilizando a
+        // biblioteca GLAD.
+        gladLoadGLLoader((GLADloadproc) glfwGetProcAddress);
+    }
+
+    if (!g_SoftwareRendering)
+    {
+        // Imprimimos no terminal informações sobre a GPU do sistema
+        const GLubyte *vendor      = glGetString(GL_VENDOR);
+        const GLubyte *renderer    = glGetString(GL_RENDERER);
+        const GLubyte *glversion   = glGetString(GL_VERSION);
+        const GLubyte *glslversion = glGetString(GL_SHADING_LANGUAGE_VERSION);
+
+        printf("GPU: %s, %s, OpenGL %s, GLSL %s\n", vendor, renderer, glversion, glslversion);
+
+        // Erros e avisos do driver passam a chegar por um callback (só nas
+        // compilações de depuração)
+        GlDebug_Init(g_Headless ? (GLADloadproc) Headless_GetProcAddress : (GLADloadproc) glfwGetProcAddress);
+
+        // A captura grava toda a inicialização, a partir daqui
+        if (capture_filename && !GlCapture_Open(capture_filename, capture_first_frame, capture_num_frames))
+            std::exit(EXIT_FAILURE);
+
+        // Carregamos os shaders de vértices e de fragmentos que serão utilizados
+        // para renderização. Veja slide 217 e 219 do documento no Moodle
+        // "Aula_03_Rendering_Pipeline_Grafico.pdf".
+
+        LoadShadersFromFiles();
+    }
+    else
+        SoftRender_SetSpecular(g_Quality.specular);
+
+    Quality_Print(g_Quality);
 
     // Carregamos duas imagens para serem utilizadas como textura
     LoadTextureImage("../../data/tc-earth_daymap_surface.jpg");      // TextureImage0
@@ -395,37 +1104,54 @@ int main(int argc, char* argv[])
     ComputeNormals(&planemodel);
     BuildTrianglesAndAddToVirtualScene(&planemodel);
 
-    ObjModel blockade("../../data/roadBlockade.obj");
+    ObjModel blockade(g_ObstacleKinds[OBSTACLE_BLOCKADE].model);
     ComputeNormals(&blockade);
     BuildTrianglesAndAddToVirtualScene(&blockade);
+    BuildObstacleShape(OBSTACLE_BLOCKADE, &blockade);
 
-    ObjModel busmodel("../../data/bus.obj");
+    ObjModel busmodel(g_ObstacleKinds[OBSTACLE_BUS].model);
     ComputeNormals(&busmodel);
     BuildTrianglesAndAddToVirtualScene(&busmodel);
+    BuildObstacleShape(OBSTACLE_BUS, &busmodel);
 
-    ObjModel cowmodel("../../data/cow.obj");
+    ObjModel cowmodel(g_ObstacleKinds[OBSTACLE_COW].model);
     ComputeNormals(&cowmodel);
     BuildTrianglesAndAddToVirtualScene(&cowmodel);
+    BuildObstacleShape(OBSTACLE_COW, &cowmodel);
 
-    if ( argc > 1 )
+    if ( extra_model_filename )
     {
-        ObjModel model(argv[1]);
+        ObjModel model(extra_model_filename);
         BuildTrianglesAndAddToVirtualScene(&model);
     }
 
     // Construímos a representação de um triângulo
     GLuint vertex_array_object_id = BuildTriangles();
 
-    // Inicializamos o código para renderização de texto.
-    TextRendering_Init();
-
-    // Habilitamos o Z-buffer. Veja slide 66 do documento "Aula_13_Clipping_and_Culling.pdf".
-    glEnable(GL_DEPTH_TEST);
+    if (!g_SoftwareRendering)
+    {
+        // Inicializamos o código para renderização de texto.
+        TextRendering_Init();
+        DebugDraw_Init();
+        if (dynres_target_ms > 0.0 && !DynRes_Init(dynres_target_ms))
+            std::exit(EXIT_FAILURE);
+
+        // A inicialização acima chama o OpenGL diretamente; a partir daqui
+        // o estado passa pelo cache de "glstate.cpp".
+        GlState_Reset();
+
+        // Habilitamos o Z-buffer. Veja slide 66 do documento "Aula_13_Clipping_and_Culling.pdf".
+        GlState_Enable(GL_DEPTH_TEST);
+
+        // Habilitamos o Backface Culling. Veja slides 22 à 34 do documento "Aula_13_Clipping_and_Culling.pdf".
+        GlState_Enable(GL_CULL_FACE);
+        glCullFace(GL_BACK);
+        glFrontFace(GL_CCW);
+    }
 
-    // Habilitamos o Backface Culling. Veja slides 22 à 34 do documento "Aula_13_Clipping_and_Culling.pdf".
-    glEnable(GL_CULL_FACE);
-    glCullFace(GL_BACK);
-    glFrontFace(GL_CCW);
+    // As consultas de tempo de GPU precisam de um contexto OpenGL
+    Profiler_Init(!g_SoftwareRendering, trace_filename != NULL);
+    Profiler_SetThreadName("Render");
 
     // Variáveis auxiliares utilizadas para chamada à função
     // TextRendering_ShowModelViewProjection(), armazenando matrizes 4x4.
@@ -433,16 +1159,81 @@ int main(int argc, char* argv[])
     glm::mat4 the_model;
     glm::mat4 the_view;
 
-    double prevTime = glfwGetTime();
+    if (autostart && !g_Replaying)
+        KeyCallback(window, GLFW_KEY_ENTER, 0, GLFW_PRESS, 0);
+
+    double prevTime = GameTime();
     double currentTime;
     //double timeDelta;
 
-    // Ficamos em loop, renderizando, até que o usuário feche a janela
-    while (!glfwWindowShouldClose(window))
+    // Snapshot inicial, antes do primeiro passo da simulação
+    g_SimClockBase = prevTime;
+    ResetGameState(g_Game, g_RandomSeed);
+    g_PreviousPose = g_Game.pose;
+    FrameSnapshot initialSnapshot;
+    FillSnapshot(initialSnapshot);
+    g_Snapshots.Reset(initialSnapshot);
+
+    // No modo com janela a simulação roda em paralelo com a renderização. Nos
+    // modos headless ela avança dentro do loop abaixo, em sincronia com os
+    // quadros, para que o resultado seja reproduzível.
+    std::thread simulationThread;
+    if (!g_Headless)
     {
-        currentTime = glfwGetTime();
-        timeDelta = currentTime - prevTime;
+        g_SimulationRunning = true;
+        simulationThread = std::thread(SimulationThread);
+    }
+
+    // Estatísticas de tempo de CPU por frame no modo headless
+    int frame = 0;
+    double frameTimeSum = 0.0;
+    double frameTimeMin = std::numeric_limits<double>::max();
+    double frameTimeMax = 0.0;
+
+    // O jogo começar ou terminar também invalida a imagem da tela inicial
+    bool wasStarted = false;
+    InvalidateFrame();
+
+    // Ficamos em loop, renderizando, até que o usuário feche a janela (ou
+    // até completar o número de frames pedido no modo headless)
+    while (g_Headless ? frame < g_HeadlessFrames : !glfwWindowShouldClose(window))
+    {
+        std::chrono::steady_clock::time_point frameStart = std::chrono::steady_clock::now();
+        Profiler_BeginFrame();
+
+        // O primeiro quadro capturado precisa enviar todo o estado que usa,
+        // inclusive o que o cache descartaria por já ter sido enviado antes
+        if (GlCapture_BeginFrame(frame))
+            GlState_Reset();
+
+        // A resolução da cena segue o tempo de GPU medido alguns quadros atrás
+        DynRes_Update(Profiler_LastGpuTime("Scene"));
+
+        currentTime = GameTime();
         prevTime = currentTime;
+
+        if (g_Headless)
+            AdvanceSimulation(currentTime);
+
+        // Último estado publicado pela simulação
+        const FrameSnapshot& snapshot = g_Snapshots.Read();
+        if (snapshot.started != wasStarted)
+        {
+            wasStarted = snapshot.started;
+            InvalidateFrame();
+        }
+
+        // Fração do próximo passo já decorrida, usada para interpolar o
+        // estado desenhado entre os dois últimos passos
+        const float alpha = (float)std::min(std::max((currentTime - snapshot.time) / SIM_DT, 0.0), 1.0);
+        CharacterPose renderPose = LerpCharacterPose(snapshot.previousPose, snapshot.currentPose, alpha);
+
+        // Os obstáculos e a animação do personagem são calculados no instante
+        // interpolado. Para um só personagem, os vetores de ângulos têm um
+        // elemento e a saída tem a mesma ordem dos campos da pose.
+        const double interpolatedTime = snapshot.gameTime - (snapshot.started ? (1.0 - alpha) * SIM_DT : 0.0);
+        EvaluateCharacterAnimations(&snapshot.animation, 1, interpolatedTime, PoseAngles(renderPose));
+
         // Aqui executamos as operações de renderização
 
         // Definimos a cor do "fundo" do framebuffer como branco.  Tal cor é
@@ -451,40 +1242,51 @@ int main(int argc, char* argv[])
         // Conversaremos sobre sistemas de cores nas aulas de Modelos de Iluminação.
         //
         //           R     G     B     A
-        glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
+        Profiler_BeginGpuScope("Scene");
+        GlDebug_PushGroup("Scene");
+        if (g_SoftwareRendering)
+            SoftRender_BeginFrame(glm::vec3(1.0f, 1.0f, 1.0f));
+        else
+        {
+            DynRes_BeginScene();
+            glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
+
+            // "Pintamos" todos os pixels do framebuffer com a cor definida acima,
+            // e também resetamos todos os pixels do Z-buffer (depth buffer).
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        // "Pintamos" todos os pixels do framebuffer com a cor definida acima,
-        // e também resetamos todos os pixels do Z-buffer (depth buffer).
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            // Pedimos para a GPU utilizar o programa de GPU criado acima (contendo
+            // os shaders de vértice e fragmentos).
+            GlState_UseProgram(program_id);
 
-        // Pedimos para a GPU utilizar o programa de GPU criado acima (contendo
-        // os shaders de vértice e fragmentos).
-        glUseProgram(program_id);
+            // O texto do quadro anterior deixa a mistura de cores ligada e o
+            // teste de profundidade desligado; voltamos ao estado da cena.
+            GlState_DepthFunc(GL_LESS);
+            GlState_Disable(GL_BLEND);
+        }
 
         // "Ligamos" o VAO. Informamos que queremos utilizar os atributos de
         // vértices apontados pelo VAO criado pela função BuildTriangles(). Veja
         // comentários detalhados dentro da definição de BuildTriangles().
-        glBindVertexArray(vertex_array_object_id);
-
-        BuildCamera(view_uniform, projection_uniform);
+        BindVertexArray(vertex_array_object_id);
 
-        BuildCharacter(currentTime, model_uniform, render_as_black_uniform, program_id);
+        BuildCamera(view_uniform, projection_uniform, renderPose.cameraPosition);
 
-        AddRandomObstacles();
+        GlDebug_PushGroup("Character");
+        BuildCharacter(renderPose, render_as_black_uniform);
+        GlDebug_PopGroup();
 
         //glm::mat4 model = Matrix_Identity();
         model = Matrix_Identity();
-        glUniform1i(object_id_uniform, -1);
-        glUniformMatrix4fv(model_uniform, 1, GL_FALSE, glm::value_ptr(model));
+        SetObjectId(-1);
+        SetModelMatrix(model);
         DrawPlane(render_as_black_uniform);
 
         model = Matrix_Identity();
 
         // Enviamos a nova matriz "model" para a placa de vídeo (GPU). Veja o
         // arquivo "shader_vertex.glsl".
-        glUniformMatrix4fv(model_uniform, 1, GL_FALSE, glm::value_ptr(model));
-        glUniformMatrix4fv(view_uniform       , 1 , GL_FALSE , glm::value_ptr(view));
-        glUniformMatrix4fv(projection_uniform , 1 , GL_FALSE , glm::value_ptr(projection));
+        SetModelMatrix(model);
 
         #define SPHERE 0
         #define BUNNY  1
@@ -518,437 +1320,1366 @@ int main(int argc, char* argv[])
         glUniform1i(object_id_uniform, PLANE);
         DrawVirtualObject("plane");*/
 
-        model = Matrix_Translate(1.0f, 10.0f, 0.0f);
+
+        static glm::mat4 obstacleTransforms[MAX_OBSTACLES];
+        {
+        ProfileScope scope("DrawObstacles");
+        GlDebug_PushGroup("Obstacles");
+        static const struct { int objectId; const char* name; } obstacleModels[NUM_OBSTACLE_TYPES] = {
+            { COW,      "cow" },             // OBSTACLE_COW
+            { BLOCKADE, "RoadBlockade_01" }, // OBSTACLE_BLOCKADE
+            { BUS,      "bus" }              // OBSTACLE_BUS
+        };
+        ObstacleTransforms(snapshot.obstacles, interpolatedTime, obstacleTransforms);
+
+        // Desenhamos um tipo de cada vez, para trocar de modelo só três vezes
+        for (int type = 0; type < NUM_OBSTACLE_TYPES; ++type) {
+            for (size_t i = 0; i < snapshot.obstacles.count; ++i) {
+                if (snapshot.obstacles.type[i] != type)
+                    continue;
+                SetModelMatrix(obstacleTransforms[i]);
+                SetObjectId(obstacleModels[type].objectId);
+                DrawVirtualObject(obstacleModels[type].name);
+            }
+        }
+        GlDebug_PopGroup();
+        }
+
+        /*model = Matrix_Identity();
         glUniformMatrix4fv(model_uniform, 1 , GL_FALSE , glm::value_ptr(model));
-        glUniform1i(object_id_uniform, BLOCKADE);
-        DrawVirtualObject("blockade");
+        glUniform1i(object_id_uniform, FLOOR);
+        DrawVirtualObject("floor");*/
 
+        // Itens de depuração: eixos XYZ do mundo (tecla X) e caixas de
+        // colisão dos obstáculos (tecla B)
+        if (g_ShowAxes)
+            DebugDraw_Frame(glm::mat4(1.0f), 1.0f);
+#ifndef NDEBUG
+        if (g_ShowCollisionBoxes)
+            DrawCollisionBoxes(snapshot.obstacles, obstacleTransforms);
+#endif
 
-        std::list<glm::mat4>::iterator it;
-        for (it = cows.begin(); it != cows.end(); ++it) {
-            glUniformMatrix4fv(model_uniform, 1 , GL_FALSE , glm::value_ptr(*it));
-            glUniform1i(object_id_uniform, COW);
-            DrawVirtualObject("cow");
+        // "Desligamos" o VAO, evitando assim que operações posteriores venham a
+        // alterar o mesmo. Isso evita bugs.
+        BindVertexArray(0);
+
+        // Todos os itens de depuração do quadro, com uma chamada de desenho
+        DebugDraw_Flush(view, projection, !g_SoftwareRendering);
+        GlDebug_PopGroup();
+        Profiler_EndGpuScope();
+
+        // Com a resolução dinâmica, a cena é ampliada para a janela antes do
+        // texto, que é desenhado em resolução nativa
+        if (dynres_target_ms > 0.0)
+        {
+            Profiler_BeginGpuScope("Upscale");
+            DynRes_EndScene();
+            Profiler_EndGpuScope();
         }
 
-        for (it = blockades.begin(); it != blockades.end(); ++it) {
-            glUniformMatrix4fv(model_uniform, 1 , GL_FALSE , glm::value_ptr(*it));
-            glUniform1i(object_id_uniform, BLOCKADE);
-            DrawVirtualObject("RoadBlockade_01");
+        // Pegamos um vértice com coordenadas de modelo (0.5, 0.5, 0.5, 1) e o
+        // passamos por todos os sistemas de coordenadas armazenados nas
+        // matrizes the_model, the_view, e the_projection; e escrevemos na tela
+        // as matrizes e pontos resultantes dessas transformações.
+        //glm::vec4 p_model(0.5f, 0.5f, 0.5f, 1.0f);
+        //TextRendering_ShowModelViewProjection(window, the_projection, the_view, the_model, p_model);
+
+        // O renderizador por software não desenha texto.
+        if (!g_SoftwareRendering)
+        {
+            ProfileScope scope("TextRendering");
+            Profiler_BeginGpuScope("Text");
+            GlDebug_PushGroup("Text");
+            TextRendering_ShowPoints(window, snapshot);
+            TextRendering_ShowStartMessage(window, snapshot);
+            Profiler_DrawOverlay(window);
+            GlDebug_PopGroup();
+            Profiler_EndGpuScope();
         }
 
-        for (it = busses.begin(); it != busses.end(); ++it) {
-            glUniformMatrix4fv(model_uniform, 1 , GL_FALSE , glm::value_ptr(*it));
-            glUniform1i(object_id_uniform, BUS);
-            DrawVirtualObject("bus");
-        }
+        GlCapture_EndFrame();
+
+        // O framebuffer onde OpenGL executa as operações de renderização não
+        // é o mesmo que está sendo mostrado para o usuário, caso contrário
+        // seria possível ver artefatos conhecidos como "screen tearing". A
+        // chamada abaixo faz a troca dos buffers, mostrando para o usuário
+        // tudo que foi renderizado pelas funções acima.
+        // Veja o link: Veja o link: https://en.wikipedia.org/w/index.php?title=Multiple_buffering&oldid=793452829#Double_buffering_in_computer_graphics
+        if (g_Headless)
+        {
+            // Sem janela não há troca de buffers: esperamos a renderização
+            // terminar para medir o custo real do frame.
+            {
+                ProfileScope scope("WaitForRenderer");
+                if (g_SoftwareRendering)
+                    SoftRender_EndFrame();
+                else
+                    glFinish();
+            }
+
+            double frameTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - frameStart).count();
+            frameTimeSum += frameTime;
+            frameTimeMin = std::min(frameTimeMin, frameTime);
+            frameTimeMax = std::max(frameTimeMax, frameTime);
+
+            if (g_HeadlessDumpDir)
+            {
+                char filename[512];
+                snprintf(filename, sizeof(filename), "%s/frame_%05d.png", g_HeadlessDumpDir, frame);
+                if (g_SoftwareRendering)
+                    WritePNG(filename, SoftRender_GetPixels(), 800, 800);
+                else
+                    Headless_SaveFrame(filename);
+            }
+
+            g_HeadlessTime += 1.0 / 60.0;
+        }
+        else
+        {
+            {
+                ProfileScope scope("glfwSwapBuffers");
+                glfwSwapBuffers(window);
+            }
+
+            // Verificamos com o sistema operacional se houve alguma interação do
+            // usuário (teclado, mouse, ...). Caso positivo, as funções de callback
+            // definidas anteriormente usando glfwSet*Callback() serão chamadas
+            // pela biblioteca GLFW.
+            glfwPollEvents();
+        }
+
+        Profiler_EndFrame();
+        ++frame;
+
+        // Na tela inicial, o próximo quadro só é desenhado quando algo muda.
+        // Na reprodução de uma gravação as teclas não geram eventos, então a
+        // renderização continua.
+        if (!g_Headless && !g_Replaying && !snapshot.started)
+            WaitForInvalidation(window);
+    }
+
+    if (simulationThread.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lock(g_PendingInputMutex);
+            g_SimulationRunning = false;
+        }
+        g_PendingInputAdded.notify_one();
+        simulationThread.join();
+    }
+
+    GlCapture_Close();
+    Profiler_PrintSummary();
+    DynRes_PrintSummary();
+    if (trace_filename)
+        Profiler_WriteTrace(trace_filename);
+
+    InputLog_CloseWrite(g_Game.tick);
+    if (g_Replaying)
+        printf("Replay: %u of %u ticks, %.2f points\n", g_Game.tick, g_ReplayLastTick,
+               g_Game.started ? g_Game.time - g_Game.startTime : 0.0);
+
+    if (g_Headless)
+    {
+        if (frame > 0)
+            printf("Headless: %d frames, avg %.3f ms, min %.3f ms, max %.3f ms\n",
+                   frame, 1000.0 * frameTimeSum / frame, 1000.0 * frameTimeMin, 1000.0 * frameTimeMax);
+        if (!g_SoftwareRendering)
+            Headless_Terminate();
+        return 0;
+    }
+
+    // Finalizamos o uso dos recursos do sistema operacional
+    glfwTerminate();
+
+    // Fim do programa
+    return 0;
+}
+
+// Número aleatório entre 0 e GAME_RAND_MAX, do gerador da partida
+#define GAME_RAND_MAX ((int)(std::minstd_rand::max() - std::minstd_rand::min()))
+int GameRandom(GameState& s) {
+    return (int)(s.random() - std::minstd_rand::min());
+}
+
+// Z do modelo em que um obstáculo aparece, sorteado na janela do nível de
+// qualidade
+float ObstacleSpawnZ(GameState& s) {
+    return (float)(GameRandom(s) % (g_Quality.spawn_far - g_Quality.spawn_near) + g_Quality.spawn_near);
+}
+
+void AddRandomObstacles(GameState& s) {
+
+    if(s.started){
+        float x = (float)GameRandom(s)/(float)GAME_RAND_MAX;
+
+        // Em média 0.3 obstáculos por segundo, independente de SIM_TICK_RATE
+        if(x <= 0.3 * SIM_DT) {
+
+            float l = (float)GameRandom(s)/(float)(GAME_RAND_MAX/3);
+            int lane;
+            if(l <= 1) {
+                l = -2.5;
+                lane = 0;
+            } else if(l <= 2) {
+                l = 0;
+                lane = 1;
+            } else {
+                l = 2.5;
+                lane = 2;
+            }
+
+            float kind = GameRandom(s)/(float)GAME_RAND_MAX;
+
+            int type;
+            glm::mat4 base;
+            if(kind < 0.06) {
+                type = OBSTACLE_BUS;
+                base = Matrix_Scale(0.25f, 0.3f, 0.3f) * Matrix_Rotate(PI, glm::vec4(0.0f, 1.0f, 0.0f, 0.0f)) *
+                         Matrix_Translate(l * 3.0f, 0.0f, -40.0f);
+            } else if(kind < 0.4) {
+                type = OBSTACLE_COW;
+                base = Matrix_Scale(0.8f, 0.8f, 0.8f) * Matrix_Translate(l, 0.65f, ObstacleSpawnZ(s));
+            } else {
+                type = OBSTACLE_BLOCKADE;
+                base = Matrix_Scale(0.4f, 1.2f, 0.8f) * Matrix_Translate(l * 2.0f, 0.0f, ObstacleSpawnZ(s));
+            }
+            // Se o vetor estiver cheio o obstáculo é descartado
+            ObstaclePool_Add(s.obstacles, type, lane, s.time, base);
+        }
+    }
+}
+
+bool ObstaclePool_Add(ObstaclePool& pool, int type, int lane, double spawnTime, const glm::mat4& base) {
+    if (pool.count == MAX_OBSTACLES)
+        return false;
+    size_t i = pool.count++;
+    pool.base[i] = base;
+    pool.spawnTime[i] = spawnTime;
+    pool.speed[i] = g_ObstacleKinds[type].speed;
+    pool.lane[i] = (unsigned char)lane;
+    pool.type[i] = (unsigned char)type;
+    return true;
+}
+
+void ObstaclePool_Remove(ObstaclePool& pool, size_t i) {
+    size_t last = --pool.count;
+    pool.base[i] = pool.base[last];
+    pool.spawnTime[i] = pool.spawnTime[last];
+    pool.speed[i] = pool.speed[last];
+    pool.lane[i] = pool.lane[last];
+    pool.type[i] = pool.type[last];
+}
+
+// Copia somente os obstáculos em uso
+void ObstaclePool_Copy(const ObstaclePool& from, ObstaclePool& to) {
+    size_t n = from.count;
+    to.count = n;
+    std::copy(from.base, from.base + n, to.base);
+    std::copy(from.spawnTime, from.spawnTime + n, to.spawnTime);
+    std::copy(from.speed, from.speed + n, to.speed);
+    std::copy(from.lane, from.lane + n, to.lane);
+    std::copy(from.type, from.type + n, to.type);
+}
+
+void ObstacleTransforms(const ObstaclePool& obstacles, double time, glm::mat4* out) {
+    float offsets[MAX_OBSTACLES];
+    for (size_t i = 0; i < obstacles.count; ++i)
+        offsets[i] = obstacles.speed[i] * (float)(time - obstacles.spawnTime[i]);
+    std::copy(obstacles.base, obstacles.base + obstacles.count, out);
+    Transform_TranslateZBatch(out, offsets, obstacles.count);
+}
+
+// A caixa do personagem vai do torso até os pés: agora que os obstáculos são
+// testados contra as próprias malhas, um torso sozinho passaria por cima de
+// uma vaca ou de um bloqueio baixo.
+void PlayerBox(const GameState& s, float box[6]) {
+    float bottom = s.chestModel[1][3] - CHARACTER_LEG_HEIGHT;
+    float top = s.chestModel[1][3] + s.chestModel[1][1];
+    box[0] = s.chestModel[0][3] + s.chestModel[0][0]/2;
+    box[1] = (bottom + top)/2;
+    box[2] = s.chestModel[2][3] + s.chestModel[2][2]/2;
+    box[3] = s.chestModel[0][0]/2;
+    box[4] = (top - bottom)/2;
+    box[5] = s.chestModel[2][2]/2;
+}
+
+// "boxes" recebe 6 vetores de "count" floats: cx, cy, cz, hx, hy, hz. A
+// caixa de cada obstáculo é a caixa alinhada aos eixos que envolve a caixa
+// da malha transformada.
+void ObstacleBoxes(const glm::mat4* transforms, const unsigned char* types, size_t count, float* boxes) {
+    for (size_t i = 0; i < count; ++i) {
+        const ObstacleShape& shape = g_ObstacleShapes[types[i]];
+        const glm::mat4& m = transforms[i];
+        glm::vec4 center = m * glm::vec4(shape.center, 1.0f);
+        glm::vec3 half = glm::abs(glm::vec3(m[0])) * shape.half.x + glm::abs(glm::vec3(m[1])) * shape.half.y +
+                         glm::abs(glm::vec3(m[2])) * shape.half.z;
+        for (int k = 0; k < 3; ++k) {
+            boxes[k * count + i] = center[k];
+            boxes[(3 + k) * count + i] = half[k];
+        }
+    }
+}
+
+// "motion" recebe 3 vetores de "count" floats: dx, dy, dz. A translação do
+// obstáculo anda ao longo do eixo Z do modelo (terceira coluna).
+void ObstacleMotion(const glm::mat4* transforms, const float* speeds, size_t count, float dt, float* motion) {
+    for (size_t i = 0; i < count; ++i) {
+        float dz = speeds[i] * dt;
+        motion[i]             = transforms[i][2][0] * dz;
+        motion[count + i]     = transforms[i][2][1] * dz;
+        motion[2 * count + i] = transforms[i][2][2] * dz;
+    }
+}
+
+#ifndef NDEBUG
+// Caixas de colisão dos obstáculos (fase ampla, em vermelho) e os nós das
+// BVHs das suas malhas (fase estreita, em cinza), como itens de depuração
+void DrawCollisionBoxes(const ObstaclePool& obstacles, const glm::mat4* transforms) {
+    static float boxes[6 * MAX_OBSTACLES];
+    size_t count = obstacles.count;
+    ObstacleBoxes(transforms, obstacles.type, count, boxes);
+    for (size_t i = 0; i < count; ++i) {
+        glm::vec3 center(boxes[i], boxes[count + i], boxes[2 * count + i]);
+        glm::vec3 half(boxes[3 * count + i], boxes[4 * count + i], boxes[5 * count + i]);
+        DebugDraw_Aabb(center - half, center + half, glm::vec3(1.0f, 0.0f, 0.0f));
+
+        int bvh = g_ObstacleShapes[obstacles.type[i]].bvh;
+        for (size_t node = 0; node < Bvh_NodeCount(bvh); ++node) {
+            glm::vec3 min, max;
+            Bvh_NodeBounds(bvh, node, min, max);
+            DebugDraw_Box(transforms[i], min, max, glm::vec3(0.3f, 0.3f, 0.3f));
+        }
+    }
+}
+#endif
+
+void UpdateObstacles(GameState& s, double dt) {
+    if(s.started){
+        // Posições no fim deste passo
+        static thread_local glm::mat4 transforms[MAX_OBSTACLES];
+        ObstacleTransforms(s.obstacles, s.time + dt, transforms);
+
+        // Testamos todo o movimento do passo, e não só a posição final, para
+        // que um obstáculo rápido não atravesse o personagem entre dois
+        // passos. Uma colisão termina o jogo e esvazia o vetor.
+        static thread_local float boxes[6 * MAX_OBSTACLES];
+        static thread_local float motion[3 * MAX_OBSTACLES];
+        unsigned int hits[MAX_OBSTACLES];
+        float times[MAX_OBSTACLES];
+        float player[6];
+        PlayerBox(s, player);
+        ObstacleBoxes(transforms, s.obstacles.type, s.obstacles.count, boxes);
+        ObstacleMotion(transforms, s.obstacles.speed, s.obstacles.count, (float)dt, motion);
+        size_t n = Collision_PlayerSweep(player, boxes, motion, s.obstacles.lane, s.obstacles.count, hits, times);
+
+        // As caixas envolvem as malhas; confirmamos contra os triângulos
+        for (size_t h = 0; h < n; ++h) {
+            size_t i = hits[h];
+            const float obstacleMotion[3] = { motion[i], motion[s.obstacles.count + i], motion[2 * s.obstacles.count + i] };
+            if (PlayerObstacleMeshColision(player, transforms[i], s.obstacles.type[i], obstacleMotion)) {
+                KillPlayer(s);
+                return;
+            }
+        }
+
+        // Percorremos de trás para frente: o obstáculo que ocupa o lugar de um
+        // removido já foi testado
+        for (size_t i = s.obstacles.count; i-- > 0; ) {
+            if (transforms[i][3][2] < g_Quality.behind_z)
+                ObstaclePool_Remove(s.obstacles, i);
+        }
+    }
+}
+
+void ResetGameState(GameState& s, unsigned int seed) {
+    s.tick = 0;
+    s.time = 0.0;
+    s.started = false;
+    s.startTime = 0.0f;
+
+    s.pose = CharacterPose();
+    s.pose.cameraPosition = glm::vec4(-0.05f, 2.0f, -6.3f, 1.0f);
+    s.animation.clip = CLIP_IDLE;
+    s.animation.startTime = 0.0;
+    s.animation.fromClip = CLIP_IDLE;
+    s.animation.fromTime = 0.0f;
+    s.animation.blendDuration = 0.0f;
+    s.spacePressed = false;
+    s.jumpSound = false;
+
+    s.chestModel = glm::mat4();
+    s.obstacles.count = 0;
+
+    s.movement = 0;
+    s.timeWhenSpacePressed = 0;
+    s.timeWhenLeftPressed = 0;
+    s.timeWhenRightPressed = 0;
+    s.track = 1;
+
+    s.random.seed(seed);
+}
+
+void SimulationStep(GameState& s, const std::vector<InputEvent>& input, double dt) {
+    s.jumpSound = false;
+    for (size_t i = 0; i < input.size(); ++i)
+        ApplyInputEvent(s, input[i]);
+
+    {
+        ProfileScope scope("UpdateCharacter");
+        UpdateCharacter(s, dt);
+    }
+    {
+        ProfileScope scope("AddRandomObstacles");
+        AddRandomObstacles(s);
+    }
+    {
+        ProfileScope scope("UpdateObstacles");
+        UpdateObstacles(s, dt);
+    }
+
+    ++s.tick;
+    s.time = s.tick * dt;
+}
+
+void AdvanceSimulation(double now) {
+    // Se a simulação ficou muito atrasada, descartamos o tempo excedente
+    // adiantando a origem do relógio; o tempo da simulação não salta.
+    if (now - g_SimClockBase - g_Game.time > SIM_MAX_FRAME_TIME)
+        g_SimClockBase = now - g_Game.time - SIM_MAX_FRAME_TIME;
+
+    bool stepped = false;
+    std::vector<InputEvent> input;
+    while (now - g_SimClockBase - g_Game.time >= SIM_DT) {
+        // A reprodução para no último passo gravado
+        if (g_Replaying && g_Game.tick >= g_ReplayLastTick)
+            break;
+
+        // Aplicamos as teclas pressionadas desde o último passo, ou as que
+        // foram gravadas neste passo quando reproduzindo uma gravação
+        input.clear();
+        if (g_Replaying) {
+            InputEvent event;
+            while (InputLog_Read(g_Game.tick, &event.key, &event.action))
+                input.push_back(event);
+        } else {
+            std::lock_guard<std::mutex> lock(g_PendingInputMutex);
+            input.swap(g_PendingInput);
+        }
+        for (size_t i = 0; i < input.size(); ++i)
+            InputLog_Write(g_Game.tick, input[i].key, input[i].action);
+
+        g_PreviousPose = g_Game.pose;
+        SimulationStep(g_Game, input, SIM_DT);
+        stepped = true;
+
+#ifdef _WIN32
+        if (g_Game.jumpSound)
+            PlaySound(TEXT("../../data/jump.wav"), NULL, SND_ASYNC);
+#endif
+    }
+
+    // Publicamos o novo estado para a renderização
+    if (stepped) {
+        FillSnapshot(g_Snapshots.Write());
+        g_Snapshots.Publish();
+    }
+}
+
+// Copia o estado atual da simulação para o snapshot dado
+void FillSnapshot(FrameSnapshot& snapshot) {
+    snapshot.previousPose = g_PreviousPose;
+    snapshot.currentPose = g_Game.pose;
+    snapshot.time = g_SimClockBase + g_Game.time;
+    snapshot.started = g_Game.started;
+    snapshot.points = (float)g_Game.time - g_Game.startTime;
+    snapshot.gameTime = g_Game.time;
+    snapshot.animation = g_Game.animation;
+    ObstaclePool_Copy(g_Game.obstacles, snapshot.obstacles);
+}
+
+// Thread da simulação: executa os passos no ritmo do relógio e dorme até o próximo
+void SimulationThread() {
+    Profiler_SetThreadName("Simulation");
+    while (g_SimulationRunning) {
+        // Na tela inicial nada muda até uma tecla (ENTER) chegar, então não há
+        // passos a executar. Ao acordar, a origem do relógio é adiantada para
+        // que o tempo parado não vire uma rajada de passos atrasados.
+        if (!g_Game.started && !g_Replaying) {
+            std::unique_lock<std::mutex> lock(g_PendingInputMutex);
+            if (g_PendingInput.empty() && g_SimulationRunning) {
+                g_PendingInputAdded.wait(lock, []() { return !g_PendingInput.empty() || !g_SimulationRunning; });
+                g_SimClockBase = GameTime() - g_Game.time;
+            }
+        }
+
+        AdvanceSimulation(GameTime());
+
+        double wait = g_SimClockBase + g_Game.time + SIM_DT - GameTime();
+        if (wait > 0.0)
+            std::this_thread::sleep_for(std::chrono::duration<double>(wait));
+    }
+}
+
+// Duração máxima de uma partida no modo "--batch", em segundos
+#define BATCH_MAX_TIME 60.0
+
+// Resultado de uma partida do modo "--batch"
+struct BatchResult
+{
+    unsigned int ticks;
+    float points;
+};
+
+// Robô usado no modo "--batch": começa a partida e, a cada passo, pode trocar
+// de pista ou pular, em média uma vez a cada dois segundos para cada tecla.
+void BotInput(const GameState& s, std::minstd_rand& bot, std::vector<InputEvent>& input) {
+    static const int keys[3] = { GLFW_KEY_LEFT, GLFW_KEY_RIGHT, GLFW_KEY_SPACE };
+
+    if (!s.started) {
+        InputEvent event = { GLFW_KEY_ENTER, GLFW_PRESS };
+        input.push_back(event);
+        return;
+    }
+
+    unsigned int r = bot() % (2 * SIM_TICK_RATE);
+    if (r < 3) {
+        InputEvent event = { keys[r], GLFW_PRESS };
+        input.push_back(event);
+    }
+}
+
+// Joga uma partida inteira, até o personagem bater ou até BATCH_MAX_TIME
+BatchResult PlayBatchGame(unsigned int seed) {
+    GameState s;
+    ResetGameState(s, seed);
+    std::minstd_rand bot(seed);
+    bot.discard(1);
+
+    const unsigned int maxTicks = (unsigned int)(BATCH_MAX_TIME * SIM_TICK_RATE);
+    std::vector<InputEvent> input;
+    do {
+        input.clear();
+        BotInput(s, bot, input);
+        SimulationStep(s, input, SIM_DT);
+    } while (s.started && s.tick < maxTicks);
+
+    BatchResult result;
+    result.ticks = s.tick;
+    result.points = (float)s.time - s.startTime;
+    return result;
+}
+
+int RunBatch(int num_games, int max_threads, unsigned int seed) {
+    if (max_threads <= 0)
+        max_threads = (int)std::thread::hardware_concurrency();
+    if (max_threads <= 0)
+        max_threads = 1;
+
+    LoadObstacleShapes();
+
+    printf("Batch: %d games of up to %.0f s, seeds %u..%u\n", num_games, BATCH_MAX_TIME, seed, seed + num_games - 1);
+    printf("threads    games/s   speedup   avg points   avg ticks\n");
+
+    // Medimos com 1, 2, 4, ... threads e com max_threads. As partidas são
+    // independentes do número de threads, então os resultados se repetem.
+    std::vector<BatchResult> results(num_games);
+    double baseline = 0.0;
+    for (int threads = 1; threads <= max_threads; threads = (threads == max_threads) ? threads + 1 : std::min(threads * 2, max_threads)) {
+        std::atomic<int> next(0);
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+        std::vector<std::thread> workers;
+        for (int t = 0; t < threads; ++t) {
+            workers.push_back(std::thread([&]() {
+                for (int i = next++; i < num_games; i = next++)
+                    results[i] = PlayBatchGame(seed + i);
+            }));
+        }
+        for (size_t t = 0; t < workers.size(); ++t)
+            workers[t].join();
+
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        double gamesPerSecond = num_games / elapsed;
+        if (threads == 1)
+            baseline = gamesPerSecond;
+
+        double points = 0.0, ticks = 0.0;
+        for (int i = 0; i < num_games; ++i) {
+            points += results[i].points;
+            ticks += results[i].ticks;
+        }
+        printf("%7d %10.1f %8.2fx %12.2f %11.1f\n", threads, gamesPerSecond, gamesPerSecond / baseline,
+               points / num_games, ticks / num_games);
+    }
+
+    return 0;
+}
+
+// Parâmetros dos casos de RunBenchmarks()
+#define BENCH_MATRICES 64
+#define BENCH_TEXT "Aperte ENTER para comecar  -  1234.56 Points"
+
+struct BenchModel
+{
+    ObjModel* model;
+};
+
+struct BenchObstacles
+{
+    GameState state;
+    std::vector<glm::mat4> obstacles;
+    std::vector<unsigned char> types;
+    std::vector<unsigned char> lanes;
+    std::vector<float> speeds;
+    std::vector<float> boxes;
+    std::vector<float> motion;
+    std::vector<unsigned int> hits;
+    std::vector<float> times;
+};
+
+float BenchAngle(int i) {
+    return 0.01f * (float)(i % 628);
+}
+
+void BenchMatrixTranslate(void*) {
+    float sum = 0.0f;
+    for (int i = 0; i < BENCH_MATRICES; ++i)
+    {
+        glm::mat4 M = Matrix_Translate((float)i, 1.0f, -2.0f);
+        sum += M[3][0];
+    }
+    Bench_Sink(sum);
+}
+
+void BenchGlmTranslate(void*) {
+    float sum = 0.0f;
+    for (int i = 0; i < BENCH_MATRICES; ++i)
+    {
+        glm::mat4 M = glm::translate(glm::mat4(1.0f), glm::vec3((float)i, 1.0f, -2.0f));
+        sum += M[3][0];
+    }
+    Bench_Sink(sum);
+}
+
+void BenchMatrixRotateX(void*) {
+    float sum = 0.0f;
+    for (int i = 0; i < BENCH_MATRICES; ++i)
+    {
+        glm::mat4 M = Matrix_Rotate_X(BenchAngle(i));
+        sum += M[1][1];
+    }
+    Bench_Sink(sum);
+}
+
+void BenchMatrixRotateY(void*) {
+    float sum = 0.0f;
+    for (int i = 0; i < BENCH_MATRICES; ++i)
+    {
+        glm::mat4 M = Matrix_Rotate_Y(BenchAngle(i));
+        sum += M[0][0];
+    }
+    Bench_Sink(sum);
+}
+
+void BenchMatrixRotateZ(void*) {
+    float sum = 0.0f;
+    for (int i = 0; i < BENCH_MATRICES; ++i)
+    {
+        glm::mat4 M = Matrix_Rotate_Z(BenchAngle(i));
+        sum += M[0][0];
+    }
+    Bench_Sink(sum);
+}
+
+void BenchGlmRotate(void*) {
+    float sum = 0.0f;
+    for (int i = 0; i < BENCH_MATRICES; ++i)
+    {
+        glm::mat4 M = glm::rotate(glm::mat4(1.0f), BenchAngle(i), glm::vec3(1.0f, 0.0f, 0.0f));
+        sum += M[1][1];
+    }
+    Bench_Sink(sum);
+}
+
+void BenchMatrixCameraView(void*) {
+    float sum = 0.0f;
+    for (int i = 0; i < BENCH_MATRICES; ++i)
+    {
+        glm::mat4 M = Matrix_Camera_View(glm::vec4((float)i, 2.0f, -6.3f, 1.0f), glm::vec4(0.0f, 0.0f, -1.0f, 0.0f),
+                                   glm::vec4(0.0f, 1.0f, 0.0f, 0.0f));
+        sum += M[3][0];
+    }
+    Bench_Sink(sum);
+}
+
+void BenchGlmLookAt(void*) {
+    float sum = 0.0f;
+    for (int i = 0; i < BENCH_MATRICES; ++i)
+    {
+        glm::mat4 M = glm::lookAt(glm::vec3((float)i, 2.0f, -6.3f), glm::vec3((float)i, 2.0f, -7.3f), glm::vec3(0.0f, 1.0f, 0.0f));
+        sum += M[3][0];
+    }
+    Bench_Sink(sum);
+}
+
+void BenchMatrixPerspective(void*) {
+    float sum = 0.0f;
+    for (int i = 0; i < BENCH_MATRICES; ++i)
+    {
+        glm::mat4 M = Matrix_Perspective(0.5f + BenchAngle(i) * 0.1f, 1.0f, -0.1f, -100.0f);
+        sum += M[0][0];
+    }
+    Bench_Sink(sum);
+}
+
+void BenchGlmPerspective(void*) {
+    float sum = 0.0f;
+    for (int i = 0; i < BENCH_MATRICES; ++i)
+    {
+        glm::mat4 M = glm::perspective(0.5f + BenchAngle(i) * 0.1f, 1.0f, 0.1f, 100.0f);
+        sum += M[0][0];
+    }
+    Bench_Sink(sum);
+}
+
+struct BenchTransforms
+{
+    std::vector<glm::mat4> a;
+    std::vector<glm::mat4> b;
+    std::vector<glm::mat4> out;
+    std::vector<int> parents;
+};
+
+void BenchGlmMultiply(void* data) {
+    BenchTransforms* t = (BenchTransforms*)data;
+    for (size_t i = 0; i < t->a.size(); ++i)
+        t->out[i] = t->a[i] * t->b[i];
+    Bench_Sink(t->out[0][3][0]);
+}
+
+void BenchTransformMultiplyBatch(void* data) {
+    BenchTransforms* t = (BenchTransforms*)data;
+    Transform_MultiplyBatch(t->a.data(), t->b.data(), t->out.data(), t->a.size());
+    Bench_Sink(t->out[0][3][0]);
+}
+
+// Como os obstáculos eram movidos antes de Transform_TranslateBatch()
+void BenchMatrixTranslateProduct(void* data) {
+    BenchTransforms* t = (BenchTransforms*)data;
+    for (size_t i = 0; i < t->out.size(); ++i)
+        t->out[i] = t->out[i] * Matrix_Translate(0.0f, 0.0f, 1e-3f);
+    Bench_Sink(t->out[0][3][2]);
+}
+
+void BenchTransformTranslateBatch(void* data) {
+    BenchTransforms* t = (BenchTransforms*)data;
+    Transform_TranslateBatch(t->out.data(), t->out.size(), glm::vec3(0.0f, 0.0f, 1e-3f));
+    Bench_Sink(t->out[0][3][2]);
+}
+
+void BenchGlmInverse(void* data) {
+    BenchTransforms* t = (BenchTransforms*)data;
+    for (size_t i = 0; i < t->a.size(); ++i)
+        t->out[i] = glm::inverse(t->a[i]);
+    Bench_Sink(t->out[0][3][0]);
+}
+
+void BenchTransformAffineInverseBatch(void* data) {
+    BenchTransforms* t = (BenchTransforms*)data;
+    Transform_AffineInverseBatch(t->a.data(), t->out.data(), t->a.size());
+    Bench_Sink(t->out[0][3][0]);
+}
+
+void BenchTransformEvaluateHierarchy(void* data) {
+    BenchTransforms* t = (BenchTransforms*)data;
+    Transform_EvaluateHierarchy(t->parents.data(), t->a.data(), t->out.data(), t->a.size());
+    Bench_Sink(t->out.back()[3][0]);
+}
 
-        /*model = Matrix_Identity();
-        glUniformMatrix4fv(model_uniform, 1 , GL_FALSE , glm::value_ptr(model));
-        glUniform1i(object_id_uniform, FLOOR);
-        DrawVirtualObject("floor");*/
+void BenchLoadObj(void* data) {
+    const char* filename = (const char*)data;
+    tinyobj::attrib_t attrib;
+    std::vector<tinyobj::shape_t> shapes;
+    std::vector<tinyobj::material_t> materials;
+    std::string err;
+    tinyobj::LoadObj(&attrib, &shapes, &materials, &err, filename, "../../data/", true);
+    Bench_Sink((float)attrib.vertices.size());
+}
 
-        // Pedimos para OpenGL desenhar linhas com largura de 10 pixels.
-        glLineWidth(2.0f);
-
-        // Informamos para a placa de vídeo (GPU) que a variável booleana
-        // "render_as_black" deve ser colocada como "false". Veja o arquivo
-        // "shader_vertex.glsl".
-        glUniform1i(render_as_black_uniform, false);
-
-        // Pedimos para a GPU rasterizar os vértices dos eixos XYZ
-        // apontados pelo VAO como linhas. Veja a definição de
-        // g_VirtualScene["axes"] dentro da função BuildTriangles(), e veja
-        // a documentação da função glDrawElements() em
-        // http://docs.gl/gl3/glDrawElements.
-        glDrawElements(
-            g_VirtualScene["axes"].rendering_mode,
-            g_VirtualScene["axes"].num_indices,
-            GL_UNSIGNED_INT,
-            (void*)g_VirtualScene["axes"].first_index
-        );
+// As normais calculadas sobrescrevem os mesmos índices a cada chamada, então
+// basta descartá-las para repetir o cálculo
+void BenchComputeNormals(void* data) {
+    ObjModel* model = ((BenchModel*)data)->model;
+    model->attrib.normals.clear();
+    ComputeNormals(model);
+    Bench_Sink(model->attrib.normals[0]);
+}
 
-        // "Desligamos" o VAO, evitando assim que operações posteriores venham a
-        // alterar o mesmo. Isso evita bugs.
-        glBindVertexArray(0);
+void BenchBuildModelVertices(void* data) {
+    ModelVertices vertices;
+    BuildModelVertices(((BenchModel*)data)->model, vertices);
+    Bench_Sink(vertices.model_coefficients[0]);
+}
 
-        // Pegamos um vértice com coordenadas de modelo (0.5, 0.5, 0.5, 1) e o
-        // passamos por todos os sistemas de coordenadas armazenados nas
-        // matrizes the_model, the_view, e the_projection; e escrevemos na tela
-        // as matrizes e pontos resultantes dessas transformações.
-        //glm::vec4 p_model(0.5f, 0.5f, 0.5f, 1.0f);
-        //TextRendering_ShowModelViewProjection(window, the_projection, the_view, the_model, p_model);
+void BenchCollision(void* data) {
+    BenchObstacles* b = (BenchObstacles*)data;
+    int hits = 0;
+    for (size_t i = 0; i < b->obstacles.size(); ++i)
+        hits += PlayerObstacleColision(b->state, b->obstacles[i], b->types[i]);
+    Bench_Sink((float)hits);
+}
 
-        TextRendering_ShowPoints(window);
-        TextRendering_ShowStartMessage(window);
+void BenchObstacleBoxes(void* data) {
+    BenchObstacles* b = (BenchObstacles*)data;
+    ObstacleBoxes(b->obstacles.data(), b->types.data(), b->obstacles.size(), b->boxes.data());
+    Bench_Sink(b->boxes[0]);
+}
 
-        // O framebuffer onde OpenGL executa as operações de renderização não
-        // é o mesmo que está sendo mostrado para o usuário, caso contrário
-        // seria possível ver artefatos conhecidos como "screen tearing". A
-        // chamada abaixo faz a troca dos buffers, mostrando para o usuário
-        // tudo que foi renderizado pelas funções acima.
-        // Veja o link: Veja o link: https://en.wikipedia.org/w/index.php?title=Multiple_buffering&oldid=793452829#Double_buffering_in_computer_graphics
-        glfwSwapBuffers(window);
+void BenchCollisionSweep(void* data) {
+    BenchObstacles* b = (BenchObstacles*)data;
+    float player[6];
+    PlayerBox(b->state, player);
+    size_t n = Collision_PlayerSweep(player, b->boxes.data(), b->motion.data(), b->lanes.data(), b->obstacles.size(),
+                                     b->hits.data(), b->times.data());
+    Bench_Sink((float)n);
+}
 
-        // Verificamos com o sistema operacional se houve alguma interação do
-        // usuário (teclado, mouse, ...). Caso positivo, as funções de callback
-        // definidas anteriormente usando glfwSet*Callback() serão chamadas
-        // pela biblioteca GLFW.
-        glfwPollEvents();
+void BenchObstacleTransforms(void* data) {
+    static glm::mat4 transforms[MAX_OBSTACLES];
+    ObstacleTransforms(*(ObstaclePool*)data, 5.0, transforms);
+    Bench_Sink(transforms[0][3][2]);
+}
 
-        MoveObstacles();
-    }
+void BenchTextLayout(void*) {
+    static std::vector<float> quads;
+    TextRendering_LayoutString(BENCH_TEXT, -1.0f, 1.0f, 1.5f / 800, 1.5f / 800, quads);
+    Bench_Sink(quads[0]);
+}
 
-    // Finalizamos o uso dos recursos do sistema operacional
-    glfwTerminate();
+struct BenchAnimation
+{
+    std::vector<CharacterAnimation> animations;
+    std::vector<float> angles;
+};
 
-    // Fim do programa
-    return 0;
+void BenchEvaluateCharacterAnimations(void* data) {
+    BenchAnimation* b = (BenchAnimation*)data;
+    EvaluateCharacterAnimations(b->animations.data(), b->animations.size(), 10.0, b->angles.data());
+    Bench_Sink(b->angles[0]);
 }
 
-void AddRandomObstacles() {
+// Personagens em clipes e instantes sorteados, metade deles no meio de uma
+// transição
+void BenchSetupAnimation(BenchAnimation& b, int count) {
+    std::minstd_rand random(1);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    b.animations.resize(count);
+    for (int i = 0; i < count; ++i) {
+        CharacterAnimation& a = b.animations[i];
+        a.clip = random() % NUM_CHARACTER_CLIPS;
+        a.startTime = 10.0 - 3.0 * unit(random);
+        a.fromClip = random() % NUM_CHARACTER_CLIPS;
+        a.fromTime = 3.0f * unit(random);
+        a.blendDuration = (i % 2) ? 0.0f : 4.0f;
+    }
+    b.angles.resize(CHARACTER_POSE_ANGLES * count);
+}
 
-    if(started){
-        float x = (float)rand()/(float)RAND_MAX;
+struct BenchBvh
+{
+    std::vector<float> triangles;
+    int bvh;
+    glm::mat4 model;
+    std::vector<glm::vec3> centers;    // Centros das caixas
+    std::vector<glm::vec3> origins;    // Origens dos raios
+    std::vector<glm::vec3> directions;
+};
 
-        if(x <= 0.005) {
+void BenchBvhBuild(void* data) {
+    BenchBvh* b = (BenchBvh*)data;
+    int bvh = Bvh_Build(b->triangles.data(), b->triangles.size() / 9);
+    Bench_Sink((float)Bvh_NodeCount(bvh));
+    Bvh_Release(bvh);
+}
 
-            float l = (float)rand()/(float)(RAND_MAX/3);
-            if(l <= 1) {
-                l = -2.5;
-            } else if(l <= 2) {
-                l = 0;
-            } else {
-                l = 2.5;
-            }
+void BenchBvhOverlapsBox(void* data) {
+    BenchBvh* b = (BenchBvh*)data;
+    const glm::vec3 half(0.2f, 0.3f, 0.1f); // Metade da caixa do personagem
+    int hits = 0;
+    for (size_t i = 0; i < b->centers.size(); ++i)
+        hits += Bvh_OverlapsBox(b->bvh, b->model, b->centers[i] - half, b->centers[i] + half);
+    Bench_Sink((float)hits);
+}
 
-            float s = rand()/(float)RAND_MAX;
+void BenchBvhRaycast(void* data) {
+    BenchBvh* b = (BenchBvh*)data;
+    float sum = 0.0f;
+    for (size_t i = 0; i < b->origins.size(); ++i)
+        sum += Bvh_Raycast(b->bvh, b->model, b->origins[i], b->directions[i], 100.0f);
+    Bench_Sink(sum);
+}
 
-            if(s < 0.06)
-                busses.push_back(Matrix_Scale(0.25f, 0.3f, 0.3f) * Matrix_Rotate(PI, glm::vec4(0.0f, 1.0f, 0.0f, 0.0f)) *
-                                 Matrix_Translate(l * 3.0f, 0.0f, -40.0f));
-            else if(s < 0.4)
-                cows.push_back(Matrix_Scale(0.8f, 0.8f, 0.8f) * Matrix_Translate(l, 0.65f, (rand()%40 + 25)));
-            else
-                blockades.push_back(Matrix_Scale(0.4f, 1.2f, 0.8f) * Matrix_Translate(l * 2.0f, 0.0f, (rand()%40 + 25)));
-        }
+// Constrói a BVH e sorteia 1024 caixas dentro da caixa envolvente da malha e
+// 1024 raios saindo de pontos ao redor dela em direção a pontos dentro dela
+void BenchSetupBvh(BenchBvh& b) {
+    b.bvh = Bvh_Build(b.triangles.data(), b.triangles.size() / 9);
+    b.model = Matrix_Scale(0.8f, 0.8f, 0.8f) * Matrix_Translate(0.0f, 0.65f, 0.0f);
+    glm::vec3 min, max;
+    Bvh_Bounds(b.bvh, min, max);
+    min = glm::vec3(b.model * glm::vec4(min, 1.0f));
+    max = glm::vec3(b.model * glm::vec4(max, 1.0f));
+    glm::vec3 size = max - min;
+
+    std::minstd_rand random(1);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    b.centers.clear();
+    b.origins.clear();
+    b.directions.clear();
+    for (int i = 0; i < 1024; ++i) {
+        glm::vec3 inside = min + size * glm::vec3(unit(random), unit(random), unit(random));
+        glm::vec3 around = min + size * glm::vec3(3.0f * unit(random) - 1.0f, 3.0f * unit(random) - 1.0f, 3.0f * unit(random) - 1.0f);
+        b.centers.push_back(inside);
+        b.origins.push_back(around);
+        b.directions.push_back(glm::normalize(inside - around));
     }
 }
 
-bool IsBehind(const glm::mat4& m) {
-    return m[3][2] < -20;
+// Prepara os obstáculos do teste de colisão: todos à frente do personagem,
+// distribuídos nas três pistas, de forma que nenhum deles colida
+void BenchSetupObstacles(BenchObstacles& b, int count) {
+    ResetGameState(b.state, 1);
+    UpdateCharacter(b.state, SIM_DT);
+    b.obstacles.clear();
+    b.types.clear();
+    b.lanes.clear();
+    for (int i = 0; i < count; ++i) {
+        b.obstacles.push_back(Matrix_Translate(-2.0f + 2.0f * (i % 3), 0.0f, -20.0f - 2.0f * i));
+        b.types.push_back(OBSTACLE_COW);
+        b.lanes.push_back(i % 3);
+        b.speeds.push_back(OBSTACLE_SPEED);
+    }
+    b.boxes.resize(6 * count);
+    b.motion.resize(3 * count);
+    b.hits.resize(count);
+    b.times.resize(count);
+    ObstacleBoxes(b.obstacles.data(), b.types.data(), count, b.boxes.data());
+    ObstacleMotion(b.obstacles.data(), b.speeds.data(), count, (float)SIM_DT, b.motion.data());
 }
 
-void MoveObstacles() {
-    if(started){
-        std::list<glm::mat4>::iterator it;
-        for (it = cows.begin(); it != cows.end(); ++it) {
-            (*it) = (*it) * Matrix_Translate(0.0f, 0.0f, -10.0f * timeDelta);
-            PlayerObstacleColision(*it, 1.9f, 1.8f, 0.6f, 'c');
-        }
-        for (it = blockades.begin(); it != blockades.end(); ++it) {
-            (*it) = (*it) * Matrix_Translate(0.0f, 0.0f, -10.0f * timeDelta);
-            PlayerObstacleColision(*it, 1.2f, 1.6f, 0.5f, 'b');
-        }
-        for (it = busses.begin(); it != busses.end(); ++it) {
-            (*it) = (*it) * Matrix_Translate(0.0f, 0.0f, 30.0f * timeDelta);
-            PlayerObstacleColision(*it, 2.5f, 1.8f, 7.5f, 'p');
+int RunBenchmarks(const char* json_filename) {
+    Bench_PrintHeader();
+
+    Bench_Run("matrices/Matrix_Translate", BenchMatrixTranslate, NULL, BENCH_MATRICES);
+    Bench_Run("matrices/glm::translate", BenchGlmTranslate, NULL, BENCH_MATRICES);
+    Bench_Run("matrices/Matrix_Rotate_X", BenchMatrixRotateX, NULL, BENCH_MATRICES);
+    Bench_Run("matrices/Matrix_Rotate_Y", BenchMatrixRotateY, NULL, BENCH_MATRICES);
+    Bench_Run("matrices/Matrix_Rotate_Z", BenchMatrixRotateZ, NULL, BENCH_MATRICES);
+    Bench_Run("matrices/glm::rotate", BenchGlmRotate, NULL, BENCH_MATRICES);
+    Bench_Run("matrices/Matrix_Camera_View", BenchMatrixCameraView, NULL, BENCH_MATRICES);
+    Bench_Run("matrices/glm::lookAt", BenchGlmLookAt, NULL, BENCH_MATRICES);
+    Bench_Run("matrices/Matrix_Perspective", BenchMatrixPerspective, NULL, BENCH_MATRICES);
+    Bench_Run("matrices/glm::perspective", BenchGlmPerspective, NULL, BENCH_MATRICES);
+
+    // Transformações afins quaisquer (translação, rotação e escalamento)
+    {
+        const int count = 256;
+        BenchTransforms t;
+        for (int i = 0; i < count; ++i) {
+            t.a.push_back(Matrix_Translate(0.1f * i, 1.0f, -2.0f) * Matrix_Rotate_Y(BenchAngle(i)) * Matrix_Scale(1.0f, 0.5f, 2.0f));
+            t.b.push_back(Matrix_Rotate_Z(BenchAngle(3 * i)) * Matrix_Translate(0.0f, -0.5f, 0.0f));
+            t.parents.push_back(i / 2 - 1); // Duas árvores binárias, com raízes 0 e 1
         }
-        cows.remove_if(IsBehind);
-        blockades.remove_if(IsBehind);
-        busses.remove_if(IsBehind);
+        t.out = t.a;
+        Bench_Run("transforms/glm operator*/256", BenchGlmMultiply, &t, count);
+        Bench_Run("transforms/Transform_MultiplyBatch/256", BenchTransformMultiplyBatch, &t, count);
+        Bench_Run("transforms/Matrix_Translate product/256", BenchMatrixTranslateProduct, &t, count);
+        Bench_Run("transforms/Transform_TranslateBatch/256", BenchTransformTranslateBatch, &t, count);
+        Bench_Run("transforms/glm::inverse/256", BenchGlmInverse, &t, count);
+        Bench_Run("transforms/Transform_AffineInverseBatch/256", BenchTransformAffineInverseBatch, &t, count);
+        Bench_Run("transforms/Transform_EvaluateHierarchy/256", BenchTransformEvaluateHierarchy, &t, count);
+    }
+
+    // Todos os modelos ".obj" da pasta "data"
+    static const char* models[] = { "bunny", "bus", "cow", "floor", "plane", "roadBlockade", "sphere" };
+    for (size_t i = 0; i < sizeof(models) / sizeof(models[0]); ++i) {
+        std::string filename = std::string("../../data/") + models[i] + ".obj";
+        std::string name = std::string("load/tinyobj::LoadObj/") + models[i] + ".obj";
+        Bench_Run(name.c_str(), BenchLoadObj, (void*)filename.c_str());
+    }
+
+    for (size_t i = 0; i < sizeof(models) / sizeof(models[0]); ++i) {
+        std::string filename = std::string("../../data/") + models[i] + ".obj";
+        ObjModel model(filename.c_str());
+        ComputeNormals(&model);
+        BenchModel b = { &model };
+        size_t vertices = model.attrib.vertices.size() / 3;
+        Bench_Run((std::string("load/ComputeNormals/") + models[i] + ".obj").c_str(), BenchComputeNormals, &b, (double)vertices);
+        Bench_Run((std::string("load/BuildModelVertices/") + models[i] + ".obj").c_str(), BenchBuildModelVertices, &b, (double)vertices);
+    }
+
+    // Formas de colisão usadas nos testes abaixo
+    LoadObstacleShapes();
+
+    // BVH das malhas: construção e consultas em uma instância com a mesma
+    // transformação das vacas na partida
+    static const char* bvhModels[] = { "cow", "bus", "roadBlockade", "bunny" };
+    for (size_t i = 0; i < sizeof(bvhModels) / sizeof(bvhModels[0]); ++i) {
+        std::string filename = std::string("../../data/") + bvhModels[i] + ".obj";
+        ObjModel model(filename.c_str());
+        BenchBvh b;
+        ModelTriangles(&model, b.triangles);
+        size_t triangles = b.triangles.size() / 9;
+        Bench_Run((std::string("bvh/Bvh_Build/") + bvhModels[i] + ".obj").c_str(), BenchBvhBuild, &b, (double)triangles);
+
+        BenchSetupBvh(b);
+        Bench_Run((std::string("bvh/Bvh_OverlapsBox/") + bvhModels[i] + ".obj").c_str(), BenchBvhOverlapsBox, &b, (double)b.centers.size());
+        Bench_Run((std::string("bvh/Bvh_Raycast/") + bvhModels[i] + ".obj").c_str(), BenchBvhRaycast, &b, (double)b.origins.size());
+        Bvh_Release(b.bvh);
+    }
+
+    static const int obstacleCounts[] = { 16, 256, 4096 };
+    for (size_t i = 0; i < sizeof(obstacleCounts) / sizeof(obstacleCounts[0]); ++i) {
+        BenchObstacles b;
+        BenchSetupObstacles(b, obstacleCounts[i]);
+        char name[64];
+        snprintf(name, sizeof(name), "collision/PlayerObstacleColision/%d", obstacleCounts[i]);
+        Bench_Run(name, BenchCollision, &b, obstacleCounts[i]);
+        snprintf(name, sizeof(name), "collision/ObstacleBoxes/%d", obstacleCounts[i]);
+        Bench_Run(name, BenchObstacleBoxes, &b, obstacleCounts[i]);
+        snprintf(name, sizeof(name), "collision/Collision_PlayerSweep/%d", obstacleCounts[i]);
+        Bench_Run(name, BenchCollisionSweep, &b, obstacleCounts[i]);
     }
-}
 
-void BuildCharacter(double currentTime, GLint model_uniform, GLint render_as_black_uniform, GLuint program_id) {
-    glm::mat4 model = Matrix_Identity(); // Transformação inicial = identidade.
-    glUniform1i(object_id_uniform, -1);
+    {
+        static ObstaclePool pool;
+        pool.count = 0;
+        for (int i = 0; i < MAX_OBSTACLES; ++i)
+            ObstaclePool_Add(pool, i % NUM_OBSTACLE_TYPES, 1, 0.01 * i, Matrix_Translate(0.0f, 0.0f, 25.0f + i));
+        char name[64];
+        snprintf(name, sizeof(name), "obstacles/ObstacleTransforms/%d", MAX_OBSTACLES);
+        Bench_Run(name, BenchObstacleTransforms, &pool, MAX_OBSTACLES);
+    }
+
+    static const int characterCounts[] = { 1, 64, 1024 };
+    for (size_t i = 0; i < sizeof(characterCounts) / sizeof(characterCounts[0]); ++i) {
+        BenchAnimation b;
+        BenchSetupAnimation(b, characterCounts[i]);
+        char name[64];
+        snprintf(name, sizeof(name), "animation/EvaluateCharacterAnimations/%d", characterCounts[i]);
+        Bench_Run(name, BenchEvaluateCharacterAnimations, &b, characterCounts[i]);
+    }
 
+    TextRendering_BuildSdfAtlas();
+    Bench_Run("text/TextRendering_LayoutString", BenchTextLayout, NULL, strlen(BENCH_TEXT));
 
-    // Translação inicial do torso
-    model = model * Matrix_Translate(g_TorsoPositionX, g_TorsoPositionY + 1.83, -6.5f);
-    if(started){
-        switch(movement){
+    return Bench_WriteJson(json_filename) ? 0 : EXIT_FAILURE;
+}
+
+void UpdateCharacter(GameState& s, double dt) {
+    // Dimensões e profundidade do torso, utilizadas nos testes de colisão
+    s.chestModel[0][0] = 0.4f;
+    s.chestModel[1][1] = 0.6f;
+    s.chestModel[2][2] = 0.2f;
+    s.chestModel[2][3] = -6.5f;
+
+    if(s.started){
+        switch(s.movement){
         case -1: //Falling
-            if(!PlayerFloorColision(0.0, g_TorsoPositionY)){
-                fall();
+            if(!PlayerFloorColision(0.0, s.pose.torsoPositionY)){
+                fall(s, dt);
             } else {
-                timeWhenSpacePressed = 0;
-                clearAngles();
-                if(started){
-                    movement = 2;
-                    chestModel[1][3] = 1.83;
-                    legUp = 'n';
-                }
+                s.timeWhenSpacePressed = 0;
+                s.movement = 2;
+                s.chestModel[1][3] = 1.83;
+                PlayAnimation(s.animation, CLIP_RUN, s.time, 0.0f);
             }
             break;
         case 1://Jumping
-            if(currentTime - timeWhenSpacePressed < 0.4){
-                jump();
+            if(s.time - s.timeWhenSpacePressed < JUMP_DURATION){
+                jump(s, dt);
             } else {
-                movement = 0;
+                s.movement = 0;
             }
             break;
-        case 2://Running
-            switch(legUp){
-            case 'n': //none
-                if(prevLegUp == 'l' or prevLegUp == 'n'){
-                    liftRightLeg();
-                    moveLeftArmForwards(1);
-                    moveRightArmBackwards(1);
-                    if(g_RightLegAngleX <= -2){
-                        legUp = 'r';
-                    }
-                } else {
-                    liftLeftLeg();
-                    moveRightArmForwards(1);
-                    moveLeftArmBackwards(1);
-                    if(g_LeftLegAngleX <= -2){
-                        legUp = 'l';
-                    }
-                }
-                break;
-            case 'r': //right
-                lowRightLeg();
-                moveLeftArmForwards(-1);
-                moveRightArmBackwards(-1);
-                if(g_RightLegAngleX >= 0){
-                    clearAngles();
-                    prevLegUp = 'r';
-                    legUp = 'n';
-                }
-                break;
-            case 'l': // left
-                lowLeftLeg();
-                moveRightArmForwards(-1);
-                moveLeftArmBackwards(-1);
-                if(g_LeftLegAngleX >= 0){
-                    clearAngles();
-                    prevLegUp = 'l';
-                    legUp = 'n';
-                }
-                break;
-            }
+        case 2://Running: só o clipe CLIP_RUN
             break;
         case 0://Nothing
         default:
-            if(currentTime - timeWhenSpacePressed > 0.47){
-                movement = -1;
+            if(s.time - s.timeWhenSpacePressed > 0.47){
+                s.movement = -1;
+                PlayAnimation(s.animation, CLIP_FALL, s.time, 0.0f);
             }
         }
-        if(chestModel[1][3] < 1.83){
-            chestModel[1][3] = 1.83;
+        if(s.chestModel[1][3] < 1.83){
+            s.chestModel[1][3] = 1.83;
         }
-        if(currentTime - timeWhenRightPressed < 0.4 && timeWhenRightPressed != 0){
-            g_TorsoPositionX = g_TorsoPositionX - 4.3*timeDelta;
-            camera_position_c.x = camera_position_c.x - 4.3*timeDelta;
+        if(s.time - s.timeWhenRightPressed < 0.4 && s.timeWhenRightPressed != 0){
+            s.pose.torsoPositionX = s.pose.torsoPositionX - 4.3*dt;
+            s.pose.cameraPosition.x = s.pose.cameraPosition.x - 4.3*dt;
 
         } else {
-            if(currentTime - timeWhenLeftPressed < 0.4 && timeWhenLeftPressed != 0){
-                g_TorsoPositionX = g_TorsoPositionX + 4.3*timeDelta;
-                camera_position_c.x = camera_position_c.x + 4.3*timeDelta;
+            if(s.time - s.timeWhenLeftPressed < 0.4 && s.timeWhenLeftPressed != 0){
+                s.pose.torsoPositionX = s.pose.torsoPositionX + 4.3*dt;
+                s.pose.cameraPosition.x = s.pose.cameraPosition.x + 4.3*dt;
             } else {
-                switch(track){
+                switch(s.track){
                 case 0:
-                    camera_position_c.x = 1.95f;
-                    g_TorsoPositionX = 2.0f;
-                    chestModel[0][3] = 2.0f;
+                    s.pose.cameraPosition.x = 1.95f;
+                    s.pose.torsoPositionX = 2.0f;
+                    s.chestModel[0][3] = 2.0f;
                     break;
                 case 1:
-                    camera_position_c.x = -0.05f;
-                    g_TorsoPositionX = 0.0f;
-                    chestModel[0][3] = 0.0f;
+                    s.pose.cameraPosition.x = -0.05f;
+                    s.pose.torsoPositionX = 0.0f;
+                    s.chestModel[0][3] = 0.0f;
                     break;
                 case 2:
                 default:
-                    camera_position_c.x = -2.05f;
-                    g_TorsoPositionX = -2.0f;
-                    chestModel[0][3] = -2.0f;
+                    s.pose.cameraPosition.x = -2.05f;
+                    s.pose.torsoPositionX = -2.0f;
+                    s.chestModel[0][3] = -2.0f;
                 }
             }
         }
     }
+}
 
-    //}
-    // Guardamos matriz model atual na pilha
-    PushMatrix(model);
-        // Atualizamos a matriz model (multiplicação à direita) para fazer um escalamento do torso
-        model = model * Matrix_Scale(0.4f, 0.6f, 0.2f);
-        chestModel[0][0] = 0.4f;
-        chestModel[1][1] = 0.6f;
-        chestModel[2][2] = 0.2f;
-        chestModel[2][3] = -6.5f;
-        // Enviamos a matriz "model" para a placa de vídeo (GPU). Veja o
-        // arquivo "shader_vertex.glsl", onde esta é efetivamente
-        // aplicada em todos os pontos.
-        glUniformMatrix4fv(model_uniform, 1, GL_FALSE, glm::value_ptr(model));
-        // Desenhamos um cubo. Esta renderização irá executar o Vertex
-        // Shader definido no arquivo "shader_vertex.glsl", e o mesmo irá
-        // utilizar as matrizes "model", "view" e "projection" definidas
-        // acima e já enviadas para a placa de vídeo (GPU).
-        DrawCube(render_as_black_uniform); // #### TORSO
-    // Tiramos da pilha a matriz model guardada anteriormente
-    PopMatrix(model);
-
-    PushMatrix(model); // Guardamos matriz model atual na pilha
-        model = model * Matrix_Translate(-0.32f, 0.0f, 0.0f); // Atualizamos matriz model (multiplicação à direita) com uma translação para o braço direito
-        PushMatrix(model); // Guardamos matriz model atual na pilha
-            model = model // Atualizamos matriz model (multiplicação à direita) com a rotação do braço direito
-                  * Matrix_Rotate_Z(g_RightArmAngleZ)  // SEGUNDO rotação Z de Euler
-                  * Matrix_Rotate_X(g_RightArmAngleX); // PRIMEIRO rotação X de Euler
-            PushMatrix(model); // Guardamos matriz model atual na pilha
-                model = model * Matrix_Scale(0.15f, 0.47f, 0.15f); // Atualizamos matriz model (multiplicação à direita) com um escalamento do braço direito
-                glUniformMatrix4fv(model_uniform, 1, GL_FALSE, glm::value_ptr(model)); // Enviamos matriz model atual para a GPU
-                DrawCube(render_as_black_uniform); // #### BRAÇO DIREITO // Desenhamos o braço direito
-            PopMatrix(model); // Tiramos da pilha a matriz model guardada anteriormente
-            PushMatrix(model); // Guardamos matriz model atual na pilha
-                model = model * Matrix_Translate(0.0f, -0.5f, 0.0f); // Atualizamos matriz model (multiplicação à direita) com a translação do antebraço direito
-                model = model // Atualizamos matriz model (multiplicação à direita) com a rotação do antebraço direito
-                      * Matrix_Rotate_Z(g_RightForearmAngleZ)  // SEGUNDO rotação Z de Euler
-                      * Matrix_Rotate_X(g_RightForearmAngleX); // PRIMEIRO rotação X de Euler
-                PushMatrix(model); // Guardamos matriz model atual na pilha
-                    model = model * Matrix_Scale(0.15f, 0.38f, 0.15f); // Atualizamos matriz model (multiplicação à direita) com um escalamento do antebraço direito
-                    glUniformMatrix4fv(model_uniform, 1, GL_FALSE, glm::value_ptr(model)); // Enviamos matriz model atual para a GPU
-                    DrawCube(render_as_black_uniform); // #### ANTEBRAÇO DIREITO // Desenhamos o antebraço direito
-                    PushMatrix(model);
-                        model = model * Matrix_Translate(0.0f, -1.1f, 0.0f);
-                        PushMatrix(model);
-                            model = model * Matrix_Scale(0.9f, 0.18f, 0.9f);
-                            glUniformMatrix4fv(model_uniform, 1, GL_FALSE, glm::value_ptr(model));
-                            DrawCube(render_as_black_uniform); // #### MÃO DIREITA
-                    PopMatrix(model);
-                PopMatrix(model);
-            PopMatrix(model);
-        PopMatrix(model);
-    PopMatrix(model);
-
-    PushMatrix(model); // Guardamos matriz model atual na pilha
-        model = model * Matrix_Translate(0.635f, 0.0f, 0.0f); // Atualizamos matriz model (multiplicação à direita) com uma translação para o braço direito
-        PushMatrix(model); // Guardamos matriz model atual na pilha
-            model = model // Atualizamos matriz model (multiplicação à direita) com a rotação do braço direito
-                  * Matrix_Rotate_Z(g_LeftArmAngleZ)  // SEGUNDO rotação Z de Euler
-                  * Matrix_Rotate_X(g_LeftArmAngleX); // PRIMEIRO rotação X de Euler
-            PushMatrix(model);
-                model = model * Matrix_Scale(0.15f, 0.47f, 0.15f);
-                glUniformMatrix4fv(model_uniform, 1, GL_FALSE, glm::value_ptr(model));
-                DrawCube(render_as_black_uniform); // #### BRAÇO ESQUERDO
-            PopMatrix(model);
-            PushMatrix(model);
-                model = model * Matrix_Translate(0.0f, -0.5f, 0.0f);
-                model = model
-                      * Matrix_Rotate_Z(g_LeftForearmAngleZ)
-                      * Matrix_Rotate_X(g_LeftForearmAngleX);
-                PushMatrix(model);
-                    model = model * Matrix_Scale(0.15f, 0.38f, 0.15f);
-                    glUniformMatrix4fv(model_uniform, 1, GL_FALSE, glm::value_ptr(model));
-                    DrawCube(render_as_black_uniform); // #### ANTEBRAÇO ESQUERDO
-                    PushMatrix(model);
-                        model = model * Matrix_Translate(0.0f, -1.1f, 0.0f);
-                        PushMatrix(model);
-                            model = model * Matrix_Scale(0.9f, 0.18f, 0.9f);
-                            glUniformMatrix4fv(model_uniform, 1, GL_FALSE, glm::value_ptr(model));
-                            DrawCube(render_as_black_uniform); // #### MÃO ESQUERDA
-                    PopMatrix(model);
-                PopMatrix(model);
-            PopMatrix(model);
-        PopMatrix(model);
-    PopMatrix(model);
-
-    PushMatrix(model);
-        model = model * Matrix_Translate(-0.315f, 0.05f, 0.0f);
-        model = model * Matrix_Rotate_Y(3.141592) * Matrix_Rotate_X(3.141592);
-        PushMatrix(model);
-            PushMatrix(model);
-                model = model * Matrix_Scale(0.25f, 0.25f, 0.25f);
-                glUniformMatrix4fv(model_uniform, 1, GL_FALSE, glm::value_ptr(model));
-                DrawCube(render_as_black_uniform); // #### CABEÇA
-            PopMatrix(model);
-        PopMatrix(model);
-    PopMatrix(model);
-
-    PushMatrix(model); // Guardamos matriz model atual na pilha
-        model = model * Matrix_Translate(-0.415f, -0.66f, 0.0f); // Atualizamos matriz model (multiplicação à direita) com uma translação para o braço direito
-        model = model
-              * Matrix_Rotate_Z(g_RightLegAngleZ)  // SEGUNDO rotação Z de Euler
-              * Matrix_Rotate_X(g_RightLegAngleX); // PRIMEIRO rotação X de Euler
-        PushMatrix(model); // Guardamos matriz model atual na pilha
-            PushMatrix(model);
-                model = model * Matrix_Scale(0.18f, 0.53f, 0.18f);
-                glUniformMatrix4fv(model_uniform, 1, GL_FALSE, glm::value_ptr(model));
-                DrawCube(render_as_black_uniform); // #### PERNA DIREITA
-            PopMatrix(model);
-            PushMatrix(model);
-                model = model * Matrix_Translate(0.0f, -0.57f, 0.0f);
-                model = model
-                        * Matrix_Rotate_Z(g_RightLowerLegAngleZ)  // SEGUNDO rotação Z de Euler
-                        * Matrix_Rotate_X(g_RightLowerLegAngleX); // PRIMEIRO rotação X de Euler
-                PushMatrix(model);
-                    model = model * Matrix_Scale(0.17f, 0.5f, 0.17f);
-                    glUniformMatrix4fv(model_uniform, 1, GL_FALSE, glm::value_ptr(model));
-                    DrawCube(render_as_black_uniform); // #### CANELA DIREITA
-                    PushMatrix(model);
-                        model = model * Matrix_Translate(0.0f, -1.08f, 0.26f);
-                        PushMatrix(model);
-                            model = model * Matrix_Scale(0.78f, 0.095f, 1.2f);
-                            glUniformMatrix4fv(model_uniform, 1, GL_FALSE, glm::value_ptr(model));
-                            DrawCube(render_as_black_uniform); // #### PÉ DIREITO
-                    PopMatrix(model);
-                PopMatrix(model);
-            PopMatrix(model);
-        PopMatrix(model);
-    PopMatrix(model);
-
-    PushMatrix(model); // Guardamos matriz model atual na pilha
-        model = model * Matrix_Translate(0.2f, 0.0f, 0.0f); // Atualizamos matriz model (multiplicação à direita) com uma translação para o braço direito
-        model = model
-              * Matrix_Rotate_Z(g_LeftLegAngleZ)  // SEGUNDO rotação Z de Euler
-              * Matrix_Rotate_X(g_LeftLegAngleX); // PRIMEIRO rotação X de Euler
-        PushMatrix(model); // Guardamos matriz model atual na pilha
-            PushMatrix(model);
-                model = model * Matrix_Scale(0.18f, 0.53f, 0.18f);
-                glUniformMatrix4fv(model_uniform, 1, GL_FALSE, glm::value_ptr(model));
-                DrawCube(render_as_black_uniform); // #### PERNA ESQUERDA
-            PopMatrix(model);
-            PushMatrix(model);
-                model = model * Matrix_Translate(0.0f, -0.57f, 0.0f);
-                model = model
-                      * Matrix_Rotate_Z(g_LeftLowerLegAngleZ)  // SEGUNDO rotação Z de Euler
-                      * Matrix_Rotate_X(g_LeftLowerLegAngleX); // PRIMEIRO rotação X de Euler
-                PushMatrix(model);
-                    model = model * Matrix_Scale(0.17f, 0.5f, 0.17f);
-                    glUniformMatrix4fv(model_uniform, 1, GL_FALSE, glm::value_ptr(model));
-                    DrawCube(render_as_black_uniform); // #### CANELA ESQUERDA
-                    PushMatrix(model);
-                        model = model * Matrix_Translate(0.0f, -1.08f, 0.26f);
-                        PushMatrix(model);
-                            model = model * Matrix_Scale(0.78f, 0.095f, 1.2f);
-                            glUniformMatrix4fv(model_uniform, 1, GL_FALSE, glm::value_ptr(model));
-                            DrawCube(render_as_black_uniform); // #### PÉ ESQUERDO
-                    PopMatrix(model);
-                PopMatrix(model);
-            PopMatrix(model);
-        PopMatrix(model);
-    PopMatrix(model);
-
-    //model = Matrix_Identity();
-    //model = model * Matrix_Scale(0.5f, 0.5f, 0.5f);
-    //model = model * Matrix_Translate(2.0f, 1.83f, -6.0f);
-    //glUniformMatrix4fv(model_uniform, 1, GL_FALSE, glm::value_ptr(model));
-    //DrawCube(render_as_black_uniform);
-}
-
-void BuildCamera(GLint view_uniform, GLint projection_uniform) {
+// Interpolação linear entre duas poses, campo a campo. Um campo novo em
+// CharacterPose precisa ser incluído aqui.
+CharacterPose LerpCharacterPose(const CharacterPose& a, const CharacterPose& b, float alpha) {
+    CharacterPose r;
+    r.torsoPositionX      = glm::mix(a.torsoPositionX, b.torsoPositionX, alpha);
+    r.torsoPositionY      = glm::mix(a.torsoPositionY, b.torsoPositionY, alpha);
+    r.rightForearmAngleZ  = glm::mix(a.rightForearmAngleZ, b.rightForearmAngleZ, alpha);
+    r.rightForearmAngleX  = glm::mix(a.rightForearmAngleX, b.rightForearmAngleX, alpha);
+    r.leftForearmAngleZ   = glm::mix(a.leftForearmAngleZ, b.leftForearmAngleZ, alpha);
+    r.leftForearmAngleX   = glm::mix(a.leftForearmAngleX, b.leftForearmAngleX, alpha);
+    r.rightArmAngleX      = glm::mix(a.rightArmAngleX, b.rightArmAngleX, alpha);
+    r.rightArmAngleZ      = glm::mix(a.rightArmAngleZ, b.rightArmAngleZ, alpha);
+    r.leftArmAngleX       = glm::mix(a.leftArmAngleX, b.leftArmAngleX, alpha);
+    r.leftArmAngleZ       = glm::mix(a.leftArmAngleZ, b.leftArmAngleZ, alpha);
+    r.leftLegAngleX       = glm::mix(a.leftLegAngleX, b.leftLegAngleX, alpha);
+    r.leftLegAngleZ       = glm::mix(a.leftLegAngleZ, b.leftLegAngleZ, alpha);
+    r.rightLegAngleX      = glm::mix(a.rightLegAngleX, b.rightLegAngleX, alpha);
+    r.rightLegAngleZ      = glm::mix(a.rightLegAngleZ, b.rightLegAngleZ, alpha);
+    r.leftLowerLegAngleX  = glm::mix(a.leftLowerLegAngleX, b.leftLowerLegAngleX, alpha);
+    r.leftLowerLegAngleZ  = glm::mix(a.leftLowerLegAngleZ, b.leftLowerLegAngleZ, alpha);
+    r.rightLowerLegAngleX = glm::mix(a.rightLowerLegAngleX, b.rightLowerLegAngleX, alpha);
+    r.rightLowerLegAngleZ = glm::mix(a.rightLowerLegAngleZ, b.rightLowerLegAngleZ, alpha);
+    r.cameraPosition      = glm::mix(a.cameraPosition, b.cameraPosition, alpha);
+    return r;
+}
+
+// Articulações do personagem. Cada uma é posicionada em relação à sua
+// articulação pai (veja "parents" em BuildCharacter()), que sempre aparece
+// antes dela. As relações seguem a montagem original com a pilha de matrizes:
+// o ombro esquerdo é relativo ao direito, a cabeça e a perna direita ao ombro
+// esquerdo, e a perna esquerda à direita.
+enum CharacterJoint
+{
+    JOINT_TORSO,
+    JOINT_RIGHT_SHOULDER, JOINT_RIGHT_ARM, JOINT_RIGHT_FOREARM, JOINT_RIGHT_HAND,
+    JOINT_LEFT_SHOULDER, JOINT_LEFT_ARM, JOINT_LEFT_FOREARM, JOINT_LEFT_HAND,
+    JOINT_HEAD,
+    JOINT_RIGHT_LEG, JOINT_RIGHT_SHIN, JOINT_RIGHT_FOOT,
+    JOINT_LEFT_LEG, JOINT_LEFT_SHIN, JOINT_LEFT_FOOT,
+    NUM_CHARACTER_JOINTS
+};
+
+// Número de partes do corpo (cubos) em g_CharacterParts
+#define NUM_CHARACTER_PARTS 14
+
+// Personagens por chamada instanciada e vetores de "character_poses" por
+// personagem; devem ser iguais aos de "shader_vertex.glsl"
+#define CHARACTER_MAX_INSTANCES 16
+#define CHARACTER_POSE_VECTORS (1 + NUM_CHARACTER_JOINTS / 2)
+
+// Rotação de uma articulação: PRIMEIRO rotação X de Euler, SEGUNDO rotação Z
+glm::mat4 JointRotation(float angleZ, float angleX) {
+    return Transform_Multiply(Matrix_Rotate_Z(angleZ), Matrix_Rotate_X(angleX));
+}
+
+// Esqueleto do personagem. A transformação local de cada articulação é
+// Translate(t) * JointRotation(angleZ, angleX) * Scale(s), onde os ângulos
+// são os da tabela somados aos campos "poseAngleZ" e "poseAngleX" da pose,
+// quando existem. As mãos e os pés são filhos do antebraço e da canela já
+// escalados. O torso ainda é transladado pela posição da pose.
+struct CharacterJointDesc
+{
+    int parent;
+    float tx, ty, tz;
+    float angleZ, angleX;
+    float CharacterPose::* poseAngleZ;
+    float CharacterPose::* poseAngleX;
+    float sx, sy, sz;
+};
+
+const CharacterJointDesc g_CharacterSkeleton[NUM_CHARACTER_JOINTS] = {
+    { -1,                    0.0f,   1.83f, -6.5f,    0.0f,     0.0f, NULL, NULL, 1.0f, 1.0f, 1.0f },   // TORSO
+    { JOINT_TORSO,          -0.32f,  0.0f,   0.0f,    0.0f,     0.0f, NULL, NULL, 1.0f, 1.0f, 1.0f },   // OMBRO DIREITO
+    { JOINT_RIGHT_SHOULDER,  0.0f,   0.0f,   0.0f,    0.0f,     0.0f, &CharacterPose::rightArmAngleZ, &CharacterPose::rightArmAngleX, 1.0f, 1.0f, 1.0f },
+    { JOINT_RIGHT_ARM,       0.0f,  -0.5f,   0.0f,    0.0f,     0.0f, &CharacterPose::rightForearmAngleZ, &CharacterPose::rightForearmAngleX, 1.0f, 1.0f, 1.0f },
+    { JOINT_RIGHT_FOREARM,   0.0f,  -0.418f, 0.0f,    0.0f,     0.0f, NULL, NULL, 0.15f, 0.38f, 0.15f }, // MÃO DIREITA
+    { JOINT_RIGHT_SHOULDER,  0.635f, 0.0f,   0.0f,    0.0f,     0.0f, NULL, NULL, 1.0f, 1.0f, 1.0f },   // OMBRO ESQUERDO
+    { JOINT_LEFT_SHOULDER,   0.0f,   0.0f,   0.0f,    0.0f,     0.0f, &CharacterPose::leftArmAngleZ, &CharacterPose::leftArmAngleX, 1.0f, 1.0f, 1.0f },
+    { JOINT_LEFT_ARM,        0.0f,  -0.5f,   0.0f,    0.0f,     0.0f, &CharacterPose::leftForearmAngleZ, &CharacterPose::leftForearmAngleX, 1.0f, 1.0f, 1.0f },
+    { JOINT_LEFT_FOREARM,    0.0f,  -0.418f, 0.0f,    0.0f,     0.0f, NULL, NULL, 0.15f, 0.38f, 0.15f }, // MÃO ESQUERDA
+    { JOINT_LEFT_SHOULDER,  -0.315f, 0.05f,  0.0f,    3.141592f, 0.0f, NULL, NULL, 1.0f, 1.0f, 1.0f },  // CABEÇA
+    { JOINT_LEFT_SHOULDER,  -0.415f,-0.66f,  0.0f,    0.0f,     0.0f, &CharacterPose::rightLegAngleZ, &CharacterPose::rightLegAngleX, 1.0f, 1.0f, 1.0f },
+    { JOINT_RIGHT_LEG,       0.0f,  -0.57f,  0.0f,    0.0f,     0.0f, &CharacterPose::rightLowerLegAngleZ, &CharacterPose::rightLowerLegAngleX, 1.0f, 1.0f, 1.0f },
+    { JOINT_RIGHT_SHIN,      0.0f,  -0.54f,  0.0442f, 0.0f,     0.0f, NULL, NULL, 0.17f, 0.5f, 0.17f },  // PÉ DIREITO
+    { JOINT_RIGHT_LEG,       0.2f,   0.0f,   0.0f,    0.0f,     0.0f, &CharacterPose::leftLegAngleZ, &CharacterPose::leftLegAngleX, 1.0f, 1.0f, 1.0f },
+    { JOINT_LEFT_LEG,        0.0f,  -0.57f,  0.0f,    0.0f,     0.0f, &CharacterPose::leftLowerLegAngleZ, &CharacterPose::leftLowerLegAngleX, 1.0f, 1.0f, 1.0f },
+    { JOINT_LEFT_SHIN,       0.0f,  -0.54f,  0.0442f, 0.0f,     0.0f, NULL, NULL, 0.17f, 0.5f, 0.17f }   // PÉ ESQUERDO
+};
+
+// Cada parte do corpo é um cubo escalado, desenhado no sistema de
+// coordenadas de uma articulação
+struct CharacterPartDesc
+{
+    int joint;
+    float sx, sy, sz;
+};
+
+const CharacterPartDesc g_CharacterParts[NUM_CHARACTER_PARTS] = {
+    { JOINT_TORSO,         0.4f,  0.6f,   0.2f  }, // #### TORSO
+    { JOINT_RIGHT_ARM,     0.15f, 0.47f,  0.15f }, // #### BRAÇO DIREITO
+    { JOINT_RIGHT_FOREARM, 0.15f, 0.38f,  0.15f }, // #### ANTEBRAÇO DIREITO
+    { JOINT_RIGHT_HAND,    0.9f,  0.18f,  0.9f  }, // #### MÃO DIREITA
+    { JOINT_LEFT_ARM,      0.15f, 0.47f,  0.15f }, // #### BRAÇO ESQUERDO
+    { JOINT_LEFT_FOREARM,  0.15f, 0.38f,  0.15f }, // #### ANTEBRAÇO ESQUERDO
+    { JOINT_LEFT_HAND,     0.9f,  0.18f,  0.9f  }, // #### MÃO ESQUERDA
+    { JOINT_HEAD,          0.25f, 0.25f,  0.25f }, // #### CABEÇA
+    { JOINT_RIGHT_LEG,     0.18f, 0.53f,  0.18f }, // #### PERNA DIREITA
+    { JOINT_RIGHT_SHIN,    0.17f, 0.5f,   0.17f }, // #### CANELA DIREITA
+    { JOINT_RIGHT_FOOT,    0.78f, 0.095f, 1.2f  }, // #### PÉ DIREITO
+    { JOINT_LEFT_LEG,      0.18f, 0.53f,  0.18f }, // #### PERNA ESQUERDA
+    { JOINT_LEFT_SHIN,     0.17f, 0.5f,   0.17f }, // #### CANELA ESQUERDA
+    { JOINT_LEFT_FOOT,     0.78f, 0.095f, 1.2f  }  // #### PÉ ESQUERDO
+};
+
+// Ângulos (Z, X) de cada articulação na pose dada
+void CharacterJointAngles(const CharacterPose& pose, float* angles) {
+    for (int j = 0; j < NUM_CHARACTER_JOINTS; ++j) {
+        const CharacterJointDesc& d = g_CharacterSkeleton[j];
+        angles[2 * j]     = d.angleZ + (d.poseAngleZ ? pose.*d.poseAngleZ : 0.0f);
+        angles[2 * j + 1] = d.angleX + (d.poseAngleX ? pose.*d.poseAngleX : 0.0f);
+    }
+}
+
+// Envia o esqueleto e as partes do corpo para o programa de GPU. Só muda
+// quando os shaders são recarregados.
+void UploadCharacterSkeleton() {
+    glm::vec4 skeleton[2 * NUM_CHARACTER_JOINTS];
+    for (int j = 0; j < NUM_CHARACTER_JOINTS; ++j) {
+        const CharacterJointDesc& d = g_CharacterSkeleton[j];
+        skeleton[2 * j]     = glm::vec4(d.tx, d.ty, d.tz, (float)d.parent);
+        skeleton[2 * j + 1] = glm::vec4(d.sx, d.sy, d.sz, 0.0f);
+    }
+    glm::vec4 parts[NUM_CHARACTER_PARTS];
+    for (int i = 0; i < NUM_CHARACTER_PARTS; ++i)
+        parts[i] = glm::vec4(g_CharacterParts[i].sx, g_CharacterParts[i].sy, g_CharacterParts[i].sz, (float)g_CharacterParts[i].joint);
+    glUniform4fv(glGetUniformLocation(program_id, "character_skeleton"), 2 * NUM_CHARACTER_JOINTS, glm::value_ptr(skeleton[0]));
+    glUniform4fv(glGetUniformLocation(program_id, "character_parts"), NUM_CHARACTER_PARTS, glm::value_ptr(parts[0]));
+}
+
+// Desenha "count" personagens com uma chamada instanciada a cada
+// CHARACTER_MAX_INSTANCES personagens; as arestas pretas são pintadas junto
+// com as faces. A CPU só envia a posição e os ângulos de cada um; as matrizes
+// das partes são montadas no shader de vértices.
+void DrawCharacters(const CharacterPose* poses, size_t count, GLint render_as_black_uniform) {
+    static float data[4 * CHARACTER_POSE_VECTORS * CHARACTER_MAX_INSTANCES];
+
+    SetObjectId(-1);
+    SetRenderAsBlack(render_as_black_uniform, false);
+    SetCubeOutline(true);
+    GlState_Uniform1i(draw_character_uniform, 1);
+    for (size_t first = 0; first < count; first += CHARACTER_MAX_INSTANCES) {
+        size_t n = std::min(count - first, (size_t)CHARACTER_MAX_INSTANCES);
+        for (size_t i = 0; i < n; ++i) {
+            float* v = data + 4 * CHARACTER_POSE_VECTORS * i;
+            v[0] = poses[first + i].torsoPositionX;
+            v[1] = poses[first + i].torsoPositionY;
+            v[2] = 0.0f;
+            v[3] = 0.0f;
+            CharacterJointAngles(poses[first + i], v + 4);
+        }
+        GlState_Uniform4fv(character_poses_uniform, (GLsizei)(n * CHARACTER_POSE_VECTORS), data);
+
+        DrawElementsInstanced(g_VirtualScene["cube_faces"].rendering_mode, g_VirtualScene["cube_faces"].num_indices,
+                              (void*)g_VirtualScene["cube_faces"].first_index, (GLsizei)(n * NUM_CHARACTER_PARTS));
+    }
+    SetCubeOutline(false);
+    GlState_Uniform1i(draw_character_uniform, 0);
+}
+
+// Matrizes de modelo das partes do personagem, calculadas na CPU a partir do
+// mesmo esqueleto usado pelo shader de vértices
+void CharacterPartModels(const CharacterPose& pose, glm::mat4 models[NUM_CHARACTER_PARTS]) {
+    int parents[NUM_CHARACTER_JOINTS];
+    float angles[2 * NUM_CHARACTER_JOINTS];
+    glm::mat4 locals[NUM_CHARACTER_JOINTS];
+    CharacterJointAngles(pose, angles);
+    for (int j = 0; j < NUM_CHARACTER_JOINTS; ++j) {
+        const CharacterJointDesc& d = g_CharacterSkeleton[j];
+        parents[j] = d.parent;
+        locals[j] = Transform_Multiply(Transform_Multiply(Matrix_Translate(d.tx, d.ty, d.tz), JointRotation(angles[2 * j], angles[2 * j + 1])),
+                                       Matrix_Scale(d.sx, d.sy, d.sz));
+    }
+    locals[JOINT_TORSO] = Transform_Multiply(Matrix_Translate(pose.torsoPositionX, pose.torsoPositionY, 0.0f), locals[JOINT_TORSO]);
+
+    glm::mat4 worlds[NUM_CHARACTER_JOINTS];
+    Transform_EvaluateHierarchy(parents, locals, worlds, NUM_CHARACTER_JOINTS);
+
+    glm::mat4 joints[NUM_CHARACTER_PARTS];
+    glm::mat4 scales[NUM_CHARACTER_PARTS];
+    for (int i = 0; i < NUM_CHARACTER_PARTS; ++i) {
+        joints[i] = worlds[g_CharacterParts[i].joint];
+        scales[i] = Matrix_Scale(g_CharacterParts[i].sx, g_CharacterParts[i].sy, g_CharacterParts[i].sz);
+    }
+    Transform_MultiplyBatch(joints, scales, models, NUM_CHARACTER_PARTS);
+}
+
+void BuildCharacter(const CharacterPose& pose, GLint render_as_black_uniform) {
+    ProfileScope scope("BuildCharacter");
+
+    // No OpenGL as matrizes das partes só são calculadas na CPU para os
+    // eixos de depuração
+    glm::mat4 models[NUM_CHARACTER_PARTS];
+    if (g_SoftwareRendering || g_ShowAxes)
+        CharacterPartModels(pose, models);
+    if (g_ShowAxes) {
+        for (int i = 0; i < NUM_CHARACTER_PARTS; ++i)
+            DebugDraw_Frame(models[i], 1.0f);
+    }
+
+    if (!g_SoftwareRendering) {
+        DrawCharacters(&pose, 1, render_as_black_uniform);
+        return;
+    }
+
+    // O renderizador por software não executa o shader de vértices
+    SetObjectId(-1);
+    for (int i = 0; i < NUM_CHARACTER_PARTS; ++i) {
+        SetModelMatrix(models[i]);
+        DrawCube(render_as_black_uniform);
+    }
+}
+
+void BuildCamera(GLint view_uniform, GLint projection_uniform, const glm::vec4& camera_position) {
+    ProfileScope scope("BuildCamera");
 
     if(free_cam_enabled) {
-        view = Matrix_Camera_View(camera_position_c, camera_view_vector, camera_up_vector);
+        view = Matrix_Camera_View(camera_position, camera_view_vector, camera_up_vector);
     } else {
-        glm::vec4 new_cam_pos = camera_position_c + (-camera_view_vector * g_CameraDistance) / norm(camera_view_vector);
+        glm::vec4 new_cam_pos = camera_position + (-camera_view_vector * g_CameraDistance) / norm(camera_view_vector);
         view = Matrix_Camera_View(new_cam_pos,
                                   camera_view_vector, camera_up_vector);
     }
 
     float nearplane = -0.1f;  // Posição do "near plane"
-    float farplane  = -60.0f; // Posição do "far plane"
+    float farplane  = -g_Quality.far_distance; // Posição do "far plane"
 
     if (g_UsePerspectiveProjection)
     {
@@ -967,11 +2698,45 @@ void BuildCamera(GLint view_uniform, GLint projection_uniform) {
     // Enviamos as matrizes "view" e "projection" para a placa de vídeo
     // (GPU). Veja o arquivo "shader_vertex.glsl", onde estas são
     // efetivamente aplicadas em todos os pontos.
-    glUniformMatrix4fv(view_uniform       , 1 , GL_FALSE , glm::value_ptr(view));
-    glUniformMatrix4fv(projection_uniform , 1 , GL_FALSE , glm::value_ptr(projection));
+    if (g_SoftwareRendering)
+    {
+        SoftRender_SetCamera(view, projection);
+        return;
+    }
+
+    GlState_UniformMatrix4fv(view_uniform       , glm::value_ptr(view));
+    GlState_UniformMatrix4fv(projection_uniform , glm::value_ptr(projection));
 }
 
 
+// GL_EXT_texture_filter_anisotropic (núcleo do OpenGL 4.6), que a GLAD deste
+// projeto não carrega
+#define GL_TEXTURE_MAX_ANISOTROPY_EXT     0x84FE
+#define GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT 0x84FF
+
+// Maior anisotropia aceita pelo driver, ou 1 se não há filtragem anisotrópica
+float MaxTextureAnisotropy()
+{
+    static float max_anisotropy = 0.0f;
+    if (max_anisotropy == 0.0f)
+    {
+        max_anisotropy = 1.0f;
+        GLint num_extensions = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &num_extensions);
+        for (GLint i = 0; i < num_extensions; ++i)
+        {
+            const char* name = (const char*)glGetStringi(GL_EXTENSIONS, i);
+            if (strcmp(name, "GL_EXT_texture_filter_anisotropic") == 0 ||
+                strcmp(name, "GL_ARB_texture_filter_anisotropic") == 0)
+            {
+                glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &max_anisotropy);
+                break;
+            }
+        }
+    }
+    return max_anisotropy;
+}
+
 // Função que carrega uma imagem para ser utilizada como textura
 void LoadTextureImage(const char* filename)
 {
@@ -992,6 +2757,14 @@ void LoadTextureImage(const char* filename)
 
     printf("OK (%dx%d).\n", width, height);
 
+    if (g_SoftwareRendering)
+    {
+        SoftRender_AddTexture(g_NumLoadedTextures, data, width, height);
+        stbi_image_free(data);
+        g_NumLoadedTextures += 1;
+        return;
+    }
+
     // Agora criamos objetos na GPU com OpenGL para armazenar a textura
     GLuint texture_id;
     GLuint sampler_id;
@@ -1006,6 +2779,15 @@ void LoadTextureImage(const char* filename)
     glSamplerParameteri(sampler_id, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
     glSamplerParameteri(sampler_id, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
+    // Um deslocamento positivo escolhe mipmaps menores (mais borrados e mais
+    // baratos de amostrar). Os valores padrão do OpenGL (0 e 1) não precisam
+    // ser enviados.
+    if (g_Quality.lod_bias != 0.0f)
+        glSamplerParameterf(sampler_id, GL_TEXTURE_LOD_BIAS, g_Quality.lod_bias);
+    float anisotropy = std::min(g_Quality.anisotropy, MaxTextureAnisotropy());
+    if (anisotropy > 1.0f)
+        glSamplerParameterf(sampler_id, GL_TEXTURE_MAX_ANISOTROPY_EXT, anisotropy);
+
     // Agora enviamos a imagem lida do disco para a GPU
     glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
     glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
@@ -1018,6 +2800,8 @@ void LoadTextureImage(const char* filename)
     glTexImage2D(GL_TEXTURE_2D, 0, GL_SRGB8, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
     glGenerateMipmap(GL_TEXTURE_2D);
     glBindSampler(textureunit, sampler_id);
+    GlDebug_Label(GL_TEXTURE, texture_id, filename);
+    GlDebug_Label(GL_SAMPLER, sampler_id, filename);
 
     stbi_image_free(data);
 
@@ -1031,29 +2815,36 @@ void DrawVirtualObject(const char* object_name)
     // "Ligamos" o VAO. Informamos que queremos utilizar os atributos de
     // vértices apontados pelo VAO criado pela função BuildTrianglesAndAddToVirtualScene(). Veja
     // comentários detalhados dentro da definição de BuildTrianglesAndAddToVirtualScene().
-    glBindVertexArray(g_VirtualScene2[object_name].vertex_array_object_id);
+    BindVertexArray(g_VirtualScene2[object_name].vertex_array_object_id);
 
     // Setamos as variáveis "bbox_min" e "bbox_max" do fragment shader
     // com os parâmetros da axis-aligned bounding box (AABB) do modelo.
     glm::vec3 bbox_min = g_VirtualScene2[object_name].bbox_min;
     glm::vec3 bbox_max = g_VirtualScene2[object_name].bbox_max;
-    glUniform4f(bbox_min_uniform, bbox_min.x, bbox_min.y, bbox_min.z, 1.0f);
-    glUniform4f(bbox_max_uniform, bbox_max.x, bbox_max.y, bbox_max.z, 1.0f);
+    if (g_SoftwareRendering)
+    {
+        Profiler_CountUniforms(2);
+        SoftRender_SetBBox(glm::vec4(bbox_min, 1.0f), glm::vec4(bbox_max, 1.0f));
+    }
+    else
+    {
+        GlState_Uniform4f(bbox_min_uniform, bbox_min.x, bbox_min.y, bbox_min.z, 1.0f);
+        GlState_Uniform4f(bbox_max_uniform, bbox_max.x, bbox_max.y, bbox_max.z, 1.0f);
+    }
 
     // Pedimos para a GPU rasterizar os vértices dos eixos XYZ
     // apontados pelo VAO como linhas. Veja a definição de
     // g_VirtualScene[""] dentro da função BuildTrianglesAndAddToVirtualScene(), e veja
     // a documentação da função glDrawElements() em
     // http://docs.gl/gl3/glDrawElements.
-    glDrawElements(
+    DrawElements(
         g_VirtualScene2[object_name].rendering_mode,
         g_VirtualScene2[object_name].num_indices,
-        GL_UNSIGNED_INT,
         (void*)g_VirtualScene2[object_name].first_index);
 
-    // "Desligamos" o VAO, evitando assim que operações posteriores venham a
-    // alterar o mesmo. Isso evita bugs.
-    glBindVertexArray(0);
+    // O VAO fica ligado: objetos seguidos com o mesmo modelo (os obstáculos
+    // de um tipo) não precisam ligá-lo de novo. Nenhum código de desenho
+    // altera o VAO ligado.
 }
 
 void LoadShadersFromFiles()
@@ -1062,12 +2853,15 @@ void LoadShadersFromFiles()
     vertex_shader_id = LoadShader_Vertex("../../src/shader_vertex.glsl");
     fragment_shader_id = LoadShader_Fragment("../../src/shader_fragment.glsl");
 
-    // Deletamos o programa de GPU anterior, caso ele exista.
+    // Deletamos o programa de GPU anterior, caso ele exista. O novo programa
+    // pode receber o mesmo identificador, então o estado guardado em
+    // glstate.cpp para o antigo é descartado junto.
     if ( program_id != 0 )
-        glDeleteProgram(program_id);
+        GlState_DeleteProgram(program_id);
 
     // Criamos um programa de GPU utilizando os shaders carregados acima.
     program_id = CreateGpuProgram(vertex_shader_id, fragment_shader_id);
+    GlDebug_Label(GL_PROGRAM, program_id, "Scene");
 
     // Buscamos o endereço das variáveis definidas dentro do Vertex Shader.
     // Utilizaremos estas variáveis para enviar dados para a placa de vídeo
@@ -1079,12 +2873,18 @@ void LoadShadersFromFiles()
     bbox_min_uniform        = glGetUniformLocation(program_id, "bbox_min");
     bbox_max_uniform        = glGetUniformLocation(program_id, "bbox_max");
     render_as_black_uniform = glGetUniformLocation(program_id, "render_as_black");
+    draw_character_uniform  = glGetUniformLocation(program_id, "draw_character");
+    cube_outline_uniform    = glGetUniformLocation(program_id, "cube_outline");
+    specular_uniform        = glGetUniformLocation(program_id, "specular");
+    character_poses_uniform = glGetUniformLocation(program_id, "character_poses");
 
     // Variáveis em "shader_fragment.glsl" para acesso das imagens de textura
     glUseProgram(program_id);
     glUniform1i(glGetUniformLocation(program_id, "TextureImage0"), 0);
     glUniform1i(glGetUniformLocation(program_id, "TextureImage1"), 1);
     glUniform1i(glGetUniformLocation(program_id, "TextureImage2"), 2);
+    glUniform1i(specular_uniform, g_Quality.specular); // Constante durante o jogo
+    UploadCharacterSkeleton();
     glUseProgram(0);
 }
 
@@ -1151,21 +2951,13 @@ void ComputeNormals(ObjModel* model)
     }
 }
 
-// Constrói triângulos para futura renderização a partir de um ObjModel.
-void BuildTrianglesAndAddToVirtualScene(ObjModel* model)
+// Monta, na CPU, os vetores de atributos e de índices de um ObjModel, além
+// de um SceneObject2 por "shape" (sem VAO; veja BuildTrianglesAndAddToVirtualScene()).
+void BuildModelVertices(ObjModel* model, ModelVertices& out)
 {
-    GLuint vertex_array_object_id;
-    glGenVertexArrays(1, &vertex_array_object_id);
-    glBindVertexArray(vertex_array_object_id);
-
-    std::vector<GLuint> indices;
-    std::vector<float>  model_coefficients;
-    std::vector<float>  normal_coefficients;
-    std::vector<float>  texture_coefficients;
-
     for (size_t shape = 0; shape < model->shapes.size(); ++shape)
     {
-        size_t first_index = indices.size();
+        size_t first_index = out.indices.size();
         size_t num_triangles = model->shapes[shape].mesh.num_face_vertices.size();
 
         const float minval = std::numeric_limits<float>::min();
@@ -1182,16 +2974,16 @@ void BuildTrianglesAndAddToVirtualScene(ObjModel* model)
             {
                 tinyobj::index_t idx = model->shapes[shape].mesh.indices[3*triangle + vertex];
 
-                indices.push_back(first_index + 3*triangle + vertex);
+                out.indices.push_back(first_index + 3*triangle + vertex);
 
                 const float vx = model->attrib.vertices[3*idx.vertex_index + 0];
                 const float vy = model->attrib.vertices[3*idx.vertex_index + 1];
                 const float vz = model->attrib.vertices[3*idx.vertex_index + 2];
                 //printf("tri %d vert %d = (%.2f, %.2f, %.2f)\n", (int)triangle, (int)vertex, vx, vy, vz);
-                model_coefficients.push_back( vx ); // X
-                model_coefficients.push_back( vy ); // Y
-                model_coefficients.push_back( vz ); // Z
-                model_coefficients.push_back( 1.0f ); // W
+                out.model_coefficients.push_back( vx ); // X
+                out.model_coefficients.push_back( vy ); // Y
+                out.model_coefficients.push_back( vz ); // Z
+                out.model_coefficients.push_back( 1.0f ); // W
 
                 bbox_min.x = std::min(bbox_min.x, vx);
                 bbox_min.y = std::min(bbox_min.y, vy);
@@ -1205,36 +2997,108 @@ void BuildTrianglesAndAddToVirtualScene(ObjModel* model)
                     const float nx = model->attrib.normals[3*idx.normal_index + 0];
                     const float ny = model->attrib.normals[3*idx.normal_index + 1];
                     const float nz = model->attrib.normals[3*idx.normal_index + 2];
-                    normal_coefficients.push_back( nx ); // X
-                    normal_coefficients.push_back( ny ); // Y
-                    normal_coefficients.push_back( nz ); // Z
-                    normal_coefficients.push_back( 0.0f ); // W
+                    out.normal_coefficients.push_back( nx ); // X
+                    out.normal_coefficients.push_back( ny ); // Y
+                    out.normal_coefficients.push_back( nz ); // Z
+                    out.normal_coefficients.push_back( 0.0f ); // W
                 }
 
                 if ( idx.texcoord_index != -1 )
                 {
                     const float u = model->attrib.texcoords[2*idx.texcoord_index + 0];
                     const float v = model->attrib.texcoords[2*idx.texcoord_index + 1];
-                    texture_coefficients.push_back( u );
-                    texture_coefficients.push_back( v );
+                    out.texture_coefficients.push_back( u );
+                    out.texture_coefficients.push_back( v );
                 }
             }
         }
 
-        size_t last_index = indices.size() - 1;
+        size_t last_index = out.indices.size() - 1;
 
         SceneObject2 theobject;
         theobject.name           = model->shapes[shape].name;
         theobject.first_index    = (void*)first_index; // Primeiro índice
         theobject.num_indices    = last_index - first_index + 1; // Número de indices
         theobject.rendering_mode = GL_TRIANGLES;       // Índices correspondem ao tipo de rasterização GL_TRIANGLES.
-        theobject.vertex_array_object_id = vertex_array_object_id;
+        theobject.vertex_array_object_id = 0;
 
         theobject.bbox_min = bbox_min;
         theobject.bbox_max = bbox_max;
 
-        g_VirtualScene2[model->shapes[shape].name] = theobject;
+        out.objects.push_back(theobject);
     }
+}
+
+// Constrói triângulos para futura renderização a partir de um ObjModel.
+// Posições dos vértices de todos os triângulos do modelo, 9 floats por triângulo
+void ModelTriangles(ObjModel* model, std::vector<float>& triangles)
+{
+    triangles.clear();
+    for (size_t shape = 0; shape < model->shapes.size(); ++shape)
+    {
+        const std::vector<tinyobj::index_t>& indices = model->shapes[shape].mesh.indices;
+        for (size_t i = 0; i < indices.size(); ++i)
+        {
+            const float* v = &model->attrib.vertices[3 * indices[i].vertex_index];
+            triangles.insert(triangles.end(), v, v + 3);
+        }
+    }
+}
+
+void BuildObstacleShape(int type, ObjModel* model)
+{
+    std::vector<float> triangles;
+    ModelTriangles(model, triangles);
+
+    size_t count = triangles.size() / 9;
+    ObstacleShape& s = g_ObstacleShapes[type];
+    s.bvh = Bvh_Build(triangles.data(), count);
+    glm::vec3 min, max;
+    Bvh_Bounds(s.bvh, min, max);
+    s.center = (min + max) * 0.5f;
+    s.half = (max - min) * 0.5f;
+    printf("BVH: %d triângulos, %d nós.\n", (int)count, (int)Bvh_NodeCount(s.bvh));
+}
+
+void LoadObstacleShapes()
+{
+    for (int type = 0; type < NUM_OBSTACLE_TYPES; ++type)
+    {
+        ObjModel model(g_ObstacleKinds[type].model);
+        BuildObstacleShape(type, &model);
+    }
+}
+
+void BuildTrianglesAndAddToVirtualScene(ObjModel* model)
+{
+    ModelVertices vertices;
+    BuildModelVertices(model, vertices);
+
+    const std::vector<GLuint>& indices              = vertices.indices;
+    const std::vector<float>&  model_coefficients   = vertices.model_coefficients;
+    const std::vector<float>&  normal_coefficients  = vertices.normal_coefficients;
+    const std::vector<float>&  texture_coefficients = vertices.texture_coefficients;
+
+    // No modo "--software" os atributos ficam na memória da CPU
+    GLuint vertex_array_object_id = 0;
+    if (g_SoftwareRendering)
+        vertex_array_object_id = SoftRender_AddVertexArray(model_coefficients, normal_coefficients,
+                                                           texture_coefficients, std::vector<float>(), indices);
+    else
+        glGenVertexArrays(1, &vertex_array_object_id);
+
+    for (size_t i = 0; i < vertices.objects.size(); ++i)
+    {
+        vertices.objects[i].vertex_array_object_id = vertex_array_object_id;
+        g_VirtualScene2[vertices.objects[i].name] = vertices.objects[i];
+    }
+
+    if (g_SoftwareRendering)
+        return;
+
+    glBindVertexArray(vertex_array_object_id);
+    if (!vertices.objects.empty())
+        GlDebug_Label(GL_VERTEX_ARRAY, vertex_array_object_id, vertices.objects[0].name.c_str());
 
     GLuint VBO_model_coefficients_id;
     glGenBuffers(1, &VBO_model_coefficients_id);
@@ -1286,226 +3150,262 @@ void BuildTrianglesAndAddToVirtualScene(ObjModel* model)
 }
 
 
-void liftLeftLeg(){
-    g_RightLegAngleX = g_RightLegAngleX + 0.5*timeDelta;
-    g_RightLowerLegAngleX = g_RightLowerLegAngleX + 1*timeDelta;
-    g_LeftLegAngleX = g_LeftLegAngleX - 2.2*timeDelta;
-    g_LeftLowerLegAngleX = g_LeftLowerLegAngleX + 2*timeDelta;
-}
-void liftRightLeg(){
-    g_RightLegAngleX = g_RightLegAngleX - 2.5*timeDelta;
-    g_RightLowerLegAngleX = g_RightLowerLegAngleX + 2*timeDelta;
-    g_LeftLegAngleX = g_LeftLegAngleX + 2.5*timeDelta;
-    g_LeftLowerLegAngleX = g_LeftLowerLegAngleX + 1*timeDelta;
-}
-
-void fall(){
-    g_TorsoPositionY = g_TorsoPositionY - 3*timeDelta;
-    camera_position_c.y = camera_position_c.y - 3*timeDelta;
-    chestModel[1][3] = chestModel[1][3] -3*timeDelta;
-
-    g_LeftForearmAngleZ = g_LeftForearmAngleZ - 1.7*timeDelta;
-    g_LeftForearmAngleX = g_LeftForearmAngleX + 5*timeDelta;
-    g_RightForearmAngleZ = g_RightForearmAngleZ + 1.7*timeDelta;
-    g_RightForearmAngleX = g_RightForearmAngleX + 3*timeDelta;
-
-    g_RightArmAngleX = g_RightArmAngleX + 3*timeDelta;
-    g_RightArmAngleZ = g_RightArmAngleZ + 2*timeDelta;
-    g_LeftArmAngleX = g_LeftArmAngleX + 2*timeDelta;
-    g_LeftArmAngleZ = g_LeftArmAngleZ - 2*timeDelta;
-
-
-    g_RightLegAngleX = g_RightLegAngleX + 2.2*timeDelta;
-    g_RightLegAngleZ = g_RightLegAngleZ + 1*timeDelta;
-    g_RightLowerLegAngleX = g_RightLowerLegAngleX - 3.4*timeDelta;
-    g_RightLowerLegAngleZ = g_RightLowerLegAngleZ - 1*timeDelta;
-    g_LeftLegAngleX = g_LeftLegAngleX + 1*timeDelta;
-    g_LeftLowerLegAngleX = g_LeftLowerLegAngleX - 4.5*timeDelta;
-    g_LeftLegAngleZ = g_LeftLegAngleZ - 1.2*timeDelta;
-}
-bool spacePressed;
-float LeftArmAngleXDelta;
-float RightArmAngleXDelta;
-float LeftForearmAngleXDelta;
-float RightForearmAngleXDelta;
-float LeftLegAngleXDelta;
-float RightLegAngleXDelta;
-float LeftLowerLegAngleXDelta;
-float RightLowerLegAngleXDelta;
-
-float LeftArmAngleZDelta;
-float RightArmAngleZDelta;
-float LeftForearmAngleZDelta;
-float RightForearmAngleZDelta;
-float LeftLegAngleZDelta;
-float RightLegAngleZDelta;
-float LeftLowerLegAngleZDelta;
-float RightLowerLegAngleZDelta;
-
-void jump(){
-    if(spacePressed){
-        spacePressed = false;
-        float desiredLeftArmAngleX = -0.806240;
-        float desiredRightArmAngleX = -1.209359;
-        float desiredLeftForearmAngleX = -2.015599;
-        float desiredRightForearmAngleX = -1.209359;
-        float desiredLeftLegAngleX = -0.403120;
-        float desiredRightLegAngleX = -0.886863;
-        float desiredLeftLowerLegAngleX = 1.814039;
-        float desiredRightLowerLegAngleX = 1.370607;
-
-        float desiredLeftArmAngleZ = 0.806240;
-        float desiredRightArmAngleZ = -0.806240;
-        float desiredLeftForearmAngleZ = 0.685304;
-        float desiredRightForearmAngleZ = -0.685304;
-        float desiredLeftLegAngleZ = 0.483744;
-        float desiredRightLegAngleZ = -0.403120;
-        float desiredLeftLowerLegAngleZ = 0.000000;
-        float desiredRightLowerLegAngleZ = 0.403120;
-
-        float totalIterationTime = 0.4;
-
-        LeftArmAngleXDelta = (desiredLeftArmAngleX - g_LeftArmAngleX);
-        RightArmAngleXDelta = (desiredRightArmAngleX - g_RightArmAngleX);
-        LeftForearmAngleXDelta = (desiredLeftForearmAngleX - g_LeftForearmAngleX);
-        RightForearmAngleXDelta = (desiredRightForearmAngleX - g_RightForearmAngleX);
-        LeftLegAngleXDelta = (desiredLeftLegAngleX - g_LeftLegAngleX);
-        RightLegAngleXDelta = (desiredRightLegAngleX - g_RightLegAngleX);
-        LeftLowerLegAngleXDelta = (desiredLeftLowerLegAngleX - g_LeftLowerLegAngleX);
-        RightLowerLegAngleXDelta = (desiredRightLowerLegAngleX - g_RightLowerLegAngleX);
-
-        LeftArmAngleZDelta = (desiredLeftArmAngleZ - g_LeftArmAngleZ);
-        RightArmAngleZDelta = (desiredRightArmAngleZ - g_RightArmAngleZ);
-        LeftForearmAngleZDelta = (desiredLeftForearmAngleZ - g_LeftForearmAngleZ);
-        RightForearmAngleZDelta = (desiredRightForearmAngleZ - g_RightForearmAngleZ);
-        LeftLegAngleZDelta = (desiredLeftLegAngleZ - g_LeftLegAngleZ);
-        RightLegAngleZDelta = (desiredRightLegAngleZ - g_RightLegAngleZ);
-        LeftLowerLegAngleZDelta = (desiredLeftLowerLegAngleZ - g_LeftLowerLegAngleZ);
-        RightLowerLegAngleZDelta = (desiredRightLowerLegAngleZ - g_RightLowerLegAngleZ);
-
-        LeftArmAngleXDelta = LeftArmAngleXDelta/totalIterationTime;
-        RightArmAngleXDelta = RightArmAngleXDelta/totalIterationTime;
-        LeftForearmAngleXDelta = LeftForearmAngleXDelta/totalIterationTime;
-        RightForearmAngleXDelta = RightForearmAngleXDelta/totalIterationTime;
-        LeftLegAngleXDelta = LeftLegAngleXDelta/totalIterationTime;
-        RightLegAngleXDelta = RightLegAngleXDelta/totalIterationTime;
-        LeftLowerLegAngleXDelta = LeftLowerLegAngleXDelta/totalIterationTime;
-        RightLowerLegAngleXDelta = RightLowerLegAngleXDelta/totalIterationTime;
-
-        LeftArmAngleZDelta = LeftArmAngleZDelta/totalIterationTime;
-        RightArmAngleZDelta = RightArmAngleZDelta/totalIterationTime;
-        LeftForearmAngleZDelta = LeftForearmAngleZDelta/totalIterationTime;
-        RightForearmAngleZDelta = RightForearmAngleZDelta/totalIterationTime;
-        LeftLegAngleZDelta = LeftLegAngleZDelta/totalIterationTime;
-        RightLegAngleZDelta = RightLegAngleZDelta/totalIterationTime;
-        LeftLowerLegAngleZDelta = LeftLowerLegAngleZDelta/totalIterationTime;
-        RightLowerLegAngleZDelta = RightLowerLegAngleZDelta/totalIterationTime;
-    }
-
-    g_TorsoPositionY = g_TorsoPositionY + 3*timeDelta;
-    camera_position_c.y = camera_position_c.y + 3*timeDelta;
-    chestModel[1][3] = chestModel[1][3] + 3*timeDelta;
-
-    g_LeftForearmAngleZ = g_LeftForearmAngleZ + LeftForearmAngleZDelta*timeDelta;
-    g_LeftForearmAngleX = g_LeftForearmAngleX + LeftForearmAngleXDelta*timeDelta;
-    g_RightForearmAngleZ = g_RightForearmAngleZ + RightForearmAngleZDelta*timeDelta;
-    g_RightForearmAngleX = g_RightForearmAngleX + RightForearmAngleXDelta*timeDelta;
-
-    g_RightArmAngleX = g_RightArmAngleX + RightArmAngleXDelta*timeDelta;
-    g_RightArmAngleZ = g_RightArmAngleZ + RightArmAngleZDelta*timeDelta;
-    g_LeftArmAngleX = g_LeftArmAngleX + LeftArmAngleXDelta*timeDelta;
-    g_LeftArmAngleZ = g_LeftArmAngleZ + LeftArmAngleZDelta*timeDelta;
-
-
-    g_RightLegAngleX = g_RightLegAngleX + RightLegAngleXDelta*timeDelta;
-    g_RightLegAngleZ = g_RightLegAngleZ + RightLegAngleZDelta*timeDelta;
-    g_RightLowerLegAngleX = g_RightLowerLegAngleX + RightLowerLegAngleXDelta*timeDelta;
-    g_RightLowerLegAngleZ = g_RightLowerLegAngleZ + RightLowerLegAngleZDelta*timeDelta;
-    g_LeftLegAngleX = g_LeftLegAngleX + LeftLegAngleXDelta*timeDelta;
-    g_LeftLowerLegAngleX = g_LeftLowerLegAngleX + LeftLowerLegAngleXDelta*timeDelta;
-    g_LeftLegAngleZ = g_LeftLegAngleZ + LeftLegAngleZDelta*timeDelta;
-}
-
-void smoothTransition(){
-    int smoothing = 2;
-    g_LeftForearmAngleZ = g_LeftForearmAngleZ/smoothing;
-    g_LeftForearmAngleX = g_LeftForearmAngleX/smoothing;
-    g_RightForearmAngleZ = g_RightForearmAngleZ/smoothing;
-    g_RightForearmAngleX = g_RightForearmAngleX/smoothing;
-
-    g_RightArmAngleX = g_RightArmAngleX/smoothing;
-    g_RightArmAngleZ = g_RightArmAngleZ/smoothing;
-    g_LeftArmAngleX = g_LeftArmAngleX/smoothing;
-    g_LeftArmAngleZ = g_LeftArmAngleZ/smoothing;
-
-
-    g_RightLegAngleX = g_RightLegAngleX/smoothing;
-    g_RightLegAngleZ = g_RightLegAngleZ/smoothing;
-    g_RightLowerLegAngleX = g_RightLowerLegAngleX/smoothing;
-    g_RightLowerLegAngleZ = g_RightLowerLegAngleZ/smoothing;
-    g_LeftLegAngleX = g_LeftLegAngleX/smoothing;
-    g_LeftLowerLegAngleX = g_LeftLowerLegAngleX/smoothing;
-    g_LeftLegAngleZ = g_LeftLegAngleZ/smoothing;
-}
-
-void moveLeftArmForwards(int dir){
-    g_LeftForearmAngleX = g_LeftForearmAngleX - dir*2.3*timeDelta;
+void liftLeftLeg(CharacterPose& pose, double dt){
+    pose.rightLegAngleX = pose.rightLegAngleX + 0.5*dt;
+    pose.rightLowerLegAngleX = pose.rightLowerLegAngleX + 1*dt;
+    pose.leftLegAngleX = pose.leftLegAngleX - 2.2*dt;
+    pose.leftLowerLegAngleX = pose.leftLowerLegAngleX + 2*dt;
+}
+void liftRightLeg(CharacterPose& pose, double dt){
+    pose.rightLegAngleX = pose.rightLegAngleX - 2.5*dt;
+    pose.rightLowerLegAngleX = pose.rightLowerLegAngleX + 2*dt;
+    pose.leftLegAngleX = pose.leftLegAngleX + 2.5*dt;
+    pose.leftLowerLegAngleX = pose.leftLowerLegAngleX + 1*dt;
+}
+
+void fall(GameState& s, double dt){
+    s.pose.torsoPositionY = s.pose.torsoPositionY - 3*dt;
+    s.pose.cameraPosition.y = s.pose.cameraPosition.y - 3*dt;
+    s.chestModel[1][3] = s.chestModel[1][3] -3*dt;
+}
+void fallAngles(CharacterPose& pose, double dt){
+    pose.leftForearmAngleZ = pose.leftForearmAngleZ - 1.7*dt;
+    pose.leftForearmAngleX = pose.leftForearmAngleX + 5*dt;
+    pose.rightForearmAngleZ = pose.rightForearmAngleZ + 1.7*dt;
+    pose.rightForearmAngleX = pose.rightForearmAngleX + 3*dt;
+
+    pose.rightArmAngleX = pose.rightArmAngleX + 3*dt;
+    pose.rightArmAngleZ = pose.rightArmAngleZ + 2*dt;
+    pose.leftArmAngleX = pose.leftArmAngleX + 2*dt;
+    pose.leftArmAngleZ = pose.leftArmAngleZ - 2*dt;
+
+
+    pose.rightLegAngleX = pose.rightLegAngleX + 2.2*dt;
+    pose.rightLegAngleZ = pose.rightLegAngleZ + 1*dt;
+    pose.rightLowerLegAngleX = pose.rightLowerLegAngleX - 3.4*dt;
+    pose.rightLowerLegAngleZ = pose.rightLowerLegAngleZ - 1*dt;
+    pose.leftLegAngleX = pose.leftLegAngleX + 1*dt;
+    pose.leftLowerLegAngleX = pose.leftLowerLegAngleX - 4.5*dt;
+    pose.leftLegAngleZ = pose.leftLegAngleZ - 1.2*dt;
+}
+
+// Subida do pulo. No primeiro passo começa a transição para a pose do pulo,
+// que termina junto com a subida.
+void jump(GameState& s, double dt){
+    if(s.spacePressed){
+        s.spacePressed = false;
+        PlayAnimation(s.animation, CLIP_JUMP, s.time, JUMP_DURATION);
+    }
+
+    s.pose.torsoPositionY = s.pose.torsoPositionY + 3*dt;
+    s.pose.cameraPosition.y = s.pose.cameraPosition.y + 3*dt;
+    s.chestModel[1][3] = s.chestModel[1][3] + 3*dt;
+}
+
+// Pose no ponto mais alto do pulo
+CharacterPose JumpPose(){
+    CharacterPose pose = CharacterPose();
+    pose.leftArmAngleX = -0.806240;
+    pose.rightArmAngleX = -1.209359;
+    pose.leftForearmAngleX = -2.015599;
+    pose.rightForearmAngleX = -1.209359;
+    pose.leftLegAngleX = -0.403120;
+    pose.rightLegAngleX = -0.886863;
+    pose.leftLowerLegAngleX = 1.814039;
+    pose.rightLowerLegAngleX = 1.370607;
+
+    pose.leftArmAngleZ = 0.806240;
+    pose.rightArmAngleZ = -0.806240;
+    pose.leftForearmAngleZ = 0.685304;
+    pose.rightForearmAngleZ = -0.685304;
+    pose.leftLegAngleZ = 0.483744;
+    pose.rightLegAngleZ = -0.403120;
+    pose.leftLowerLegAngleZ = 0.000000;
+    pose.rightLowerLegAngleZ = 0.403120;
+    return pose;
+}
+
+void moveLeftArmForwards(CharacterPose& pose, int dir, double dt){
+    pose.leftForearmAngleX = pose.leftForearmAngleX - dir*2.3*dt;
+
+    pose.leftArmAngleX = pose.leftArmAngleX - dir*1*dt;
+    pose.leftArmAngleZ = pose.leftArmAngleZ + dir*0.2*dt;
+}
+
+void moveRightArmForwards(CharacterPose& pose, int dir, double dt){
+    pose.rightForearmAngleX = pose.rightForearmAngleX - dir*2.3*dt;
 
-    g_LeftArmAngleX = g_LeftArmAngleX - dir*1*timeDelta;
-    g_LeftArmAngleZ = g_LeftArmAngleZ + dir*0.2*timeDelta;
+    pose.rightArmAngleX = pose.rightArmAngleX - dir*1*dt;
+    pose.rightArmAngleZ = pose.rightArmAngleZ - dir*0.2*dt;
 }
 
-void moveRightArmForwards(int dir){
-    g_RightForearmAngleX = g_RightForearmAngleX - dir*2.3*timeDelta;
+void moveRightArmBackwards(CharacterPose& pose, int dir, double dt){
+    pose.rightForearmAngleX = pose.rightForearmAngleX - dir*2*dt;
+
+    pose.rightArmAngleX = pose.rightArmAngleX + dir*1*dt;
+    pose.rightArmAngleZ = pose.rightArmAngleZ - dir*0.2*dt;
+}
+
+void moveLeftArmBackwards(CharacterPose& pose, int dir, double dt){
+    pose.leftForearmAngleX = pose.leftForearmAngleX - dir*2*dt;
+
+    pose.leftArmAngleX = pose.leftArmAngleX + dir*1*dt;
+    pose.leftArmAngleZ = pose.leftArmAngleZ + dir*0.2*dt;
+}
 
-    g_RightArmAngleX = g_RightArmAngleX - dir*1*timeDelta;
-    g_RightArmAngleZ = g_RightArmAngleZ - dir*0.2*timeDelta;
+void lowLeftLeg(CharacterPose& pose, double dt){
+    pose.rightLegAngleX = pose.rightLegAngleX - 0.8*dt;
+    pose.leftLegAngleX = pose.leftLegAngleX + 4*dt;
+    pose.leftLowerLegAngleX = pose.leftLowerLegAngleX - 4*dt;
+}
+void lowRightLeg(CharacterPose& pose, double dt){
+    pose.rightLegAngleX = pose.rightLegAngleX + 2.2*dt;
+    pose.rightLowerLegAngleX = pose.rightLowerLegAngleX - 2*dt;
+    pose.leftLegAngleX = pose.leftLegAngleX - 3.1*dt;
 }
 
-void moveRightArmBackwards(int dir){
-    g_RightForearmAngleX = g_RightForearmAngleX - dir*2*timeDelta;
+float* PoseAngles(CharacterPose& pose){
+    static_assert(offsetof(CharacterPose, rightLowerLegAngleZ) - offsetof(CharacterPose, rightForearmAngleZ)
+                  == (CHARACTER_POSE_ANGLES - 1) * sizeof(float), "os ângulos da pose devem ser consecutivos");
+    return &pose.rightForearmAngleZ;
+}
 
-    g_RightArmAngleX = g_RightArmAngleX + dir*1*timeDelta;
-    g_RightArmAngleZ = g_RightArmAngleZ - dir*0.2*timeDelta;
+// Passo usado para integrar os movimentos das articulações ao gerar os clipes
+#define ANIMATION_BAKE_STEP (1.0 / 960.0)
+
+// Reamostra poses tomadas a cada ANIMATION_BAKE_STEP segundos para cerca de
+// ANIMATION_SAMPLE_RATE amostras por segundo, mantendo a primeira e a última.
+// Retorna a taxa de amostragem exata do resultado.
+float ResamplePoses(const std::vector<float>& fine, std::vector<float>& poses){
+    size_t fineFrames = fine.size() / CHARACTER_POSE_ANGLES;
+    double duration = (fineFrames - 1) * ANIMATION_BAKE_STEP;
+    size_t intervals = std::max((size_t)1, (size_t)std::lround(duration * ANIMATION_SAMPLE_RATE));
+    poses.resize((intervals + 1) * CHARACTER_POSE_ANGLES);
+    for (size_t k = 0; k <= intervals; ++k) {
+        double position = (double)k * (fineFrames - 1) / intervals;
+        size_t f = std::min((size_t)position, fineFrames - 2);
+        float t = (float)(position - f);
+        for (size_t c = 0; c < CHARACTER_POSE_ANGLES; ++c) {
+            float a = fine[f * CHARACTER_POSE_ANGLES + c];
+            float b = fine[(f + 1) * CHARACTER_POSE_ANGLES + c];
+            poses[k * CHARACTER_POSE_ANGLES + c] = a + (b - a) * t;
+        }
+    }
+    return (float)(intervals / duration);
 }
 
-void moveLeftArmBackwards(int dir){
-    g_LeftForearmAngleX = g_LeftForearmAngleX - dir*2*timeDelta;
+void AppendPoseAngles(CharacterPose pose, std::vector<float>& poses){
+    const float* angles = PoseAngles(pose);
+    poses.insert(poses.end(), angles, angles + CHARACTER_POSE_ANGLES);
+}
 
-    g_LeftArmAngleX = g_LeftArmAngleX + dir*1*timeDelta;
-    g_LeftArmAngleZ = g_LeftArmAngleZ + dir*0.2*timeDelta;
+// Um ciclo da corrida: sobe e desce a perna direita, depois a esquerda. Cada
+// perna sobe até a coxa chegar ao ângulo -2 e desce até voltar a 0, quando
+// todos os ângulos voltam a zero.
+float BakeRunCycle(std::vector<float>& poses){
+    std::vector<float> fine;
+    CharacterPose pose = CharacterPose();
+    const double dt = ANIMATION_BAKE_STEP;
+    char legUp = 'n';
+    char prevLegUp = 'n';
+    AppendPoseAngles(pose, fine);
+    while (prevLegUp != 'l') {
+        switch(legUp){
+        case 'n': //none
+            if(prevLegUp == 'n'){
+                liftRightLeg(pose, dt);
+                moveLeftArmForwards(pose, 1, dt);
+                moveRightArmBackwards(pose, 1, dt);
+                if(pose.rightLegAngleX <= -2){
+                    legUp = 'r';
+                }
+            } else {
+                liftLeftLeg(pose, dt);
+                moveRightArmForwards(pose, 1, dt);
+                moveLeftArmBackwards(pose, 1, dt);
+                if(pose.leftLegAngleX <= -2){
+                    legUp = 'l';
+                }
+            }
+            break;
+        case 'r': //right
+            lowRightLeg(pose, dt);
+            moveLeftArmForwards(pose, -1, dt);
+            moveRightArmBackwards(pose, -1, dt);
+            if(pose.rightLegAngleX >= 0){
+                pose = CharacterPose();
+                prevLegUp = 'r';
+                legUp = 'n';
+            }
+            break;
+        case 'l': // left
+            lowLeftLeg(pose, dt);
+            moveRightArmForwards(pose, -1, dt);
+            moveLeftArmBackwards(pose, -1, dt);
+            if(pose.leftLegAngleX >= 0){
+                pose = CharacterPose();
+                prevLegUp = 'l';
+                legUp = 'n';
+            }
+            break;
+        }
+        AppendPoseAngles(pose, fine);
+    }
+    return ResamplePoses(fine, poses);
 }
 
-void clearAngles(){
-    g_LeftForearmAngleZ = 0.0f;
-    g_LeftForearmAngleX = 0.0f;
-    g_RightForearmAngleZ = 0.0f;
-    g_RightForearmAngleX = 0.0f;
+int g_AnimationClips[NUM_CHARACTER_CLIPS];
+
+void BuildAnimationClips(){
+    std::vector<float> poses;
 
-    g_RightArmAngleX = 0.0f;
-    g_RightArmAngleZ = 0.0f;
-    g_LeftArmAngleX = 0.0f;
-    g_LeftArmAngleZ = 0.0f;
+    AppendPoseAngles(CharacterPose(), poses);
+    g_AnimationClips[CLIP_IDLE] = Animation_CreateClip(poses.data(), CHARACTER_POSE_ANGLES, 1, ANIMATION_SAMPLE_RATE, false);
 
+    float rate = BakeRunCycle(poses);
+    g_AnimationClips[CLIP_RUN] = Animation_CreateClip(poses.data(), CHARACTER_POSE_ANGLES, poses.size() / CHARACTER_POSE_ANGLES, rate, true);
 
-    g_RightLegAngleX = 0.0f;
-    g_RightLegAngleZ = 0.0f;
-    g_RightLowerLegAngleX = 0.0f;
-    g_RightLowerLegAngleZ = 0.0f;
-    g_LeftLegAngleX = 0.0f;
-    g_LeftLowerLegAngleX = 0.0f;
-    g_LeftLegAngleZ = 0.0f;
+    poses.clear();
+    AppendPoseAngles(JumpPose(), poses);
+    g_AnimationClips[CLIP_JUMP] = Animation_CreateClip(poses.data(), CHARACTER_POSE_ANGLES, 1, ANIMATION_SAMPLE_RATE, false);
+
+    // A queda parte da pose do pulo e dura até o personagem tocar o chão,
+    // o mesmo tempo da subida; depois disso a pose fica parada
+    poses.clear();
+    CharacterPose pose = JumpPose();
+    for (int k = 0; k <= (int)(JUMP_DURATION * ANIMATION_SAMPLE_RATE + 0.5); ++k) {
+        AppendPoseAngles(pose, poses);
+        fallAngles(pose, 1.0 / ANIMATION_SAMPLE_RATE);
+    }
+    g_AnimationClips[CLIP_FALL] = Animation_CreateClip(poses.data(), CHARACTER_POSE_ANGLES, poses.size() / CHARACTER_POSE_ANGLES, ANIMATION_SAMPLE_RATE, false);
 }
 
-void lowLeftLeg(){
-    g_RightLegAngleX = g_RightLegAngleX - 0.8*timeDelta;
-    g_LeftLegAngleX = g_LeftLegAngleX + 4*timeDelta;
-    g_LeftLowerLegAngleX = g_LeftLowerLegAngleX - 4*timeDelta;
+void PlayAnimation(CharacterAnimation& a, int clip, double time, float blendDuration){
+    a.fromClip = a.clip;
+    a.fromTime = (float)(time - a.startTime);
+    a.clip = clip;
+    a.startTime = time;
+    a.blendDuration = blendDuration;
 }
-void lowRightLeg(){
-    g_RightLegAngleX = g_RightLegAngleX + 2.2*timeDelta;
-    g_RightLowerLegAngleX = g_RightLowerLegAngleX - 2*timeDelta;
-    g_LeftLegAngleX = g_LeftLegAngleX - 3.1*timeDelta;
+
+void EvaluateCharacterAnimations(const CharacterAnimation* animations, size_t count, double time, float* angles){
+    static thread_local std::vector<int> clips, fromClips;
+    static thread_local std::vector<float> times, fromTimes, weights;
+    clips.resize(count);
+    fromClips.resize(count);
+    times.resize(count);
+    fromTimes.resize(count);
+    weights.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        const CharacterAnimation& a = animations[i];
+        float t = (float)std::max(time - a.startTime, 0.0);
+        clips[i] = g_AnimationClips[a.clip];
+        fromClips[i] = g_AnimationClips[a.fromClip];
+        times[i] = t;
+        fromTimes[i] = a.fromTime;
+        weights[i] = a.blendDuration > 0.0f ? std::min(t / a.blendDuration, 1.0f) : 1.0f;
+    }
+    Animation_EvaluateBatch(clips.data(), times.data(), fromClips.data(), fromTimes.data(), weights.data(), count, angles);
 }
 
 // Função que pega a matriz M e guarda a mesma no topo da pilha
@@ -1529,15 +3429,14 @@ void PopMatrix(glm::mat4& M)
 }
 void DrawPlane(GLint render_as_black_uniform)
 {
-    glUniform1i(render_as_black_uniform, false);
-    glDrawElements(
+    SetRenderAsBlack(render_as_black_uniform, false);
+    DrawElements(
         g_VirtualScene["floor_plane"].rendering_mode, // Veja slide 175 do documento "Aula_04_Modelagem_Geometrica_3D.pdf".
         g_VirtualScene["floor_plane"].num_indices,    //
-        GL_UNSIGNED_INT,
         (void*)g_VirtualScene["floor_plane"].first_index
     );
 
-    glUniform1i(render_as_black_uniform, true);
+    SetRenderAsBlack(render_as_black_uniform, true);
 }
 
 
@@ -1547,61 +3446,30 @@ void DrawCube(GLint render_as_black_uniform)
     // Informamos para a placa de vídeo (GPU) que a variável booleana
     // "render_as_black" deve ser colocada como "false". Veja o arquivo
     // "shader_vertex.glsl".
-    glUniform1i(render_as_black_uniform, false);
-
-    // Pedimos para a GPU rasterizar os vértices do cubo apontados pelo
-    // VAO como triângulos, formando as faces do cubo. Esta
-    // renderização irá executar o Vertex Shader definido no arquivo
-    // "shader_vertex.glsl", e o mesmo irá utilizar as matrizes
-    // "model", "view" e "projection" definidas acima e já enviadas
-    // para a placa de vídeo (GPU).
-    //
-    // Veja a definição de g_VirtualScene["cube_faces"] dentro da
-    // função BuildTriangles(), e veja a documentação da função
-    // glDrawElements() em http://docs.gl/gl3/glDrawElements.
-    glDrawElements(
-        g_VirtualScene["cube_faces"].rendering_mode, // Veja slide 175 do documento "Aula_04_Modelagem_Geometrica_3D.pdf".
-        g_VirtualScene["cube_faces"].num_indices,    //
-        GL_UNSIGNED_INT,
-        (void*)g_VirtualScene["cube_faces"].first_index
-    );
-
-    // Pedimos para OpenGL desenhar linhas com largura de 4 pixels.
-    glLineWidth(2.0f);
-
-    // Pedimos para a GPU rasterizar os vértices dos eixos XYZ
-    // apontados pelo VAO como linhas. Veja a definição de
-    // g_VirtualScene["axes"] dentro da função BuildTriangles(), e veja
-    // a documentação da função glDrawElements() em
-    // http://docs.gl/gl3/glDrawElements.
-    //
-    // Importante: estes eixos serão desenhamos com a matriz "model"
-    // definida acima, e portanto sofrerão as mesmas transformações
-    // geométricas que o cubo. Isto é, estes eixos estarão
-    // representando o sistema de coordenadas do modelo (e não o global)!
-    glDrawElements(
-        g_VirtualScene["axes"].rendering_mode,
-        g_VirtualScene["axes"].num_indices,
-        GL_UNSIGNED_INT,
-        (void*)g_VirtualScene["axes"].first_index
-    );
+    SetRenderAsBlack(render_as_black_uniform, false);
 
-    // Informamos para a placa de vídeo (GPU) que a variável booleana
-    // "render_as_black" deve ser colocada como "true". Veja o arquivo
-    // "shader_vertex.glsl".
-    glUniform1i(render_as_black_uniform, true);
+    // As arestas pretas são pintadas pelo Fragment Shader junto com as
+    // faces, sem desenhar as linhas de g_VirtualScene["cube_edges"]. Veja
+    // "cube_outline" no arquivo "shader_fragment.glsl".
+    SetCubeOutline(true);
 
     // Pedimos para a GPU rasterizar os vértices do cubo apontados pelo
-    // VAO como linhas, formando as arestas pretas do cubo. Veja a
-    // definição de g_VirtualScene["cube_edges"] dentro da função
-    // BuildTriangles(), e veja a documentação da função
+    // VAO como triângulos, formando as faces do cubo. Esta
+    // renderização irá executar o Vertex Shader definido no arquivo
+    // "shader_vertex.glsl", e o mesmo irá utilizar as matrizes
+    // "model", "view" e "projection" definidas acima e já enviadas
+    // para a placa de vídeo (GPU).
+    //
+    // Veja a definição de g_VirtualScene["cube_faces"] dentro da
+    // função BuildTriangles(), e veja a documentação da função
     // glDrawElements() em http://docs.gl/gl3/glDrawElements.
-    glDrawElements(
-        g_VirtualScene["cube_edges"].rendering_mode,
-        g_VirtualScene["cube_edges"].num_indices,
-        GL_UNSIGNED_INT,
-        (void*)g_VirtualScene["cube_edges"].first_index
+    DrawElements(
+        g_VirtualScene["cube_faces"].rendering_mode, // Veja slide 175 do documento "Aula_04_Modelagem_Geometrica_3D.pdf".
+        g_VirtualScene["cube_faces"].num_indices,    //
+        (void*)g_VirtualScene["cube_faces"].first_index
     );
+
+    SetCubeOutline(false);
 }
 
 // Constrói triângulos para futura renderização
@@ -1652,79 +3520,7 @@ GLuint BuildTriangles()
     //     0.0f,  0.0f,  1.0f, 1.0f, // posição do vértice 13
     };
 
-    // Criamos o identificador (ID) de um Vertex Buffer Object (VBO).  Um VBO é
-    // um buffer de memória que irá conter os valores de um certo atributo de
-    // um conjunto de vértices; por exemplo: posição, cor, normais, coordenadas
-    // de textura.  Neste exemplo utilizaremos vários VBOs, um para cada tipo de atributo.
-    // Agora criamos um VBO para armazenarmos um atributo: posição.
-    GLuint VBO_model_coefficients_id;
-    glGenBuffers(1, &VBO_model_coefficients_id);
-
-    // Criamos o identificador (ID) de um Vertex Array Object (VAO).  Um VAO
-    // contém a definição de vários atributos de um certo conjunto de vértices;
-    // isto é, um VAO irá conter ponteiros para vários VBOs.
-    GLuint vertex_array_object_id;
-    glGenVertexArrays(1, &vertex_array_object_id);
-
-    // "Ligamos" o VAO ("bind"). Informamos que iremos atualizar o VAO cujo ID
-    // está contido na variável "vertex_array_object_id".
-    glBindVertexArray(vertex_array_object_id);
-
-    // "Ligamos" o VBO ("bind"). Informamos que o VBO cujo ID está contido na
-    // variável VBO_model_coefficients_id será modificado a seguir. A
-    // constante "GL_ARRAY_BUFFER" informa que esse buffer é de fato um VBO, e
-    // irá conter atributos de vértices.
-    glBindBuffer(GL_ARRAY_BUFFER, VBO_model_coefficients_id);
-
-    // Alocamos memória para o VBO "ligado" acima. Como queremos armazenar
-    // nesse VBO todos os valores contidos no array "model_coefficients", pedimos
-    // para alocar um número de bytes exatamente igual ao tamanho ("size")
-    // desse array. A constante "GL_STATIC_DRAW" dá uma dica para o driver da
-    // GPU sobre como utilizaremos os dados do VBO. Neste caso, estamos dizendo
-    // que não pretendemos alterar tais dados (são estáticos: "STATIC"), e
-    // também dizemos que tais dados serão utilizados para renderizar ou
-    // desenhar ("DRAW").  Pense que:
-    //
-    //            glBufferData()  ==  malloc() do C  ==  new do C++.
-    //
-    glBufferData(GL_ARRAY_BUFFER, sizeof(model_coefficients), NULL, GL_DYNAMIC_DRAW);
-
-    // Finalmente, copiamos os valores do array model_coefficients para dentro do
-    // VBO "ligado" acima.  Pense que:
-    //
-    //            glBufferSubData()  ==  memcpy() do C.
-    //
-    glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(model_coefficients), model_coefficients);
-
-    // Precisamos então informar um índice de "local" ("location"), o qual será
-    // utilizado no shader "shader_vertex.glsl" para acessar os valores
-    // armazenados no VBO "ligado" acima. Também, informamos a dimensão (número de
-    // coeficientes) destes atributos. Como em nosso caso são pontos em coordenadas
-    // homogêneas, temos quatro coeficientes por vértice (X,Y,Z,W). Isso define
-    // um tipo de dado chamado de "vec4" em "shader_vertex.glsl": um vetor com
-    // quatro coeficientes. Finalmente, informamos que os dados estão em ponto
-    // flutuante com 32 bits (GL_FLOAT).
-    // Esta função também informa que o VBO "ligado" acima em glBindBuffer()
-    // está dentro do VAO "ligado" acima por glBindVertexArray().
-    // Veja https://www.khronos.org/opengl/wiki/Vertex_Specification#Vertex_Buffer_Object
-    GLuint location = 0; // "(location = 0)" em "shader_vertex.glsl"
-    GLint  number_of_dimensions = 4; // vec4 em "shader_vertex.glsl"
-    glVertexAttribPointer(location, number_of_dimensions, GL_FLOAT, GL_FALSE, 0, 0);
-
-    // "Ativamos" os atributos. Informamos que os atributos com índice de local
-    // definido acima, na variável "location", deve ser utilizado durante o
-    // rendering.
-    glEnableVertexAttribArray(location);
-
-    // "Desligamos" o VBO, evitando assim que operações posteriores venham a
-    // alterar o mesmo. Isso evita bugs.
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-    // Agora repetimos fs os passos acima para atribuir um novo atributo a
-    // cada vértice: uma cor (veja slide 113 do documento "Aula_04_Modelagem_Geometrica_3D.pdf").
-    // Tal cor é definida como coeficientes RGBA: Red, Green, Blue, Alpha;
-    // isto é: Vermelho, Verde, Azul, Alpha (valor de transparência).
-    // Conversaremos sobre sistemas de cores nas aulas de Modelos de Iluminação.
+    // Cores dos vértices (veja slide 113 do documento "Aula_04_Modelagem_Geometrica_3D.pdf").
     GLfloat color_coefficients[] = {
     // Cores dos vértices do cubo
     //  R     G     B     A
@@ -1751,16 +3547,6 @@ GLuint BuildTriangles()
         //0.0f, 0.0f, 1.0f, 1.0f, // cor do vértice 12
         //0.0f, 0.0f, 1.0f, 1.0f, // cor do vértice 13
     };
-    GLuint VBO_color_coefficients_id;
-    glGenBuffers(1, &VBO_color_coefficients_id);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO_color_coefficients_id);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(color_coefficients), NULL, GL_STATIC_DRAW);
-    glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(color_coefficients), color_coefficients);
-    location = 1; // "(location = 1)" em "shader_vertex.glsl"
-    number_of_dimensions = 4; // vec4 em "shader_vertex.glsl"
-    glVertexAttribPointer(location, number_of_dimensions, GL_FLOAT, GL_FALSE, 0, 0);
-    glEnableVertexAttribArray(location);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
 
     // Vamos então definir polígonos utilizando os vértices do array
     // model_coefficients.
@@ -1849,6 +3635,101 @@ GLuint BuildTriangles()
     floor_plane.rendering_mode = GL_TRIANGLES;
     g_VirtualScene["floor_plane"] = floor_plane;
 
+    // No modo "--software" não existe contexto OpenGL: os atributos acima
+    // ficam na memória da CPU e o "VAO" é um índice do renderizador por software.
+    if (g_SoftwareRendering)
+    {
+        std::vector<float> positions(model_coefficients, model_coefficients + sizeof(model_coefficients) / sizeof(GLfloat));
+        std::vector<float> colors(color_coefficients, color_coefficients + sizeof(color_coefficients) / sizeof(GLfloat));
+        std::vector<unsigned int> vertex_indices(indices, indices + sizeof(indices) / sizeof(GLuint));
+        return SoftRender_AddVertexArray(positions, std::vector<float>(), std::vector<float>(), colors, vertex_indices);
+    }
+
+    // Criamos o identificador (ID) de um Vertex Buffer Object (VBO).  Um VBO é
+    // um buffer de memória que irá conter os valores de um certo atributo de
+    // um conjunto de vértices; por exemplo: posição, cor, normais, coordenadas
+    // de textura.  Neste exemplo utilizaremos vários VBOs, um para cada tipo de atributo.
+    // Agora criamos um VBO para armazenarmos um atributo: posição.
+    GLuint VBO_model_coefficients_id;
+    glGenBuffers(1, &VBO_model_coefficients_id);
+
+    // Criamos o identificador (ID) de um Vertex Array Object (VAO).  Um VAO
+    // contém a definição de vários atributos de um certo conjunto de vértices;
+    // isto é, um VAO irá conter ponteiros para vários VBOs.
+    GLuint vertex_array_object_id;
+    glGenVertexArrays(1, &vertex_array_object_id);
+
+    // "Ligamos" o VAO ("bind"). Informamos que iremos atualizar o VAO cujo ID
+    // está contido na variável "vertex_array_object_id".
+    glBindVertexArray(vertex_array_object_id);
+    GlDebug_Label(GL_VERTEX_ARRAY, vertex_array_object_id, "Cube");
+
+    // "Ligamos" o VBO ("bind"). Informamos que o VBO cujo ID está contido na
+    // variável VBO_model_coefficients_id será modificado a seguir. A
+    // constante "GL_ARRAY_BUFFER" informa que esse buffer é de fato um VBO, e
+    // irá conter atributos de vértices.
+    glBindBuffer(GL_ARRAY_BUFFER, VBO_model_coefficients_id);
+
+    // Alocamos memória para o VBO "ligado" acima. Como queremos armazenar
+    // nesse VBO todos os valores contidos no array "model_coefficients", pedimos
+    // para alocar um número de bytes exatamente igual ao tamanho ("size")
+    // desse array. A constante "GL_STATIC_DRAW" dá uma dica para o driver da
+    // GPU sobre como utilizaremos os dados do VBO. Neste caso, estamos dizendo
+    // que não pretendemos alterar tais dados (são estáticos: "STATIC"), e
+    // também dizemos que tais dados serão utilizados para renderizar ou
+    // desenhar ("DRAW").  Pense que:
+    //
+    //            glBufferData()  ==  malloc() do C  ==  new do C++.
+    //
+    glBufferData(GL_ARRAY_BUFFER, sizeof(model_coefficients), NULL, GL_DYNAMIC_DRAW);
+
+    // Finalmente, copiamos os valores do array model_coefficients para dentro do
+    // VBO "ligado" acima.  Pense que:
+    //
+    //            glBufferSubData()  ==  memcpy() do C.
+    //
+    glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(model_coefficients), model_coefficients);
+
+    // Precisamos então informar um índice de "local" ("location"), o qual será
+    // utilizado no shader "shader_vertex.glsl" para acessar os valores
+    // armazenados no VBO "ligado" acima. Também, informamos a dimensão (número de
+    // coeficientes) destes atributos. Como em nosso caso são pontos em coordenadas
+    // homogêneas, temos quatro coeficientes por vértice (X,Y,Z,W). Isso define
+    // um tipo de dado chamado de "vec4" em "shader_vertex.glsl": um vetor com
+    // quatro coeficientes. Finalmente, informamos que os dados estão em ponto
+    // flutuante com 32 bits (GL_FLOAT).
+    // Esta função também informa que o VBO "ligado" acima em glBindBuffer()
+    // está dentro do VAO "ligado" acima por glBindVertexArray().
+    // Veja https://www.khronos.org/opengl/wiki/Vertex_Specification#Vertex_Buffer_Object
+    GLuint location = 0; // "(location = 0)" em "shader_vertex.glsl"
+    GLint  number_of_dimensions = 4; // vec4 em "shader_vertex.glsl"
+    glVertexAttribPointer(location, number_of_dimensions, GL_FLOAT, GL_FALSE, 0, 0);
+
+    // "Ativamos" os atributos. Informamos que os atributos com índice de local
+    // definido acima, na variável "location", deve ser utilizado durante o
+    // rendering.
+    glEnableVertexAttribArray(location);
+
+    // "Desligamos" o VBO, evitando assim que operações posteriores venham a
+    // alterar o mesmo. Isso evita bugs.
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    // Agora repetimos fs os passos acima para atribuir um novo atributo a
+    // cada vértice: uma cor (veja slide 113 do documento "Aula_04_Modelagem_Geometrica_3D.pdf").
+    // Tal cor é definida como coeficientes RGBA: Red, Green, Blue, Alpha;
+    // isto é: Vermelho, Verde, Azul, Alpha (valor de transparência).
+    // Conversaremos sobre sistemas de cores nas aulas de Modelos de Iluminação.
+    GLuint VBO_color_coefficients_id;
+    glGenBuffers(1, &VBO_color_coefficients_id);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO_color_coefficients_id);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(color_coefficients), NULL, GL_STATIC_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(color_coefficients), color_coefficients);
+    location = 1; // "(location = 1)" em "shader_vertex.glsl"
+    number_of_dimensions = 4; // vec4 em "shader_vertex.glsl"
+    glVertexAttribPointer(location, number_of_dimensions, GL_FLOAT, GL_FALSE, 0, 0);
+    glEnableVertexAttribArray(location);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
     // Criamos um buffer OpenGL para armazenar os índices acima
     GLuint indices_id;
     glGenBuffers(1, &indices_id);
@@ -2037,7 +3918,11 @@ void FramebufferSizeCallback(GLFWwindow* window, int width, int height)
     // coordinates" (NDC) para "pixel coordinates".  Essa é a operação de
     // "Screen Mapping" ou "Viewport Mapping" vista em aula (slides 33 até 42
     // do documento "Aula_07_Transformacoes_Geometricas_3D.pdf").
-    glViewport(0, 0, width, height);
+    if (!g_SoftwareRendering)
+    {
+        glViewport(0, 0, width, height);
+        DynRes_Resize(width, height);
+    }
 
     // Atualizamos também a razão que define a proporção da janela (largura /
     // altura), a qual será utilizada na definição das matrizes de projeção,
@@ -2048,6 +3933,34 @@ void FramebufferSizeCallback(GLFWwindow* window, int width, int height)
     // O cast para float é necessário pois números inteiros são arredondados ao
     // serem divididos!
     g_ScreenRatio = (float)width / height;
+
+    InvalidateFrame();
+}
+
+// Função callback chamada quando o conteúdo da janela foi perdido (ex.: a
+// janela estava coberta por outra)
+void WindowRefreshCallback(GLFWwindow* window)
+{
+    InvalidateFrame();
+}
+
+// A imagem mostrada deixou de corresponder ao estado atual
+void InvalidateFrame()
+{
+    g_ContinuousUntil = GameTime() + IDLE_SETTLE_TIME;
+}
+
+// Dorme até a imagem ser invalidada ou até o próximo redesenho periódico.
+// Os callbacks da GLFW são chamados de dentro de glfwWaitEventsTimeout().
+void WaitForInvalidation(GLFWwindow* window)
+{
+    double now = GameTime();
+    const double redraw = now + IDLE_REDRAW_INTERVAL;
+    while (now >= g_ContinuousUntil && now < redraw && !glfwWindowShouldClose(window))
+    {
+        glfwWaitEventsTimeout(redraw - now);
+        now = GameTime();
+    }
 }
 
 bool PlayerFloorColision(float floorY, float playerLowerY){
@@ -2057,52 +3970,46 @@ bool PlayerFloorColision(float floorY, float playerLowerY){
     return false;
 }
 
-bool PlayerObstacleColision(glm::mat4 &m, float height, float width, float depth, char type){
-    float deltaY, deltaX, deltaZ;
-    //Switch utlilizado para tratar objetos com diferentes pontos iniciais, nem todos estão no canto superior esquerdo
-    switch(type){
-    case 'p':
-        deltaY = 1.8;
-        deltaX = -1.0;
-        deltaZ = -3.3;
-        break;
-    case 'b':
-        deltaY = 1;
-        deltaX = 0;
-        deltaZ = -0.35;
-        break;
-    case 'c':
-        deltaY = 0;
-        deltaX = 0;
-        deltaZ = -0.4;
-        break;
-    default:
-        deltaY = 0;
-        deltaX = 0;
-        deltaZ = 0;
-    }
-    if(fabs((chestModel[0][3] + chestModel[0][0]/2) - ((m[3][0] + deltaX) + width/2)) < (chestModel[0][0]/2 + width/2)){
-        if(fabs((chestModel[1][3] + chestModel[1][1]/2) - ((m[3][1] + deltaY) + height/2)) < (chestModel[1][1]/2 + height/2)){
-            if(fabs((chestModel[2][3] + chestModel[2][2]/2) - ((m[3][2] + deltaZ) + depth/2)) < (chestModel[2][2]/2 + depth/2)){
-                cows.clear();
-                busses.clear();
-                blockades.clear();
-                started = false; //Morreu
-                g_TorsoPositionX = 0.0f;
-                g_TorsoPositionY = -0.0005f;
-                model = model * Matrix_Translate(g_TorsoPositionX, g_TorsoPositionY + 1.83, -6.5f);
-                camera_position_c.y = 2.0f;
-                timeWhenSpacePressed = 0;
-                //while(!PlayerFloorColision(0.0f, g_TorsoPositionY)){
-                //    fall();
-                //}
-                camera_position_c.x = -0.05f;
-                clearAngles();
-                return true;
-            }
-        }
+// Teste de um único obstáculo, só na posição final. A simulação usa
+// Collision_PlayerSweep(), que testa todos os obstáculos de uma vez ao longo
+// do passo, e confirma com PlayerObstacleMeshColision().
+bool PlayerObstacleColision(const GameState& s, const glm::mat4& m, int type){
+    float player[6], box[6];
+    unsigned char t = (unsigned char)type;
+    PlayerBox(s, player);
+    ObstacleBoxes(&m, &t, 1, box);
+    for (int k = 0; k < 3; ++k) {
+        if (!(fabs(player[k] - box[k]) < player[k + 3] + box[k + 3]))
+            return false;
     }
-    return false;
+    const float motion[3] = { 0.0f, 0.0f, 0.0f };
+    return PlayerObstacleMeshColision(player, m, type, motion);
+}
+
+// Em relação ao obstáculo, o personagem percorre durante o passo o segmento
+// de "player" até "player" + "motion". Como o movimento é ao longo de um
+// eixo, a região varrida é exatamente a caixa que envolve as duas posições.
+bool PlayerObstacleMeshColision(const float player[6], const glm::mat4& m, int type, const float motion[3]){
+    glm::vec3 min, max;
+    for (int k = 0; k < 3; ++k) {
+        min[k] = player[k] - player[k + 3] + std::min(motion[k], 0.0f);
+        max[k] = player[k] + player[k + 3] + std::max(motion[k], 0.0f);
+    }
+    return Bvh_OverlapsBox(g_ObstacleShapes[type].bvh, m, min, max);
+}
+
+void KillPlayer(GameState& s){
+    s.obstacles.count = 0;
+    s.started = false; //Morreu
+    s.pose.torsoPositionX = 0.0f;
+    s.pose.torsoPositionY = -0.0005f;
+    s.pose.cameraPosition.y = 2.0f;
+    s.timeWhenSpacePressed = 0;
+    //while(!PlayerFloorColision(0.0f, s.pose.torsoPositionY)){
+    //    fall(s, dt);
+    //}
+    s.pose.cameraPosition.x = -0.05f;
+    PlayAnimation(s.animation, CLIP_IDLE, s.time, 0.0f);
 }
 
 // Variáveis globais que armazenam a última posição do cursor do mouse, para
@@ -2113,6 +4020,8 @@ double g_LastCursorPosX, g_LastCursorPosY;
 // Função callback chamada sempre que o usuário aperta algum dos botões do mouse
 void MouseButtonCallback(GLFWwindow* window, int button, int action, int mods)
 {
+    InvalidateFrame();
+
     if (button == GLFW_MOUSE_BUTTON_LEFT && action == GLFW_PRESS)
     {
         // Se o usuário pressionou o botão esquerdo do mouse, guardamos a
@@ -2178,6 +4087,8 @@ void CursorPosCallback(GLFWwindow* window, double xpos, double ypos)
     if (!g_LeftMouseButtonPressed)
         return;
 
+    InvalidateFrame();
+
     // Deslocamento do cursor do mouse em x e y de coordenadas de tela!
     float dx = xpos - g_LastCursorPosX;
     float dy = ypos - g_LastCursorPosY;
@@ -2220,6 +4131,7 @@ void ScrollCallback(GLFWwindow* window, double xoffset, double yoffset)
     // Atualizamos a distância da câmera para a origem utilizando a
     // movimentação da "rodinha", simulando um ZOOM.
     g_CameraDistance -= 0.1f*yoffset;
+    InvalidateFrame();
 
     // Uma câmera look-at nunca pode estar exatamente "em cima" do ponto para
     // onde ela está olhando, pois isto gera problemas de divisão por zero na
@@ -2235,8 +4147,10 @@ void ScrollCallback(GLFWwindow* window, double xoffset, double yoffset)
 // tecla do teclado. Veja http://www.glfw.org/docs/latest/input_guide.html#input_key
 void KeyCallback(GLFWwindow* window, int key, int scancode, int action, int mod)
 {
+    InvalidateFrame();
+
     // Se o usuário pressionar a tecla ESC, fechamos a janela.
-    if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS)
+    if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS && window)
         glfwSetWindowShouldClose(window, GL_TRUE);
 
     // O código abaixo implementa a seguinte lógica:
@@ -2252,41 +4166,18 @@ void KeyCallback(GLFWwindow* window, int key, int scancode, int action, int mod)
         free_cam_enabled = !free_cam_enabled;
     }
 
-    if ((key == GLFW_KEY_LEFT || key == GLFW_KEY_A) && action == GLFW_PRESS){
-        if(started && track > 0){
-          //movement = 4;
-          track--;
-          timeWhenLeftPressed = glfwGetTime();
-        }
-    }
-    if ((key == GLFW_KEY_RIGHT || key == GLFW_KEY_D) && action == GLFW_PRESS){
-        if(started && track < 2){
-          //movement = 3;
-          track++;
-          timeWhenRightPressed = glfwGetTime();
-        }
-    }
-
-    // Se o usuário apertar a tecla espaço, resetamos os ângulos de Euler para zero.
-    if ((key == GLFW_KEY_SPACE || key == GLFW_KEY_W || key == GLFW_KEY_UP) && action == GLFW_PRESS)
-    {
-        if(timeWhenSpacePressed == 0 && started){
-            movement = 1;
-            spacePressed = true;
-            timeWhenSpacePressed = glfwGetTime();
-            PlaySound(TEXT("../../data/jump.wav"), NULL, SND_ASYNC);
-        }
-
-    }
-
-    if (key == GLFW_KEY_ENTER && action == GLFW_PRESS)
+    // Teclas do jogo são aplicadas pela simulação. Veja ApplyInputEvent().
+    // Durante a reprodução de uma gravação elas vêm do arquivo.
+    if (!g_Replaying &&
+        (key == GLFW_KEY_LEFT || key == GLFW_KEY_A || key == GLFW_KEY_RIGHT || key == GLFW_KEY_D ||
+         key == GLFW_KEY_SPACE || key == GLFW_KEY_W || key == GLFW_KEY_UP || key == GLFW_KEY_ENTER))
     {
-        if(!started){
-            movement = 2;
-            legUp = 'n';
+        InputEvent event = { key, action };
+        {
+            std::lock_guard<std::mutex> lock(g_PendingInputMutex);
+            g_PendingInput.push_back(event);
         }
-        started = true;
-        startTime = (float)glfwGetTime();
+        g_PendingInputAdded.notify_one();
     }
 
     // Se o usuário apertar a tecla P, utilizamos projeção perspectiva.
@@ -2306,6 +4197,69 @@ void KeyCallback(GLFWwindow* window, int key, int scancode, int action, int mod)
     {
         g_ShowInfoText = !g_ShowInfoText;
     }
+
+    // Se o usuário apertar a tecla F, mostramos ou escondemos o profiler de quadros.
+    if (key == GLFW_KEY_F && action == GLFW_PRESS)
+    {
+        Profiler_ToggleOverlay();
+    }
+
+    // Se o usuário apertar a tecla X, mostramos ou escondemos os eixos XYZ.
+    if (key == GLFW_KEY_X && action == GLFW_PRESS)
+    {
+        g_ShowAxes = !g_ShowAxes;
+    }
+
+    // Se o usuário apertar a tecla B, mostramos ou escondemos as caixas de colisão.
+    if (key == GLFW_KEY_B && action == GLFW_PRESS)
+    {
+        g_ShowCollisionBoxes = !g_ShowCollisionBoxes;
+    }
+}
+
+// Aplica uma tecla do jogo ao estado da simulação. Executada pela simulação,
+// no início de um passo.
+void ApplyInputEvent(GameState& s, const InputEvent& event)
+{
+    const int key = event.key;
+    const int action = event.action;
+
+    if ((key == GLFW_KEY_LEFT || key == GLFW_KEY_A) && action == GLFW_PRESS){
+        if(s.started && s.track > 0){
+          //s.movement = 4;
+          s.track--;
+          s.timeWhenLeftPressed = s.time;
+        }
+    }
+    if ((key == GLFW_KEY_RIGHT || key == GLFW_KEY_D) && action == GLFW_PRESS){
+        if(s.started && s.track < 2){
+          //s.movement = 3;
+          s.track++;
+          s.timeWhenRightPressed = s.time;
+        }
+    }
+
+    // Se o usuário apertar a tecla espaço, resetamos os ângulos de Euler para zero.
+    if ((key == GLFW_KEY_SPACE || key == GLFW_KEY_W || key == GLFW_KEY_UP) && action == GLFW_PRESS)
+    {
+        if(s.timeWhenSpacePressed == 0 && s.started){
+            s.movement = 1;
+            s.spacePressed = true;
+            s.timeWhenSpacePressed = s.time;
+            s.jumpSound = true;
+        }
+
+    }
+
+    if (key == GLFW_KEY_ENTER && action == GLFW_PRESS)
+    {
+        if(!s.started){
+            s.movement = 2;
+            PlayAnimation(s.animation, CLIP_RUN, s.time, 0.0f);
+        }
+        s.started = true;
+        s.startTime = (float)s.time;
+    }
 }
 
 // Definimos o callback para impressão de erros da GLFW no terminal
@@ -2316,12 +4270,11 @@ void ErrorCallback(int error, const char* description)
 
 
 
-void TextRendering_ShowPoints(GLFWwindow* window){
-    if(started){
-        float timeNow = (float)glfwGetTime();
+void TextRendering_ShowPoints(GLFWwindow* window, const FrameSnapshot& snapshot){
+    if(snapshot.started){
         int numchars;
         static char buffer[20];
-        numchars = snprintf(buffer, 20, "%.2f Points", (timeNow - startTime));
+        numchars = snprintf(buffer, 20, "%.2f Points", snapshot.points);
         float lineheight = TextRendering_LineHeight(window);
         float charwidth = TextRendering_CharWidth(window);
 
@@ -2329,10 +4282,10 @@ void TextRendering_ShowPoints(GLFWwindow* window){
     }
 }
 
-void TextRendering_ShowStartMessage(GLFWwindow* window){
-    if(!started){
+void TextRendering_ShowStartMessage(GLFWwindow* window, const FrameSnapshot& snapshot){
+    if(!snapshot.started){
         int numchars;
-        static char buffer[20];
+        static char buffer[30];
         numchars = snprintf(buffer, 30, "Pressione ENTER para jogar!");
         float lineheight = TextRendering_LineHeight(window);
         float charwidth = TextRendering_CharWidth(window);
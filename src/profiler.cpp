@@ -0,0 +1,436 @@
+// Profiler de quadros: escopos de tempo de CPU (aninháveis, em qualquer
+// thread), consultas GL_TIME_ELAPSED para o tempo de GPU e contadores de
+// chamadas de desenho, envios de uniforms e trocas de estado por quadro
+// (junto com as chamadas descartadas pelo cache de estado, em glstate.cpp).
+//
+// Os dados aparecem em um overlay de texto (tecla F) e, com "--trace
+// ARQUIVO", todos os eventos são gravados no formato "trace_event" do Chrome
+// (abra em chrome://tracing ou https://ui.perfetto.dev), junto com os
+// percentis p50/p95/p99 do tempo de quadro.
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+// Funções definidas em textrendering.cpp
+float TextRendering_LineHeight(GLFWwindow* window);
+void TextRendering_PrintString(GLFWwindow* window, const std::string &str, float x, float y, float scale);
+
+// As consultas de GPU de um quadro só são lidas PROFILER_GPU_LATENCY quadros
+// depois, quando a GPU certamente já terminou, para não travar a CPU.
+#define PROFILER_GPU_LATENCY 4
+#define PROFILER_MAX_GPU_SCOPES 8
+#define PROFILER_MAX_DEPTH 32
+
+// Peso de cada quadro novo nas médias mostradas no overlay
+#define PROFILER_SMOOTHING 0.05
+
+// Identificador da "thread" da GPU no arquivo de trace
+#define PROFILER_GPU_TID 1000
+
+// Quadros considerados nos percentis do overlay (e do resumo, sem "--trace")
+#define PROFILER_RECENT_FRAMES 300
+
+namespace
+{
+    struct ScopeStats
+    {
+        const char* name;
+        double frame;    // Tempo acumulado no quadro atual (ms)
+        double average;  // Média móvel por quadro (ms)
+        bool gpu;
+    };
+
+    struct TraceEvent
+    {
+        const char* name;
+        double start;    // Microssegundos desde Profiler_Init()
+        double duration; // Microssegundos
+        int tid;
+    };
+
+    struct TraceCounters
+    {
+        double time;
+        int draw_calls;
+        int uniforms;
+        int state_changes;
+        int elided;
+    };
+
+    struct GpuQuery
+    {
+        GLuint id;
+        const char* name;
+        double cpu_start;
+    };
+
+    struct OpenScope
+    {
+        const char* name;
+        double start;
+    };
+}
+
+std::chrono::steady_clock::time_point profiler_epoch;
+bool profiler_enabled = false;
+bool profiler_tracing = false;
+bool profiler_gpu = false;
+bool profiler_overlay = false;
+
+// Estatísticas e eventos de todas as threads, protegidos por profiler_mutex
+std::mutex profiler_mutex;
+std::vector<ScopeStats> profiler_scopes; // Na ordem em que apareceram
+std::vector<TraceEvent> profiler_events;
+std::map<int, std::string> profiler_thread_names;
+std::atomic<int> profiler_next_tid(1);
+
+// Escopos abertos na thread atual
+thread_local OpenScope profiler_stack[PROFILER_MAX_DEPTH];
+thread_local int profiler_depth = 0;
+thread_local int profiler_tid = 0;
+
+// Tempos de quadro (ms) e contadores; usados apenas pela thread de renderização.
+// Os últimos PROFILER_RECENT_FRAMES tempos ficam em um buffer circular; o
+// histórico completo (profiler_frame_times) só é guardado com "--trace".
+float profiler_recent_frames[PROFILER_RECENT_FRAMES];
+int profiler_frame_count = 0;
+double profiler_frame_sum = 0.0;
+std::vector<float> profiler_frame_times;
+std::vector<TraceCounters> profiler_counters;
+double profiler_frame_start = 0.0;
+double profiler_frame_average = 0.0;
+int profiler_draw_calls = 0, profiler_uniforms = 0, profiler_state_changes = 0, profiler_elided = 0;
+int profiler_last_draw_calls = 0, profiler_last_uniforms = 0, profiler_last_state_changes = 0, profiler_last_elided = 0;
+
+GpuQuery profiler_gpu_queries[PROFILER_GPU_LATENCY][PROFILER_MAX_GPU_SCOPES];
+int profiler_gpu_count[PROFILER_GPU_LATENCY];
+int profiler_gpu_frame = 0;
+bool profiler_gpu_open = false;
+
+// Tempos (ms) dos escopos de GPU lidos no último Profiler_EndFrame()
+std::vector< std::pair<const char*, double> > profiler_gpu_last;
+
+static double Profiler_Now()
+{
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - profiler_epoch).count();
+}
+
+static int Profiler_ThreadId()
+{
+    if (profiler_tid == 0)
+        profiler_tid = profiler_next_tid++;
+    return profiler_tid;
+}
+
+// Acumula "duration" microssegundos no escopo "name" e guarda o evento de trace
+static void Profiler_Record(const char* name, double start, double duration, int tid, bool gpu)
+{
+    std::lock_guard<std::mutex> lock(profiler_mutex);
+
+    // Os nomes são literais de string, então basta comparar os ponteiros
+    size_t i = 0;
+    while (i < profiler_scopes.size() && (profiler_scopes[i].name != name || profiler_scopes[i].gpu != gpu))
+        ++i;
+    if (i == profiler_scopes.size())
+    {
+        ScopeStats stats = { name, 0.0, 0.0, gpu };
+        profiler_scopes.push_back(stats);
+    }
+    profiler_scopes[i].frame += duration / 1000.0;
+
+    if (profiler_tracing)
+    {
+        TraceEvent event = { name, start, duration, tid };
+        profiler_events.push_back(event);
+    }
+}
+
+// "gpu": cria as consultas GL_TIME_ELAPSED (precisa de um contexto OpenGL).
+// "tracing": guarda todos os eventos para Profiler_WriteTrace().
+void Profiler_Init(bool gpu, bool tracing)
+{
+    profiler_epoch = std::chrono::steady_clock::now();
+    profiler_enabled = true;
+    profiler_tracing = tracing;
+    profiler_gpu = gpu;
+
+    if (gpu)
+    {
+        for (int f = 0; f < PROFILER_GPU_LATENCY; ++f)
+        {
+            for (int i = 0; i < PROFILER_MAX_GPU_SCOPES; ++i)
+                glGenQueries(1, &profiler_gpu_queries[f][i].id);
+            profiler_gpu_count[f] = 0;
+        }
+    }
+}
+
+// Nome da thread atual no arquivo de trace
+void Profiler_SetThreadName(const char* name)
+{
+    std::lock_guard<std::mutex> lock(profiler_mutex);
+    profiler_thread_names[Profiler_ThreadId()] = name;
+}
+
+void Profiler_BeginScope(const char* name)
+{
+    if (!profiler_enabled || profiler_depth >= PROFILER_MAX_DEPTH)
+    {
+        ++profiler_depth;
+        return;
+    }
+    profiler_stack[profiler_depth].name = name;
+    profiler_stack[profiler_depth].start = Profiler_Now();
+    ++profiler_depth;
+}
+
+void Profiler_EndScope()
+{
+    --profiler_depth;
+    if (!profiler_enabled || profiler_depth >= PROFILER_MAX_DEPTH)
+        return;
+    const OpenScope& scope = profiler_stack[profiler_depth];
+    Profiler_Record(scope.name, scope.start, Profiler_Now() - scope.start, Profiler_ThreadId(), false);
+}
+
+// Consultas GL_TIME_ELAPSED não podem ser aninhadas: um escopo de GPU aberto
+// enquanto outro está ativo é ignorado.
+void Profiler_BeginGpuScope(const char* name)
+{
+    if (!profiler_enabled || !profiler_gpu || profiler_gpu_open)
+        return;
+    int slot = profiler_gpu_frame % PROFILER_GPU_LATENCY;
+    if (profiler_gpu_count[slot] >= PROFILER_MAX_GPU_SCOPES)
+        return;
+
+    GpuQuery& query = profiler_gpu_queries[slot][profiler_gpu_count[slot]++];
+    query.name = name;
+    query.cpu_start = Profiler_Now();
+    glBeginQuery(GL_TIME_ELAPSED, query.id);
+    profiler_gpu_open = true;
+}
+
+void Profiler_EndGpuScope()
+{
+    if (!profiler_gpu_open)
+        return;
+    glEndQuery(GL_TIME_ELAPSED);
+    profiler_gpu_open = false;
+}
+
+void Profiler_CountDrawCalls(int n) { profiler_draw_calls += n; }
+void Profiler_CountUniforms(int n) { profiler_uniforms += n; }
+void Profiler_CountStateChanges(int n) { profiler_state_changes += n; }
+void Profiler_CountElided(int n) { profiler_elided += n; }
+
+void Profiler_BeginFrame()
+{
+    if (!profiler_enabled)
+        return;
+    profiler_frame_start = Profiler_Now();
+}
+
+void Profiler_EndFrame()
+{
+    if (!profiler_enabled)
+        return;
+
+    double now = Profiler_Now();
+    double frame_ms = (now - profiler_frame_start) / 1000.0;
+    profiler_recent_frames[profiler_frame_count % PROFILER_RECENT_FRAMES] = (float)frame_ms;
+    ++profiler_frame_count;
+    profiler_frame_sum += frame_ms;
+    profiler_frame_average = profiler_frame_count == 1 ? frame_ms
+        : profiler_frame_average + (frame_ms - profiler_frame_average) * PROFILER_SMOOTHING;
+
+    if (profiler_tracing)
+    {
+        profiler_frame_times.push_back((float)frame_ms);
+
+        TraceCounters counters = { profiler_frame_start, profiler_draw_calls, profiler_uniforms, profiler_state_changes, profiler_elided };
+        profiler_counters.push_back(counters);
+
+        std::lock_guard<std::mutex> lock(profiler_mutex);
+        TraceEvent event = { "Frame", profiler_frame_start, now - profiler_frame_start, Profiler_ThreadId() };
+        profiler_events.push_back(event);
+    }
+
+    profiler_last_draw_calls = profiler_draw_calls;
+    profiler_last_uniforms = profiler_uniforms;
+    profiler_last_state_changes = profiler_state_changes;
+    profiler_last_elided = profiler_elided;
+    profiler_draw_calls = profiler_uniforms = profiler_state_changes = profiler_elided = 0;
+
+    // Lemos as consultas emitidas PROFILER_GPU_LATENCY - 1 quadros atrás,
+    // cujo espaço no anel será reutilizado pelo próximo quadro
+    if (profiler_gpu)
+    {
+        ++profiler_gpu_frame;
+        int slot = profiler_gpu_frame % PROFILER_GPU_LATENCY;
+        profiler_gpu_last.clear();
+        for (int i = 0; i < profiler_gpu_count[slot]; ++i)
+        {
+            const GpuQuery& query = profiler_gpu_queries[slot][i];
+            GLuint64 elapsed = 0;
+            glGetQueryObjectui64v(query.id, GL_QUERY_RESULT, &elapsed);
+
+            // Alguns drivers (ex.: llvmpipe) retornam lixo na primeira
+            // consulta; descartamos a primeira volta do anel.
+            if (profiler_gpu_frame <= PROFILER_GPU_LATENCY)
+                continue;
+            Profiler_Record(query.name, query.cpu_start, elapsed / 1000.0, PROFILER_GPU_TID, true);
+            profiler_gpu_last.push_back(std::make_pair(query.name, elapsed / 1e6));
+        }
+        profiler_gpu_count[slot] = 0;
+    }
+
+    // Atualizamos as médias dos escopos
+    std::lock_guard<std::mutex> lock(profiler_mutex);
+    for (size_t i = 0; i < profiler_scopes.size(); ++i)
+    {
+        profiler_scopes[i].average += (profiler_scopes[i].frame - profiler_scopes[i].average) * PROFILER_SMOOTHING;
+        profiler_scopes[i].frame = 0.0;
+    }
+}
+
+// Tempo de GPU (ms) do escopo "name" no quadro mais recente já medido, que é
+// de PROFILER_GPU_LATENCY - 1 quadros atrás. Retorna -1 se não há medida.
+double Profiler_LastGpuTime(const char* name)
+{
+    double total = -1.0;
+    for (size_t i = 0; i < profiler_gpu_last.size(); ++i)
+    {
+        if (strcmp(profiler_gpu_last[i].first, name) == 0)
+            total = std::max(total, 0.0) + profiler_gpu_last[i].second;
+    }
+    return total;
+}
+
+// Percentil p (0..100) de uma lista ordenada
+static float Profiler_Percentile(const std::vector<float>& sorted, double p)
+{
+    if (sorted.empty())
+        return 0.0f;
+    size_t index = (size_t)(p / 100.0 * (sorted.size() - 1) + 0.5);
+    return sorted[std::min(index, sorted.size() - 1)];
+}
+
+// Tempos de quadro ordenados: o histórico completo, se foi guardado (com
+// "--trace" e "recent_only" falso), ou os últimos PROFILER_RECENT_FRAMES
+static std::vector<float> Profiler_SortedFrameTimes(bool recent_only)
+{
+    std::vector<float> sorted;
+    if (profiler_tracing && !recent_only)
+        sorted = profiler_frame_times;
+    else
+        sorted.assign(profiler_recent_frames, profiler_recent_frames + std::min(profiler_frame_count, PROFILER_RECENT_FRAMES));
+    std::sort(sorted.begin(), sorted.end());
+    return sorted;
+}
+
+void Profiler_ToggleOverlay()
+{
+    profiler_overlay = !profiler_overlay;
+}
+
+// Mostra no canto superior esquerdo o tempo de quadro, os escopos e os contadores
+void Profiler_DrawOverlay(GLFWwindow* window)
+{
+    if (!profiler_enabled || !profiler_overlay)
+        return;
+
+    float lineheight = TextRendering_LineHeight(window);
+    float y = 1.0f - lineheight;
+    char buffer[128];
+
+    // Percentis dos últimos PROFILER_RECENT_FRAMES quadros
+    std::vector<float> recent = Profiler_SortedFrameTimes(true);
+
+    snprintf(buffer, sizeof(buffer), "frame %6.2f ms  p50 %.2f  p95 %.2f  p99 %.2f",
+             profiler_frame_average, Profiler_Percentile(recent, 50), Profiler_Percentile(recent, 95), Profiler_Percentile(recent, 99));
+    TextRendering_PrintString(window, buffer, -1.0f, y, 1.0f);
+    y -= lineheight;
+
+    snprintf(buffer, sizeof(buffer), "draws %d  uniforms %d  state changes %d  elided %d",
+             profiler_last_draw_calls, profiler_last_uniforms, profiler_last_state_changes, profiler_last_elided);
+    TextRendering_PrintString(window, buffer, -1.0f, y, 1.0f);
+    y -= lineheight;
+
+    std::lock_guard<std::mutex> lock(profiler_mutex);
+    for (size_t i = 0; i < profiler_scopes.size(); ++i)
+    {
+        snprintf(buffer, sizeof(buffer), "%s %-22s %7.3f ms", profiler_scopes[i].gpu ? "GPU" : "CPU",
+                 profiler_scopes[i].name, profiler_scopes[i].average);
+        TextRendering_PrintString(window, buffer, -1.0f, y, 1.0f);
+        y -= lineheight;
+    }
+}
+
+// Resumo do tempo de quadro (média, p50, p95, p99), impresso no terminal. Sem
+// "--trace", os percentis são dos últimos PROFILER_RECENT_FRAMES quadros.
+void Profiler_PrintSummary()
+{
+    if (profiler_frame_count == 0)
+        return;
+
+    std::vector<float> sorted = Profiler_SortedFrameTimes(false);
+    printf("Profiler: %d frames, avg %.3f ms, ", profiler_frame_count, profiler_frame_sum / profiler_frame_count);
+    if ((int)sorted.size() < profiler_frame_count)
+        printf("last %d: ", (int)sorted.size());
+    printf("p50 %.3f ms, p95 %.3f ms, p99 %.3f ms\n",
+           Profiler_Percentile(sorted, 50), Profiler_Percentile(sorted, 95), Profiler_Percentile(sorted, 99));
+}
+
+// Escreve todos os eventos no formato JSON "trace_event" do Chrome
+bool Profiler_WriteTrace(const char* filename)
+{
+    FILE* file = fopen(filename, "w");
+    if (!file)
+    {
+        fprintf(stderr, "ERROR: cannot open \"%s\" for writing.\n", filename);
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(profiler_mutex);
+
+    fprintf(file, "{\"traceEvents\":[\n");
+    fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"GPU\"}}", PROFILER_GPU_TID);
+
+    std::map<int, std::string>::const_iterator name;
+    for (name = profiler_thread_names.begin(); name != profiler_thread_names.end(); ++name)
+        fprintf(file, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+                name->first, name->second.c_str());
+
+    for (size_t i = 0; i < profiler_events.size(); ++i)
+    {
+        const TraceEvent& e = profiler_events[i];
+        fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                e.name, e.tid, e.start, e.duration);
+    }
+
+    for (size_t i = 0; i < profiler_counters.size(); ++i)
+    {
+        const TraceCounters& c = profiler_counters[i];
+        fprintf(file, ",\n{\"name\":\"Counters\",\"ph\":\"C\",\"pid\":1,\"ts\":%.3f,"
+                "\"args\":{\"draw_calls\":%d,\"uniforms\":%d,\"state_changes\":%d,\"elided\":%d}}",
+                c.time, c.draw_calls, c.uniforms, c.state_changes, c.elided);
+    }
+
+    std::vector<float> sorted = Profiler_SortedFrameTimes(false);
+    fprintf(file, "\n],\n\"displayTimeUnit\":\"ms\",\n");
+    fprintf(file, "\"otherData\":{\"frames\":%d,\"frame_ms_p50\":%.3f,\"frame_ms_p95\":%.3f,\"frame_ms_p99\":%.3f}\n}\n",
+            (int)sorted.size(), Profiler_Percentile(sorted, 50), Profiler_Percentile(sorted, 95), Profiler_Percentile(sorted, 99));
+
+    fclose(file);
+    printf("Profiler: wrote %d events to \"%s\"\n", (int)(profiler_events.size() + profiler_counters.size()), filename);
+    return true;
+}
@@ -0,0 +1,183 @@
+// Níveis de qualidade: um único ajuste que escolhe a distância de visão, a
+// janela em que os obstáculos aparecem, a amostragem das texturas, o MSAA e a
+// iluminação, para que o mesmo executável rode bem tanto no renderizador por
+// software quanto em uma GPU dedicada.
+//
+// O arquivo de configuração ("--quality-config ARQUIVO") tem uma opção por
+// linha, no formato "nome = valor"; linhas vazias e o que vem depois de '#'
+// são ignorados. A opção "preset" parte de um dos níveis pré-definidos e as
+// demais alteram valores isolados:
+//
+//   preset = low
+//   far_distance = 45
+//   msaa_samples = 2
+#include <cmath>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+
+#include "quality.h"
+
+namespace
+{
+    // O nível "medium" reproduz os valores fixos usados antes dos níveis de
+    // qualidade. No "low", os obstáculos aparecem antes do "far plane"
+    // (o Z do modelo é multiplicado por 0.8 e a câmera fica em Z = -6.3).
+    const QualitySettings quality_presets[] = {
+        //  nome      far    spawn     behind  bias  aniso  msaa  specular
+        { "low",    40.0f, 25, 42, -12.0f, 1.0f,  1.0f, 0, false },
+        { "medium", 60.0f, 25, 65, -20.0f, 0.0f,  1.0f, 0, true  },
+        { "high",   60.0f, 25, 65, -20.0f, 0.0f, 16.0f, 4, true  },
+    };
+    const int QUALITY_NUM_PRESETS = sizeof(quality_presets) / sizeof(quality_presets[0]);
+
+    std::string Quality_Trim(const std::string& s)
+    {
+        size_t begin = s.find_first_not_of(" \t\r");
+        if (begin == std::string::npos)
+            return std::string();
+        size_t end = s.find_last_not_of(" \t\r");
+        return s.substr(begin, end - begin + 1);
+    }
+
+    bool Quality_ParseFloat(const std::string& value, float* out)
+    {
+        char* end = NULL;
+        float f = strtof(value.c_str(), &end);
+        if (end == value.c_str() || *end != '\0')
+            return false;
+        *out = f;
+        return true;
+    }
+
+    bool Quality_ParseInt(const std::string& value, int* out)
+    {
+        char* end = NULL;
+        long i = strtol(value.c_str(), &end, 10);
+        if (end == value.c_str() || *end != '\0')
+            return false;
+        *out = (int)i;
+        return true;
+    }
+
+    bool Quality_ParseBool(const std::string& value, bool* out)
+    {
+        if (value == "1" || value == "true" || value == "on")
+            *out = true;
+        else if (value == "0" || value == "false" || value == "off")
+            *out = false;
+        else
+            return false;
+        return true;
+    }
+}
+
+// Verifica a janela dos obstáculos, venha ela do arquivo de configuração ou
+// de uma gravação ("--replay"): AddRandomObstacles() sorteia o Z com
+// "% (spawn_far - spawn_near)", que precisa ser um inteiro positivo.
+bool Quality_ValidObstacleWindow(int spawn_near, int spawn_far, float behind_z)
+{
+    return spawn_far > spawn_near && (long long)spawn_far - spawn_near <= INT_MAX && std::isfinite(behind_z);
+}
+
+// Copia para "q" o nível pré-definido "name". Retorna false se ele não existe.
+bool Quality_SetPreset(QualitySettings& q, const char* name)
+{
+    for (int i = 0; i < QUALITY_NUM_PRESETS; ++i)
+    {
+        if (strcmp(quality_presets[i].name, name) == 0)
+        {
+            q = quality_presets[i];
+            return true;
+        }
+    }
+    fprintf(stderr, "ERROR: unknown quality level \"%s\" (expected low, medium or high).\n", name);
+    return false;
+}
+
+// Aplica sobre "q" as opções do arquivo "filename"
+bool Quality_LoadFile(QualitySettings& q, const char* filename)
+{
+    std::ifstream file(filename);
+    if (!file)
+    {
+        fprintf(stderr, "ERROR: cannot open quality configuration \"%s\".\n", filename);
+        return false;
+    }
+
+    std::string line;
+    int line_number = 0;
+    bool customized = false;
+    while (std::getline(file, line))
+    {
+        ++line_number;
+        size_t comment = line.find('#');
+        if (comment != std::string::npos)
+            line.erase(comment);
+        line = Quality_Trim(line);
+        if (line.empty())
+            continue;
+
+        size_t equals = line.find('=');
+        std::string key = Quality_Trim(line.substr(0, equals));
+        std::string value = equals != std::string::npos ? Quality_Trim(line.substr(equals + 1)) : std::string();
+
+        bool ok;
+        if (key == "preset")
+        {
+            // Os valores definidos antes no arquivo são descartados
+            if (!Quality_SetPreset(q, value.c_str()))
+                return false;
+            customized = false;
+            continue;
+        }
+        else if (key == "far_distance")
+            ok = Quality_ParseFloat(value, &q.far_distance) && q.far_distance > 0.1f;
+        else if (key == "spawn_near")
+            ok = Quality_ParseInt(value, &q.spawn_near);
+        else if (key == "spawn_far")
+            ok = Quality_ParseInt(value, &q.spawn_far);
+        else if (key == "behind_z")
+            ok = Quality_ParseFloat(value, &q.behind_z);
+        else if (key == "lod_bias")
+            ok = Quality_ParseFloat(value, &q.lod_bias);
+        else if (key == "anisotropy")
+            ok = Quality_ParseFloat(value, &q.anisotropy) && q.anisotropy >= 1.0f;
+        else if (key == "msaa_samples")
+            ok = Quality_ParseInt(value, &q.msaa_samples) && q.msaa_samples >= 0;
+        else if (key == "specular")
+            ok = Quality_ParseBool(value, &q.specular);
+        else
+        {
+            fprintf(stderr, "ERROR: %s:%d: unknown option \"%s\".\n", filename, line_number, key.c_str());
+            return false;
+        }
+
+        if (!ok)
+        {
+            fprintf(stderr, "ERROR: %s:%d: invalid value \"%s\" for \"%s\".\n", filename, line_number, value.c_str(), key.c_str());
+            return false;
+        }
+        customized = true;
+    }
+
+    if (!Quality_ValidObstacleWindow(q.spawn_near, q.spawn_far, q.behind_z))
+    {
+        fprintf(stderr, "ERROR: %s: invalid obstacle window (spawn_far must be greater than spawn_near, behind_z finite).\n", filename);
+        return false;
+    }
+
+    if (customized)
+        strcpy(q.name, "custom");
+    return true;
+}
+
+void Quality_Print(const QualitySettings& q)
+{
+    printf("Quality: %s (far %.0f, spawn %d-%d, behind %.0f, LOD bias %.1f, anisotropy %.0fx, MSAA %dx, specular %s)\n",
+           q.name, q.far_distance, q.spawn_near, q.spawn_far, q.behind_z, q.lod_bias, q.anisotropy, q.msaa_samples,
+           q.specular ? "on" : "off");
+}
@@ -36,6 +36,15 @@ uniform int object_id;
 uniform vec4 bbox_min;
 uniform vec4 bbox_max;
 
+// Pinta de preto as arestas dos cubos (veja DrawCube() em "main.cpp"): um
+// fragmento está em uma aresta quando fica a menos de CUBE_EDGE_WIDTH pixels
+// de duas faces do cubo ao mesmo tempo.
+uniform bool cube_outline;
+#define CUBE_EDGE_WIDTH 1.0
+
+// Termo especular de Phong, desligado no nível de qualidade "low"
+uniform bool specular;
+
 // Variáveis para acesso das imagens de textura
 uniform sampler2D TextureImage0;
 uniform sampler2D TextureImage1;
@@ -141,9 +150,24 @@ void main()
     vec3 ambient_term = Ka * Ia;
 
     // Termo especular utilizando o modelo de iluminação de Phong
-    vec3 phong_specular_term = Ks * I * pow(max(0, dot(r, v)), q);
+    vec3 phong_specular_term = vec3(0.0, 0.0, 0.0);
+    if ( specular )
+        phong_specular_term = Ks * I * pow(max(0, dot(r, v)), q);
 
     color = lambert_diffuse_term + ambient_term + phong_specular_term;
 
+    if ( cube_outline )
+    {
+        // O cubo vai de -0.5 a 0.5 em X e Z e de -1 a 0 em Y (veja
+        // BuildTriangles()). Dividindo a distância até cada face pela
+        // variação da coordenada entre pixels vizinhos obtemos a distância
+        // em pixels.
+        vec3 q = position_model.xyz - vec3(0.0, -0.5, 0.0);
+        vec3 d = (0.5 - abs(q)) / max(fwidth(q), vec3(1e-6));
+        vec3 near_face = vec3(lessThan(d, vec3(CUBE_EDGE_WIDTH)));
+        if ( near_face.x + near_face.y + near_face.z >= 2.0 )
+            color = vec3(0.0, 0.0, 0.0);
+    }
+
     color = pow(color, vec3(1.0,1.0,1.0)/2.2);
 }
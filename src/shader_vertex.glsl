@@ -26,6 +26,69 @@ out vec2 texcoords;
 // Varivel booleana no cdigo C++ tambm enviada para a GPU
 uniform bool render_as_black;
 
+// Personagem desenhado por instncias (veja BuildCharacter() em "main.cpp").
+// Quando "draw_character"  verdadeiro, a matriz "model"  ignorada: a
+// instncia gl_InstanceID desenha a parte gl_InstanceID % CHARACTER_PARTS do
+// personagem gl_InstanceID / CHARACTER_PARTS, e a matriz de modelo da parte
+//  montada aqui, percorrendo o esqueleto da articulao at a raiz.
+#define CHARACTER_JOINTS 16
+#define CHARACTER_PARTS 14
+#define CHARACTER_MAX_INSTANCES 16
+#define CHARACTER_POSE_VECTORS 9
+uniform bool draw_character;
+// Por articulao: (deslocamento em relao ao pai, ndice do pai) e (escala, 0)
+uniform vec4 character_skeleton[2 * CHARACTER_JOINTS];
+// Por parte do corpo: (escala do cubo, articulao)
+uniform vec4 character_parts[CHARACTER_PARTS];
+// Por personagem: a translao da raiz e os ngulos (Z, X) de cada
+// articulao, duas articulaes por vetor
+uniform vec4 character_poses[CHARACTER_MAX_INSTANCES * CHARACTER_POSE_VECTORS];
+
+mat4 Translate(vec3 t)
+{
+    return mat4(1.0, 0.0, 0.0, 0.0,
+                0.0, 1.0, 0.0, 0.0,
+                0.0, 0.0, 1.0, 0.0,
+                t.x, t.y, t.z, 1.0);
+}
+
+mat4 Scale(vec3 s)
+{
+    return mat4(s.x, 0.0, 0.0, 0.0,
+                0.0, s.y, 0.0, 0.0,
+                0.0, 0.0, s.z, 0.0,
+                0.0, 0.0, 0.0, 1.0);
+}
+
+// Mesma rotao de JointRotation() em "main.cpp": primeiro X, depois Z
+mat4 JointRotation(float angle_z, float angle_x)
+{
+    float cz = cos(angle_z), sz = sin(angle_z);
+    float cx = cos(angle_x), sx = sin(angle_x);
+    return mat4( cz,       sz,      0.0, 0.0,
+                -sz * cx,  cz * cx, sx,  0.0,
+                 sz * sx, -cz * sx, cx,  0.0,
+                 0.0,      0.0,     0.0, 1.0);
+}
+
+mat4 CharacterPartModel()
+{
+    int character = gl_InstanceID / CHARACTER_PARTS;
+    vec4 part = character_parts[gl_InstanceID - character * CHARACTER_PARTS];
+    int pose = character * CHARACTER_POSE_VECTORS;
+
+    mat4 m = Scale(part.xyz);
+    for (int joint = int(part.w); joint >= 0; )
+    {
+        vec4 offset = character_skeleton[2 * joint];
+        vec4 angles = character_poses[pose + 1 + joint / 2];
+        vec2 a = (joint % 2 == 0) ? angles.xy : angles.zw;
+        m = Translate(offset.xyz) * JointRotation(a.x, a.y) * Scale(character_skeleton[2 * joint + 1].xyz) * m;
+        joint = int(offset.w);
+    }
+    return Translate(character_poses[pose].xyz) * m;
+}
+
 void main()
 {
     // A varivel gl_Position define a posio final de cada vrtice
@@ -40,7 +103,9 @@ void main()
     // deste Vertex Shader, a placa de vdeo (GPU) far a diviso por W. Veja
     // slide 189 do documento "Aula_09_Projecoes.pdf").
 
-    gl_Position = projection * view * model * model_coefficients;
+    mat4 model_matrix = draw_character ? CharacterPartModel() : model;
+
+    gl_Position = projection * view * model_matrix * model_coefficients;
 
     // Como as variveis acima  (tipo vec4) so vetores com 4 coeficientes,
     // tambm  possvel acessar e modificar cada coeficiente de maneira
@@ -54,14 +119,14 @@ void main()
     //
 
         // Posio do vrtice atual no sistema de coordenadas global (World).
-    position_world = model * model_coefficients;
+    position_world = model_matrix * model_coefficients;
 
     // Posio do vrtice atual no sistema de coordenadas local do modelo.
     position_model = model_coefficients;
 
     // Normal do vrtice atual no sistema de coordenadas global (World).
     // Veja slide 94 do documento "Aula_07_Transformacoes_Geometricas_3D.pdf".
-    normal = inverse(transpose(model)) * normal_coefficients;
+    normal = inverse(transpose(model_matrix)) * normal_coefficients;
     normal.w = 0.0;
 
     vec4 cam_pos = inverse(view) * vec4(0.0, 0.0, 0.0, 1.0);
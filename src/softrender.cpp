@@ -0,0 +1,759 @@
+// Renderizador por software (CPU), utilizado quando não existe driver OpenGL
+// (argumento "--software"). Desenha a mesma cena do caminho OpenGL: recebe
+// os mesmos atributos de vértices que BuildTriangles() e
+// BuildTrianglesAndAddToVirtualScene() enviam para a GPU, as matrizes
+// model/view/projection, e aplica o mesmo modelo de iluminação de
+// "shader_fragment.glsl" para cada object_id.
+//
+// Assim como em "shader_vertex.glsl", a cor de cada vértice (interpColor) é
+// calculada por Gouraud na fase de geometria. Modelos sem normais (cubos e
+// chão de BuildTriangles()) recebem a normal nula, como o valor padrão do
+// atributo em OpenGL, e portanto só possuem o termo ambiente.
+//
+// Organização: um "tiled rasterizer" em duas fases, ambas paralelas.
+//  1. Geometria: os triângulos de todos os draws do frame são divididos em
+//     blocos contíguos, um por thread. Cada thread transforma os vértices,
+//     faz o clipping contra o near plane, o backface culling, e insere o
+//     triângulo nas listas ("bins") de todos os tiles que ele cobre.
+//  2. Rasterização: cada thread pega tiles de um contador atômico e
+//     rasteriza, em ordem de submissão, os triângulos de todos os bins
+//     daquele tile, com funções de aresta avaliadas de 4 em 4 pixels (SSE),
+//     z-buffer e interpolação de atributos com correção de perspectiva.
+// Como os blocos da fase 1 são contíguos e os bins são percorridos na ordem
+// das threads, a imagem final não depende do número de threads.
+//
+// As threads auxiliares são criadas uma única vez em SoftRender_Init() e
+// ficam esperando em uma variável de condição até receberem a próxima fase.
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <algorithm>
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+#include <glm/geometric.hpp>
+#include <glm/gtc/matrix_inverse.hpp>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define SOFTRENDER_SSE 1
+#endif
+
+// Identificadores de objetos, iguais aos de "shader_fragment.glsl"
+#define SPHERE 0
+#define BUNNY  1
+#define PLANE  2
+#define BLOCKADE 3
+#define BUS 4
+#define COW 5
+
+#define SOFT_TILE_SIZE 64
+
+// Atributos interpolados por vértice: posição global (3), normal (3), interpColor (3),
+// posição no sistema de coordenadas do modelo (3) e coordenadas de textura (2).
+#define SOFT_NUM_ATTRIBS 14
+
+// Equivalente a um VAO: atributos de vértices e índices de um conjunto de objetos
+struct SoftVertexArray
+{
+    std::vector<glm::vec4> positions;
+    std::vector<glm::vec4> normals;   // Vazio se o modelo não possui normais
+    std::vector<glm::vec4> colors;    // Vazio se o modelo não possui cores
+    std::vector<glm::vec2> texcoords; // Vazio se o modelo não possui coordenadas de textura
+    std::vector<unsigned int> indices;
+};
+
+struct SoftTexture
+{
+    int width, height;
+    std::vector<unsigned char> data; // RGB, sRGB, linhas de baixo para cima (como em LoadTextureImage())
+};
+
+// Um "draw call": estado equivalente às variáveis uniform do shader
+struct SoftDraw
+{
+    int vertex_array;
+    size_t first_index;
+    size_t num_indices;
+    glm::mat4 model;
+    glm::mat4 mvp;
+    glm::mat4 normal_matrix;
+    int object_id;
+    glm::vec4 bbox_min;
+    glm::vec4 bbox_max;
+};
+
+// Triângulo pronto para rasterização (após transformação, clipping e viewport)
+struct SoftTriangle
+{
+    float x[3], y[3];   // Coordenadas de janela
+    float z[3];         // Profundidade em [0,1]
+    float invw[3];      // 1/w, para correção de perspectiva
+    float attribs[3][SOFT_NUM_ATTRIBS]; // Atributos já multiplicados por 1/w
+    float A[3], B[3], C[3]; // Funções de aresta: E(x,y) = A*x + B*y + C
+    float inv_area;
+    int minx, miny, maxx, maxy;
+    int draw;
+};
+
+struct SoftClipVertex
+{
+    glm::vec4 clip;
+    float attribs[SOFT_NUM_ATTRIBS];
+};
+
+std::vector<SoftVertexArray> softrender_vertex_arrays;
+SoftTexture softrender_textures[4];
+
+int softrender_width = 0;
+int softrender_height = 0;
+int softrender_num_threads = 1;
+int softrender_tiles_x = 0;
+int softrender_tiles_y = 0;
+std::vector<unsigned char> softrender_color; // RGB, linhas de baixo para cima (como glReadPixels())
+std::vector<float> softrender_depth;
+
+// Estado atual, equivalente às variáveis uniform
+glm::mat4 softrender_model(1.0f);
+glm::mat4 softrender_view(1.0f);
+glm::mat4 softrender_projection(1.0f);
+int softrender_vertex_array = 0;
+int softrender_object_id = -1;
+glm::vec4 softrender_bbox_min(0.0f);
+glm::vec4 softrender_bbox_max(0.0f);
+glm::vec3 softrender_clear_color(1.0f);
+bool softrender_specular = true;
+
+std::vector<SoftDraw> softrender_draws;
+
+// Triângulos e bins produzidos por cada thread na fase de geometria
+std::vector< std::vector<SoftTriangle> > softrender_thread_triangles;
+std::vector< std::vector< std::vector<unsigned int> > > softrender_thread_bins;
+
+float softrender_srgb_to_linear[256];
+
+// Threads auxiliares (1 a softrender_num_threads-1; a thread 0 é a que chama
+// SoftRender_EndFrame()). Cada fase incrementa softrender_pool_generation, e
+// a thread que a iniciou espera softrender_pool_pending chegar a zero.
+std::vector<std::thread> softrender_pool;
+std::mutex softrender_pool_mutex;
+std::condition_variable softrender_pool_start;
+std::condition_variable softrender_pool_done;
+std::function<void(int)> softrender_pool_job;
+unsigned int softrender_pool_generation = 0;
+int softrender_pool_pending = 0;
+bool softrender_pool_quit = false;
+
+static void SoftRender_Worker(int thread)
+{
+    unsigned int generation = 0;
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(softrender_pool_mutex);
+            softrender_pool_start.wait(lock, [&]() { return softrender_pool_quit || softrender_pool_generation != generation; });
+            if (softrender_pool_quit)
+                return;
+            generation = softrender_pool_generation;
+        }
+
+        // softrender_pool_job só é trocada depois que todas as threads
+        // terminaram a fase anterior
+        softrender_pool_job(thread);
+
+        std::lock_guard<std::mutex> lock(softrender_pool_mutex);
+        if (--softrender_pool_pending == 0)
+            softrender_pool_done.notify_one();
+    }
+}
+
+// Encerra as threads auxiliares. Registrada com atexit() em SoftRender_Init(),
+// pois std::thread não pode ser destruída sem join() (inclusive nas saídas
+// por std::exit() após um erro).
+static void SoftRender_Terminate()
+{
+    {
+        std::lock_guard<std::mutex> lock(softrender_pool_mutex);
+        softrender_pool_quit = true;
+    }
+    softrender_pool_start.notify_all();
+    for (size_t i = 0; i < softrender_pool.size(); ++i)
+        softrender_pool[i].join();
+    softrender_pool.clear();
+}
+
+// Inicializa o framebuffer. A largura deve ser múltipla de 4, pois a
+// rasterização processa grupos de 4 pixels alinhados. Com num_threads <= 0
+// utilizamos uma thread por núcleo.
+bool SoftRender_Init(int width, int height, int num_threads)
+{
+    if (width % 4 != 0)
+    {
+        fprintf(stderr, "ERROR: software renderer width must be a multiple of 4.\n");
+        return false;
+    }
+
+    softrender_width = width;
+    softrender_height = height;
+    if (num_threads <= 0)
+        num_threads = (int)std::thread::hardware_concurrency();
+    softrender_num_threads = std::max(1, num_threads);
+    softrender_tiles_x = (width + SOFT_TILE_SIZE - 1) / SOFT_TILE_SIZE;
+    softrender_tiles_y = (height + SOFT_TILE_SIZE - 1) / SOFT_TILE_SIZE;
+
+    softrender_color.assign(3 * width * height, 0);
+    softrender_depth.assign(width * height, 1.0f);
+
+    softrender_thread_triangles.resize(softrender_num_threads);
+    softrender_thread_bins.resize(softrender_num_threads);
+    for (int t = 0; t < softrender_num_threads; ++t)
+        softrender_thread_bins[t].resize(softrender_tiles_x * softrender_tiles_y);
+
+    for (int i = 0; i < 256; ++i)
+    {
+        float c = i / 255.0f;
+        softrender_srgb_to_linear[i] = c <= 0.04045f ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+    }
+
+    for (int t = 1; t < softrender_num_threads; ++t)
+        softrender_pool.push_back(std::thread(SoftRender_Worker, t));
+    std::atexit(SoftRender_Terminate);
+    return true;
+}
+
+// Registra um conjunto de atributos de vértices (equivalente a criar um VAO).
+// "positions" e "normals" possuem 4 coeficientes por vértice, "texcoords" 2,
+// e "colors" 4. Vetores vazios indicam atributos ausentes. Retorna o ID, que
+// assim como em OpenGL começa em 1 (0 significa nenhum VAO).
+int SoftRender_AddVertexArray(const std::vector<float>& positions, const std::vector<float>& normals,
+                              const std::vector<float>& texcoords, const std::vector<float>& colors,
+                              const std::vector<unsigned int>& indices)
+{
+    SoftVertexArray va;
+    for (size_t i = 0; i + 3 < positions.size(); i += 4)
+        va.positions.push_back(glm::vec4(positions[i], positions[i+1], positions[i+2], positions[i+3]));
+    for (size_t i = 0; i + 3 < normals.size(); i += 4)
+        va.normals.push_back(glm::vec4(normals[i], normals[i+1], normals[i+2], 0.0f));
+    for (size_t i = 0; i + 3 < colors.size(); i += 4)
+        va.colors.push_back(glm::vec4(colors[i], colors[i+1], colors[i+2], colors[i+3]));
+    for (size_t i = 0; i + 1 < texcoords.size(); i += 2)
+        va.texcoords.push_back(glm::vec2(texcoords[i], texcoords[i+1]));
+    va.indices = indices;
+
+    softrender_vertex_arrays.push_back(va);
+    return (int)softrender_vertex_arrays.size();
+}
+
+// Guarda uma cópia de uma imagem de textura (RGB, sRGB) na unidade indicada
+void SoftRender_AddTexture(int unit, const unsigned char* data, int width, int height)
+{
+    if (unit < 0 || unit >= 4)
+        return;
+    softrender_textures[unit].width = width;
+    softrender_textures[unit].height = height;
+    softrender_textures[unit].data.assign(data, data + 3 * width * height);
+}
+
+void SoftRender_SetCamera(const glm::mat4& view, const glm::mat4& projection)
+{
+    softrender_view = view;
+    softrender_projection = projection;
+}
+
+// Equivalente a glBindVertexArray()
+void SoftRender_BindVertexArray(int vertex_array)
+{
+    softrender_vertex_array = vertex_array;
+}
+
+void SoftRender_SetModel(const glm::mat4& model)
+{
+    softrender_model = model;
+}
+
+void SoftRender_SetObjectId(int object_id)
+{
+    softrender_object_id = object_id;
+}
+
+void SoftRender_SetBBox(const glm::vec4& bbox_min, const glm::vec4& bbox_max)
+{
+    softrender_bbox_min = bbox_min;
+    softrender_bbox_max = bbox_max;
+}
+
+// Liga ou desliga o termo especular de Phong (nível de qualidade)
+void SoftRender_SetSpecular(bool enabled)
+{
+    softrender_specular = enabled;
+}
+
+void SoftRender_BeginFrame(const glm::vec3& clear_color)
+{
+    softrender_clear_color = clear_color;
+    softrender_draws.clear();
+}
+
+// Equivalente a glDrawElements(GL_TRIANGLES, ...) com o estado atual.
+// "first_index" é o índice (não o deslocamento em bytes) do primeiro elemento.
+void SoftRender_DrawElements(size_t first_index, size_t num_indices)
+{
+    const int vertex_array = softrender_vertex_array - 1;
+    if (vertex_array < 0 || vertex_array >= (int)softrender_vertex_arrays.size())
+        return;
+
+    SoftDraw draw;
+    draw.vertex_array = vertex_array;
+    draw.first_index = first_index;
+    draw.num_indices = num_indices;
+    draw.model = softrender_model;
+    draw.mvp = softrender_projection * softrender_view * softrender_model;
+    draw.normal_matrix = glm::inverseTranspose(softrender_model);
+    draw.object_id = softrender_object_id;
+    draw.bbox_min = softrender_bbox_min;
+    draw.bbox_max = softrender_bbox_max;
+    softrender_draws.push_back(draw);
+}
+
+// Executa fn(0), ..., fn(softrender_num_threads-1) em threads distintas:
+// fn(0) na thread atual e as demais nas threads auxiliares
+static void SoftRender_Parallel(const std::function<void(int)>& fn)
+{
+    if (softrender_pool.empty())
+    {
+        fn(0);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(softrender_pool_mutex);
+        softrender_pool_job = fn;
+        softrender_pool_pending = (int)softrender_pool.size();
+        ++softrender_pool_generation;
+    }
+    softrender_pool_start.notify_all();
+
+    fn(0);
+
+    std::unique_lock<std::mutex> lock(softrender_pool_mutex);
+    softrender_pool_done.wait(lock, []() { return softrender_pool_pending == 0; });
+}
+
+// Interpolação linear de um vértice no espaço de recorte (clipping)
+static SoftClipVertex SoftRender_Lerp(const SoftClipVertex& a, const SoftClipVertex& b, float t)
+{
+    SoftClipVertex r;
+    r.clip = a.clip + (b.clip - a.clip) * t;
+    for (int i = 0; i < SOFT_NUM_ATTRIBS; ++i)
+        r.attribs[i] = a.attribs[i] + (b.attribs[i] - a.attribs[i]) * t;
+    return r;
+}
+
+// Monta um triângulo em coordenadas de janela e o insere nos bins dos tiles cobertos
+static void SoftRender_SetupTriangle(const SoftClipVertex* v[3], int draw, int thread)
+{
+    SoftTriangle tri;
+    for (int i = 0; i < 3; ++i)
+    {
+        const float invw = 1.0f / v[i]->clip.w;
+        tri.x[i] = (v[i]->clip.x * invw * 0.5f + 0.5f) * softrender_width;
+        tri.y[i] = (v[i]->clip.y * invw * 0.5f + 0.5f) * softrender_height;
+        tri.z[i] = v[i]->clip.z * invw * 0.5f + 0.5f;
+        tri.invw[i] = invw;
+        for (int k = 0; k < SOFT_NUM_ATTRIBS; ++k)
+            tri.attribs[i][k] = v[i]->attribs[k] * invw;
+    }
+
+    // Área com sinal: positiva para triângulos anti-horários (GL_CCW), os
+    // quais são as faces da frente. As faces de trás são descartadas (GL_CULL_FACE).
+    const float area = (tri.x[1] - tri.x[0]) * (tri.y[2] - tri.y[0]) - (tri.x[2] - tri.x[0]) * (tri.y[1] - tri.y[0]);
+    if (!(area > 0.0f))
+        return;
+    tri.inv_area = 1.0f / area;
+
+    for (int i = 0; i < 3; ++i)
+    {
+        const int j = (i + 1) % 3;
+        const int k = (i + 2) % 3;
+        // A aresta oposta ao vértice i vai de j para k. Os coeficientes são
+        // calculados de forma que a mesma aresta percorrida no sentido
+        // contrário (triângulo vizinho) tenha exatamente os valores negados,
+        // evitando frestas entre triângulos adjacentes.
+        tri.A[i] = tri.y[j] - tri.y[k];
+        tri.B[i] = tri.x[k] - tri.x[j];
+        tri.C[i] = tri.x[j] * tri.y[k] - tri.x[k] * tri.y[j];
+    }
+
+    tri.minx = std::max(0, (int)floorf(std::min(tri.x[0], std::min(tri.x[1], tri.x[2]))));
+    tri.miny = std::max(0, (int)floorf(std::min(tri.y[0], std::min(tri.y[1], tri.y[2]))));
+    tri.maxx = std::min(softrender_width - 1, (int)ceilf(std::max(tri.x[0], std::max(tri.x[1], tri.x[2]))));
+    tri.maxy = std::min(softrender_height - 1, (int)ceilf(std::max(tri.y[0], std::max(tri.y[1], tri.y[2]))));
+    if (tri.minx > tri.maxx || tri.miny > tri.maxy)
+        return;
+    tri.draw = draw;
+
+    std::vector<SoftTriangle>& triangles = softrender_thread_triangles[thread];
+    const unsigned int index = (unsigned int)triangles.size();
+    triangles.push_back(tri);
+
+    for (int ty = tri.miny / SOFT_TILE_SIZE; ty <= tri.maxy / SOFT_TILE_SIZE; ++ty)
+        for (int tx = tri.minx / SOFT_TILE_SIZE; tx <= tri.maxx / SOFT_TILE_SIZE; ++tx)
+            softrender_thread_bins[thread][ty * softrender_tiles_x + tx].push_back(index);
+}
+
+// Fase de geometria para os triângulos [begin, end) do frame, numerados em
+// ordem de submissão através de todos os draws.
+static void SoftRender_GeometryPhase(int thread, size_t begin, size_t end, const std::vector<size_t>& draw_first_triangle,
+                                     const glm::vec3& camera_position)
+{
+    softrender_thread_triangles[thread].clear();
+    for (size_t i = 0; i < softrender_thread_bins[thread].size(); ++i)
+        softrender_thread_bins[thread][i].clear();
+
+    size_t d = std::upper_bound(draw_first_triangle.begin(), draw_first_triangle.end(), begin) - draw_first_triangle.begin() - 1;
+
+    for (size_t t = begin; t < end; ++t)
+    {
+        while (t >= draw_first_triangle[d + 1])
+            ++d;
+        const SoftDraw& draw = softrender_draws[d];
+        const SoftVertexArray& va = softrender_vertex_arrays[draw.vertex_array];
+        const size_t base = draw.first_index + 3 * (t - draw_first_triangle[d]);
+
+        SoftClipVertex in[3];
+        for (int i = 0; i < 3; ++i)
+        {
+            const unsigned int idx = va.indices[base + i];
+            const glm::vec4& p = va.positions[idx];
+            const glm::vec4 pw = draw.model * p;
+            in[i].clip = draw.mvp * p;
+            in[i].attribs[0] = pw.x;
+            in[i].attribs[1] = pw.y;
+            in[i].attribs[2] = pw.z;
+            glm::vec4 n = va.normals.empty() ? glm::vec4(0.0f) : draw.normal_matrix * va.normals[idx];
+            in[i].attribs[3] = n.x;
+            in[i].attribs[4] = n.y;
+            in[i].attribs[5] = n.z;
+
+            // interpColor: iluminação por vértice de "shader_vertex.glsl"
+            glm::vec3 c = va.colors.empty() ? glm::vec3(0.0f) : glm::vec3(va.colors[idx]);
+            glm::vec3 interp_color = c * 0.5f;
+            const float len = glm::length(glm::vec3(n));
+            if (len > 0.0f)
+            {
+                const glm::vec3 nn = glm::vec3(n) / len;
+                const glm::vec3 l = glm::normalize(glm::vec3(1.0f, 1.0f, -1.0f));
+                const glm::vec3 v = glm::normalize(camera_position - glm::vec3(pw));
+                const glm::vec3 r = -l + 2.0f * nn * glm::dot(nn, l);
+                interp_color += c * std::max(0.0f, glm::dot(nn, v))
+                              + glm::vec3(0.8f) * powf(std::max(0.0f, glm::dot(r, v)), 20.0f);
+            }
+            in[i].attribs[6] = interp_color.r;
+            in[i].attribs[7] = interp_color.g;
+            in[i].attribs[8] = interp_color.b;
+            in[i].attribs[9] = p.x;
+            in[i].attribs[10] = p.y;
+            in[i].attribs[11] = p.z;
+            glm::vec2 uv = va.texcoords.empty() ? glm::vec2(0.0f) : va.texcoords[idx];
+            in[i].attribs[12] = uv.x;
+            in[i].attribs[13] = uv.y;
+        }
+
+        // Descartamos triângulos inteiramente fora de um dos planos laterais
+        bool outside = false;
+        for (int axis = 0; axis < 3 && !outside; ++axis)
+        {
+            outside = (in[0].clip[axis] >  in[0].clip.w && in[1].clip[axis] >  in[1].clip.w && in[2].clip[axis] >  in[2].clip.w)
+                   || (in[0].clip[axis] < -in[0].clip.w && in[1].clip[axis] < -in[1].clip.w && in[2].clip[axis] < -in[2].clip.w);
+        }
+        if (outside)
+            continue;
+
+        // Clipping contra o near plane (z >= -w), gerando até 4 vértices
+        SoftClipVertex out[4];
+        int num_out = 0;
+        for (int i = 0; i < 3; ++i)
+        {
+            const SoftClipVertex& a = in[i];
+            const SoftClipVertex& b = in[(i + 1) % 3];
+            const float da = a.clip.z + a.clip.w;
+            const float db = b.clip.z + b.clip.w;
+            if (da >= 0.0f)
+                out[num_out++] = a;
+            // Interpolamos sempre do vértice interno para o externo, para que
+            // arestas compartilhadas gerem exatamente o mesmo vértice
+            if (da >= 0.0f && db < 0.0f)
+                out[num_out++] = SoftRender_Lerp(a, b, da / (da - db));
+            else if (da < 0.0f && db >= 0.0f)
+                out[num_out++] = SoftRender_Lerp(b, a, db / (db - da));
+        }
+
+        for (int i = 1; i + 1 < num_out; ++i)
+        {
+            const SoftClipVertex* v[3] = { &out[0], &out[i], &out[i + 1] };
+            SoftRender_SetupTriangle(v, (int)d, thread);
+        }
+    }
+}
+
+// Amostragem bilinear com GL_CLAMP_TO_EDGE e conversão sRGB -> linear (GL_SRGB8)
+static glm::vec3 SoftRender_SampleTexture(const SoftTexture& tex, float u, float v)
+{
+    if (tex.data.empty())
+        return glm::vec3(0.0f);
+
+    float fx = u * tex.width - 0.5f;
+    float fy = v * tex.height - 0.5f;
+    int x0 = (int)floorf(fx);
+    int y0 = (int)floorf(fy);
+    float ax = fx - x0;
+    float ay = fy - y0;
+
+    glm::vec3 result(0.0f);
+    for (int j = 0; j < 2; ++j)
+    {
+        for (int i = 0; i < 2; ++i)
+        {
+            int x = std::min(std::max(x0 + i, 0), tex.width - 1);
+            int y = std::min(std::max(y0 + j, 0), tex.height - 1);
+            const unsigned char* t = &tex.data[3 * (y * tex.width + x)];
+            float w = (i ? ax : 1.0f - ax) * (j ? ay : 1.0f - ay);
+            result += w * glm::vec3(softrender_srgb_to_linear[t[0]], softrender_srgb_to_linear[t[1]], softrender_srgb_to_linear[t[2]]);
+        }
+    }
+    return result;
+}
+
+// Equivalente ao "shader_fragment.glsl": modelo de Lambert + Phong com os
+// parâmetros de cada object_id, seguido da correção gamma.
+static glm::vec3 SoftRender_Shade(const SoftDraw& draw, const float* a, const glm::vec3& camera_position)
+{
+    glm::vec3 p(a[0], a[1], a[2]);
+    glm::vec3 n(a[3], a[4], a[5]);
+    const float len = glm::length(n);
+
+    const glm::vec3 l = glm::normalize(glm::vec3(1.0f, 1.0f, -1.0f));
+    const glm::vec3 v = glm::normalize(camera_position - p);
+
+    glm::vec3 Kd(a[6], a[7], a[8]);
+    glm::vec3 Ks(0.0f);
+    glm::vec3 Ka = Kd * 2.0f;
+    float q = 1.0f;
+
+    if (draw.object_id == BLOCKADE)
+    {
+        float U = (a[9]  - draw.bbox_min.x) / (draw.bbox_max.x - draw.bbox_min.x);
+        float V = (a[10] - draw.bbox_min.y) / (draw.bbox_max.y - draw.bbox_min.y);
+        Kd = SoftRender_SampleTexture(softrender_textures[2], U, V);
+        Ka = Kd * 0.5f;
+        Ks = glm::vec3(0.8f);
+        q = 20.0f;
+    }
+    else if (draw.object_id == COW)
+    {
+        Kd = glm::vec3(0.8f, 0.0f, 0.0f);
+        Ks = glm::vec3(0.8f);
+        Ka = Kd / 2.0f;
+        q = 80.0f;
+    }
+    else if (draw.object_id == BUS)
+    {
+        Kd = glm::vec3(0.6f);
+        Ks = glm::vec3(0.8f);
+        Ka = Kd / 2.0f;
+        q = 20.0f;
+    }
+
+    // Sem normal, os termos difuso e especular são nulos
+    glm::vec3 color = Ka * 0.5f;
+    if (len > 0.0f)
+    {
+        n /= len;
+        glm::vec3 lit = Kd * std::max(0.0f, glm::dot(n, v));
+        if (softrender_specular)
+        {
+            const glm::vec3 r = -l + 2.0f * n * glm::dot(n, l);
+            lit += Ks * powf(std::max(0.0f, glm::dot(r, v)), q);
+        }
+        color += lit;
+    }
+
+    return glm::vec3(powf(color.r, 1.0f / 2.2f), powf(color.g, 1.0f / 2.2f), powf(color.b, 1.0f / 2.2f));
+}
+
+// Escreve um fragmento que passou no teste de profundidade
+static void SoftRender_ShadePixel(const SoftTriangle& tri, int x, int y, float b0, float b1, float b2, const glm::vec3& camera_position)
+{
+    // Interpolação com correção de perspectiva: sum(b_i * a_i/w_i) / sum(b_i / w_i)
+    const float invw = b0 * tri.invw[0] + b1 * tri.invw[1] + b2 * tri.invw[2];
+    const float wcorr = 1.0f / invw;
+    float a[SOFT_NUM_ATTRIBS];
+    for (int k = 0; k < SOFT_NUM_ATTRIBS; ++k)
+        a[k] = (b0 * tri.attribs[0][k] + b1 * tri.attribs[1][k] + b2 * tri.attribs[2][k]) * wcorr;
+
+    glm::vec3 c = SoftRender_Shade(softrender_draws[tri.draw], a, camera_position);
+    unsigned char* out = &softrender_color[3 * (y * softrender_width + x)];
+    out[0] = (unsigned char)(std::min(std::max(c.r, 0.0f), 1.0f) * 255.0f + 0.5f);
+    out[1] = (unsigned char)(std::min(std::max(c.g, 0.0f), 1.0f) * 255.0f + 0.5f);
+    out[2] = (unsigned char)(std::min(std::max(c.b, 0.0f), 1.0f) * 255.0f + 0.5f);
+}
+
+// Rasteriza um triângulo restrito ao retângulo de um tile
+static void SoftRender_RasterizeTriangle(const SoftTriangle& tri, int tile_x0, int tile_y0, int tile_x1, int tile_y1, const glm::vec3& camera_position)
+{
+    // Começamos em um múltiplo de 4 para que os grupos de 4 pixels fiquem alinhados no tile
+    const int x0 = std::max(tri.minx, tile_x0) & ~3;
+    const int x1 = std::min(tri.maxx, tile_x1);
+    const int y0 = std::max(tri.miny, tile_y0);
+    const int y1 = std::min(tri.maxy, tile_y1);
+
+    for (int y = y0; y <= y1; ++y)
+    {
+        const float py = y + 0.5f;
+        float* depth_row = &softrender_depth[y * softrender_width];
+
+#ifdef SOFTRENDER_SSE
+        // As funções de aresta são avaliadas diretamente em cada pixel (e não
+        // incrementalmente), com a mesma expressão do caminho escalar, para
+        // que o resultado não dependa do tile nem do alinhamento.
+        const __m128 offsets = _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f);
+        __m128 A[3], BC[3], e[3];
+        for (int i = 0; i < 3; ++i)
+        {
+            A[i] = _mm_set1_ps(tri.A[i]);
+            BC[i] = _mm_set1_ps(tri.B[i] * py + tri.C[i]);
+        }
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 one = _mm_set1_ps(1.0f);
+        const __m128 inv_area = _mm_set1_ps(tri.inv_area);
+
+        for (int x = x0; x <= x1; x += 4)
+        {
+            const __m128 px = _mm_add_ps(_mm_set1_ps((float)x), offsets);
+            for (int i = 0; i < 3; ++i)
+                e[i] = _mm_add_ps(_mm_mul_ps(A[i], px), BC[i]);
+
+            __m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(e[0], zero), _mm_cmpge_ps(e[1], zero)), _mm_cmpge_ps(e[2], zero));
+            if (_mm_movemask_ps(inside))
+            {
+                __m128 b0 = _mm_mul_ps(e[0], inv_area);
+                __m128 b1 = _mm_mul_ps(e[1], inv_area);
+                __m128 b2 = _mm_mul_ps(e[2], inv_area);
+                __m128 z = _mm_add_ps(_mm_add_ps(_mm_mul_ps(b0, _mm_set1_ps(tri.z[0])), _mm_mul_ps(b1, _mm_set1_ps(tri.z[1]))), _mm_mul_ps(b2, _mm_set1_ps(tri.z[2])));
+
+                // Os 4 pixels estão sempre dentro da largura do framebuffer
+                // (tiles e framebuffer com largura múltipla de 4)
+                __m128 old_depth = _mm_loadu_ps(&depth_row[x]);
+                __m128 pass = _mm_and_ps(inside, _mm_cmplt_ps(z, old_depth));
+                pass = _mm_and_ps(pass, _mm_and_ps(_mm_cmpge_ps(z, zero), _mm_cmple_ps(z, one)));
+                int mask = _mm_movemask_ps(pass);
+                if (mask)
+                {
+                    float zs[4], b0s[4], b1s[4], b2s[4];
+                    _mm_storeu_ps(zs, z);
+                    _mm_storeu_ps(b0s, b0);
+                    _mm_storeu_ps(b1s, b1);
+                    _mm_storeu_ps(b2s, b2);
+                    for (int i = 0; i < 4; ++i)
+                    {
+                        if (mask & (1 << i))
+                        {
+                            depth_row[x + i] = zs[i];
+                            SoftRender_ShadePixel(tri, x + i, y, b0s[i], b1s[i], b2s[i], camera_position);
+                        }
+                    }
+                }
+            }
+        }
+#else
+        for (int x = x0; x <= x1; ++x)
+        {
+            const float px = x + 0.5f;
+            float e0 = tri.A[0] * px + (tri.B[0] * py + tri.C[0]);
+            float e1 = tri.A[1] * px + (tri.B[1] * py + tri.C[1]);
+            float e2 = tri.A[2] * px + (tri.B[2] * py + tri.C[2]);
+            if (e0 < 0.0f || e1 < 0.0f || e2 < 0.0f)
+                continue;
+            float b0 = e0 * tri.inv_area, b1 = e1 * tri.inv_area, b2 = e2 * tri.inv_area;
+            float z = b0 * tri.z[0] + b1 * tri.z[1] + b2 * tri.z[2];
+            if (z < depth_row[x] && z >= 0.0f && z <= 1.0f)
+            {
+                depth_row[x] = z;
+                SoftRender_ShadePixel(tri, x, y, b0, b1, b2, camera_position);
+            }
+        }
+#endif
+    }
+}
+
+// Rasteriza todos os draws registrados desde SoftRender_BeginFrame()
+void SoftRender_EndFrame()
+{
+    // Numeramos os triângulos de todos os draws em ordem de submissão
+    std::vector<size_t> draw_first_triangle(softrender_draws.size() + 1, 0);
+    for (size_t d = 0; d < softrender_draws.size(); ++d)
+        draw_first_triangle[d + 1] = draw_first_triangle[d] + softrender_draws[d].num_indices / 3;
+    const size_t num_triangles = draw_first_triangle.back();
+    const int num_threads = softrender_num_threads;
+    const glm::vec3 camera_position = glm::vec3(glm::inverse(softrender_view) * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+
+    SoftRender_Parallel([&](int thread)
+    {
+        size_t begin = num_triangles * thread / num_threads;
+        size_t end = num_triangles * (thread + 1) / num_threads;
+        SoftRender_GeometryPhase(thread, begin, end, draw_first_triangle, camera_position);
+    });
+
+    const unsigned char clear_r = (unsigned char)(softrender_clear_color.r * 255.0f + 0.5f);
+    const unsigned char clear_g = (unsigned char)(softrender_clear_color.g * 255.0f + 0.5f);
+    const unsigned char clear_b = (unsigned char)(softrender_clear_color.b * 255.0f + 0.5f);
+
+    std::atomic<int> next_tile(0);
+    const int num_tiles = softrender_tiles_x * softrender_tiles_y;
+
+    SoftRender_Parallel([&](int)
+    {
+        for (int tile = next_tile++; tile < num_tiles; tile = next_tile++)
+        {
+            const int tile_x0 = (tile % softrender_tiles_x) * SOFT_TILE_SIZE;
+            const int tile_y0 = (tile / softrender_tiles_x) * SOFT_TILE_SIZE;
+            const int tile_x1 = std::min(tile_x0 + SOFT_TILE_SIZE, softrender_width) - 1;
+            const int tile_y1 = std::min(tile_y0 + SOFT_TILE_SIZE, softrender_height) - 1;
+
+            // Equivalente a glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT) para o tile
+            for (int y = tile_y0; y <= tile_y1; ++y)
+            {
+                for (int x = tile_x0; x <= tile_x1; ++x)
+                {
+                    unsigned char* c = &softrender_color[3 * (y * softrender_width + x)];
+                    c[0] = clear_r;
+                    c[1] = clear_g;
+                    c[2] = clear_b;
+                    softrender_depth[y * softrender_width + x] = 1.0f;
+                }
+            }
+
+            for (int t = 0; t < num_threads; ++t)
+            {
+                const std::vector<unsigned int>& bin = softrender_thread_bins[t][tile];
+                for (size_t i = 0; i < bin.size(); ++i)
+                    SoftRender_RasterizeTriangle(softrender_thread_triangles[t][bin[i]], tile_x0, tile_y0, tile_x1, tile_y1, camera_position);
+            }
+        }
+    });
+}
+
+// Imagem do último frame: RGB, linhas de baixo para cima (como glReadPixels())
+const unsigned char* SoftRender_GetPixels()
+{
+    return softrender_color.data();
+}
@@ -1,6 +1,8 @@
 // Based on http://hamelot.io/visualization/opengl-text-without-any-external-libraries/
 //   and on https://github.com/rougier/freetype-gl
 #include <string>
+#include <vector>
+#include <cmath>
 
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
@@ -13,6 +15,33 @@
 
 GLuint CreateGpuProgram(GLuint vertex_shader_id, GLuint fragment_shader_id); // Função definida em main.cpp
 
+void Profiler_CountDrawCalls(int n); // Função definida em profiler.cpp
+
+void GlState_UseProgram(GLuint program); // Funções definidas em glstate.cpp
+void GlState_BindVertexArray(GLuint vertex_array);
+void GlState_BindBuffer(GLenum target, GLuint buffer);
+void GlState_Enable(GLenum cap);
+void GlState_BlendFunc(GLenum src, GLenum dst);
+void GlState_DepthFunc(GLenum func);
+void GlState_PolygonMode(GLenum mode);
+
+extern int g_HeadlessWidth;  // Variáveis definidas em headless.cpp
+extern int g_HeadlessHeight;
+
+// Tamanho da janela, ou do framebuffer offscreen caso não exista janela (modo headless)
+void TextRendering_GetWindowSize(GLFWwindow* window, int* width, int* height)
+{
+    if (window)
+    {
+        glfwGetWindowSize(window, width, height);
+    }
+    else
+    {
+        *width = g_HeadlessWidth;
+        *height = g_HeadlessHeight;
+    }
+}
+
 const GLchar* const textvertexshader_source = ""
 "#version 330\n"
 "layout (location = 0) in vec4 position;\n"
@@ -31,7 +60,9 @@ const GLchar* const textfragmentshader_source = ""
 "out vec4 fragColor;\n"
 "void main()\n"
 "{\n"
-    "fragColor = vec4(0, 0, 0, texture(tex, texCoords).r);\n"
+    "float dist = texture(tex, texCoords).r;\n"
+    "float w = max(fwidth(dist) * 0.7, 1e-4);\n"
+    "fragColor = vec4(0, 0, 0, smoothstep(0.5 - w, 0.5 + w, dist));\n"
 "}\n"
 "\0";
 
@@ -87,6 +118,105 @@ GLuint textVBO;
 GLuint textprogram_id;
 GLuint texttexture_id;
 
+// Atlas de "signed distance field" (SDF) gerado em TextRendering_BuildSdfAtlas()
+// a partir dos bitmaps de dejavufont.h. Cada texel guarda a distância (com
+// sinal) até a borda do glifo, de forma que uma única textura de um canal
+// serve para qualquer tamanho de texto.
+#define SDF_SPREAD 4 // Distância máxima codificada, em texels do bitmap original
+#define SDF_ATLAS_WIDTH 512
+#define SDF_ATLAS_HEIGHT 128
+
+struct SdfGlyph
+{
+    float s0, t0, s1, t1; // Coordenadas de textura do glifo (com margem) no atlas SDF
+};
+
+SdfGlyph sdfglyphs[96];
+std::vector<unsigned char> sdfatlas;
+
+// Constrói o atlas SDF. Os glifos de dejavufont.h estão empacotados sem
+// espaço entre si, então cada um é copiado para o novo atlas com uma margem
+// de SDF_SPREAD texels, onde a distância é calculada por força bruta dentro
+// de uma janela de raio SDF_SPREAD. A cobertura (anti-aliasing) dos texels
+// vizinhos é usada para estimar a posição sub-texel da borda.
+void TextRendering_BuildSdfAtlas()
+{
+    sdfatlas.assign(SDF_ATLAS_WIDTH * SDF_ATLAS_HEIGHT, 0);
+
+    const int W = (int)dejavufont.tex_width;
+    const int H = (int)dejavufont.tex_height;
+
+    int penx = 0, peny = 0, rowheight = 0;
+
+    for (size_t g = 0; g < dejavufont.glyphs_count; ++g)
+    {
+        const texture_glyph_t& glyph = dejavufont.glyphs[g];
+        const int gx = (int)floorf(glyph.s0 * W + 0.5f);
+        const int gy = (int)floorf(glyph.t0 * H + 0.5f);
+        const int pw = glyph.width  + 2*SDF_SPREAD;
+        const int ph = glyph.height + 2*SDF_SPREAD;
+
+        if (penx + pw > SDF_ATLAS_WIDTH)
+        {
+            penx = 0;
+            peny += rowheight;
+            rowheight = 0;
+        }
+        if (peny + ph > SDF_ATLAS_HEIGHT)
+        {
+            fprintf(stderr, "ERROR: SDF font atlas is too small.\n");
+            break;
+        }
+
+        // Cobertura do glifo no bitmap original, em [0,1]; fora do retângulo do glifo é zero.
+        auto coverage = [&](int x, int y) -> float
+        {
+            if (x < 0 || y < 0 || x >= glyph.width || y >= glyph.height)
+                return 0.0f;
+            return dejavufont.tex_data[(gy + y) * W + (gx + x)] / 255.0f;
+        };
+
+        for (int y = 0; y < ph; ++y)
+        {
+            for (int x = 0; x < pw; ++x)
+            {
+                const int px = x - SDF_SPREAD;
+                const int py = y - SDF_SPREAD;
+                const bool inside = coverage(px, py) >= 0.5f;
+
+                float mindist = (float)SDF_SPREAD;
+                for (int dy = -SDF_SPREAD; dy <= SDF_SPREAD; ++dy)
+                {
+                    for (int dx = -SDF_SPREAD; dx <= SDF_SPREAD; ++dx)
+                    {
+                        const float a = coverage(px + dx, py + dy);
+                        if ((a >= 0.5f) == inside)
+                            continue;
+                        // A borda fica a (|a - 0.5|) texels do centro do vizinho, na direção deste texel.
+                        const float d = sqrtf((float)(dx*dx + dy*dy)) - fabsf(a - 0.5f);
+                        if (d < mindist)
+                            mindist = d;
+                    }
+                }
+
+                const float signeddist = inside ? mindist : -mindist;
+                float v = 0.5f + 0.5f * signeddist / SDF_SPREAD;
+                v = v < 0.0f ? 0.0f : (v > 1.0f ? 1.0f : v);
+                sdfatlas[(peny + y) * SDF_ATLAS_WIDTH + (penx + x)] = (unsigned char)(v * 255.0f + 0.5f);
+            }
+        }
+
+        sdfglyphs[g].s0 = (float)penx / SDF_ATLAS_WIDTH;
+        sdfglyphs[g].t0 = (float)peny / SDF_ATLAS_HEIGHT;
+        sdfglyphs[g].s1 = (float)(penx + pw) / SDF_ATLAS_WIDTH;
+        sdfglyphs[g].t1 = (float)(peny + ph) / SDF_ATLAS_HEIGHT;
+
+        penx += pw;
+        if (ph > rowheight)
+            rowheight = ph;
+    }
+}
+
 void TextRendering_Init()
 {
     GLuint sampler;
@@ -117,10 +247,13 @@ void TextRendering_Init()
     texttex_uniform = glGetUniformLocation(textprogram_id, "tex");
     glCheckError();
 
+    TextRendering_BuildSdfAtlas();
+
     GLuint textureunit = 31;
     glActiveTexture(GL_TEXTURE0 + textureunit);
     glBindTexture(GL_TEXTURE_2D, texttexture_id);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, dejavufont.tex_width, dejavufont.tex_height, 0, GL_RED, GL_UNSIGNED_BYTE, dejavufont.tex_data);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, SDF_ATLAS_WIDTH, SDF_ATLAS_HEIGHT, 0, GL_RED, GL_UNSIGNED_BYTE, sdfatlas.data());
     glBindSampler(textureunit, sampler);
     glCheckError();
 
@@ -144,23 +277,25 @@ void TextRendering_Init()
 
 float textscale = 1.5f;
 
-void TextRendering_PrintString(GLFWwindow* window, const std::string &str, float x, float y, float scale = 1.0f)
+// Calcula, somente na CPU, os retângulos dos glifos de "str" a partir da
+// posição (x,y) em NDC. "sx" e "sy" convertem pixels da fonte para NDC. Cada
+// glifo ocupa 24 floats em "quads" (6 vértices x,y,s,t). Retorna o número de
+// glifos.
+size_t TextRendering_LayoutString(const std::string &str, float x, float y, float sx, float sy, std::vector<float>& quads)
 {
-    scale *= textscale;
-    int width, height;
-    glfwGetWindowSize(window, &width, &height);
-    float sx = scale / width;
-    float sy = scale / height;
+    quads.clear();
 
     for (size_t i = 0; i < str.size(); i++)
     {
         // Find the glyph for the character we are looking for
         texture_glyph_t *glyph = 0;
+        SdfGlyph *sdfglyph = 0;
         for (size_t j = 0; j < dejavufont.glyphs_count; ++j)
         {
             if (dejavufont.glyphs[j].codepoint == (uint32_t)str[i])
             {
                 glyph = &dejavufont.glyphs[j];
+                sdfglyph = &sdfglyphs[j];
                 break;
             }
         }
@@ -168,60 +303,76 @@ void TextRendering_PrintString(GLFWwindow* window, const std::string &str, float
             continue;
         }
         x += glyph->kerning[0].kerning;
-        float x0 = (float) (x + glyph->offset_x * sx);
-        float y0 = (float) (y + glyph->offset_y * sy);
-        float x1 = (float) (x0 + glyph->width * sx);
-        float y1 = (float) (y0 - glyph->height * sy);
-
-        float s0 = glyph->s0 - 0.5f/dejavufont.tex_width;
-        float t0 = glyph->t0 - 0.5f/dejavufont.tex_height;
-        float s1 = glyph->s1 - 0.5f/dejavufont.tex_width;
-        float t1 = glyph->t1 - 0.5f/dejavufont.tex_height;
-
-        struct {float x, y, s, t;} data[6] = {
-            { x0, y0, s0, t0 },
-            { x0, y1, s0, t1 },
-            { x1, y1, s1, t1 },
-            { x0, y0, s0, t0 },
-            { x1, y1, s1, t1 },
-            { x1, y0, s1, t0 }
+        // O retângulo inclui a margem de SDF_SPREAD texels em volta do glifo
+        float x0 = (float) (x + (glyph->offset_x - SDF_SPREAD) * sx);
+        float y0 = (float) (y + (glyph->offset_y + SDF_SPREAD) * sy);
+        float x1 = (float) (x0 + (glyph->width + 2*SDF_SPREAD) * sx);
+        float y1 = (float) (y0 - (glyph->height + 2*SDF_SPREAD) * sy);
+
+        float s0 = sdfglyph->s0;
+        float t0 = sdfglyph->t0;
+        float s1 = sdfglyph->s1;
+        float t1 = sdfglyph->t1;
+
+        const float data[24] = {
+            x0, y0, s0, t0,
+            x0, y1, s0, t1,
+            x1, y1, s1, t1,
+            x0, y0, s0, t0,
+            x1, y1, s1, t1,
+            x1, y0, s1, t0
         };
+        quads.insert(quads.end(), data, data + 24);
 
-        glEnable(GL_BLEND);
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        x += (glyph->advance_x * sx);
+    }
 
-        glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-        glDepthFunc(GL_ALWAYS);
-        glBindBuffer(GL_ARRAY_BUFFER, textVBO);
-        glBufferSubData(GL_ARRAY_BUFFER, 0, 24 * sizeof(float), data);
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    return quads.size() / 24;
+}
 
-        glUseProgram(textprogram_id);
-        glBindVertexArray(textVAO);
+void TextRendering_PrintString(GLFWwindow* window, const std::string &str, float x, float y, float scale = 1.0f)
+{
+    scale *= textscale;
+    int width, height;
+    TextRendering_GetWindowSize(window, &width, &height);
+    float sx = scale / width;
+    float sy = scale / height;
 
-        glDrawArrays(GL_TRIANGLES, 0, 6);
+    static std::vector<float> quads;
+    size_t num_glyphs = TextRendering_LayoutString(str, x, y, sx, sy, quads);
+
+    // O estado não é restaurado depois do texto: o cache de estado
+    // (glstate.cpp) descarta as chamadas repetidas a cada glifo, e quem
+    // desenha depois define o estado de que precisa.
+    for (size_t i = 0; i < num_glyphs; i++)
+    {
+        GlState_Enable(GL_BLEND);
+        GlState_BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
-        glBindVertexArray(0);
-        glUseProgram(0);
-        glDepthFunc(GL_LESS);
+        GlState_PolygonMode(GL_FILL);
+        GlState_DepthFunc(GL_ALWAYS);
+        GlState_BindBuffer(GL_ARRAY_BUFFER, textVBO);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, 24 * sizeof(float), &quads[24 * i]);
 
-        glDisable(GL_BLEND);
+        GlState_UseProgram(textprogram_id);
+        GlState_BindVertexArray(textVAO);
 
-        x += (glyph->advance_x * sx);
+        glDrawArrays(GL_TRIANGLES, 0, 6);
+        Profiler_CountDrawCalls(1);
     }
 }
 
 float TextRendering_LineHeight(GLFWwindow* window)
 {
     int width, height;
-    glfwGetWindowSize(window, &width, &height);
+    TextRendering_GetWindowSize(window, &width, &height);
     return dejavufont.height / height * textscale;
 }
 
 float TextRendering_CharWidth(GLFWwindow* window)
 {
     int width, height;
-    glfwGetWindowSize(window, &width, &height);
+    TextRendering_GetWindowSize(window, &width, &height);
     return dejavufont.glyphs[32].advance_x / width * textscale;
 }
 
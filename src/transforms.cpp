@@ -0,0 +1,264 @@
+// Rotinas de transformação que operam sobre vetores de matrizes, usadas nos
+// trechos que aplicam a mesma operação a muitas matrizes por quadro
+// (obstáculos e partes do personagem). As funções de matrices.h continuam
+// sendo usadas para construir cada transformação; aqui ficam só os produtos.
+//
+// Com SSE2 (sempre disponível em x86-64) cada coluna do resultado é calculada
+// em um registrador de 4 floats, no mesmo formato "glm_vec4" usado em
+// glm/simd/matrix.h. Compilando com AVX (ex.: -mavx), o produto em lote
+// calcula duas colunas por instrução. Sem SIMD usamos os operadores do GLM.
+//
+// A ordem das somas é a mesma do operator* de glm::mat4, de forma que os
+// resultados são idênticos bit a bit aos do código escalar. Isso importa para
+// a simulação, cujas partidas gravadas com "--record" devem continuar sendo
+// reproduzidas exatamente.
+#include <cstddef>
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+#include <glm/geometric.hpp>
+#include <glm/simd/matrix.h>
+
+#if GLM_ARCH & GLM_ARCH_AVX_BIT
+#include <immintrin.h>
+#endif
+
+#if GLM_ARCH & GLM_ARCH_SSE2_BIT
+
+namespace
+{
+    inline glm_vec4 Transform_Broadcast(glm_vec4 v, int i)
+    {
+        switch (i)
+        {
+        case 0: return _mm_shuffle_ps(v, v, _MM_SHUFFLE(0, 0, 0, 0));
+        case 1: return _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 1, 1, 1));
+        case 2: return _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 2, 2, 2));
+        default: return _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 3, 3));
+        }
+    }
+
+    // Coluna de A*B correspondente à coluna "b" de B: A[0]*b.x + A[1]*b.y + A[2]*b.z + A[3]*b.w
+    inline glm_vec4 Transform_Column(const glm_vec4 a[4], glm_vec4 b)
+    {
+        glm_vec4 r = _mm_mul_ps(a[0], Transform_Broadcast(b, 0));
+        r = _mm_add_ps(r, _mm_mul_ps(a[1], Transform_Broadcast(b, 1)));
+        r = _mm_add_ps(r, _mm_mul_ps(a[2], Transform_Broadcast(b, 2)));
+        r = _mm_add_ps(r, _mm_mul_ps(a[3], Transform_Broadcast(b, 3)));
+        return r;
+    }
+
+    inline void Transform_Load(const glm::mat4& m, glm_vec4 out[4])
+    {
+        const float* p = &m[0][0];
+        out[0] = _mm_loadu_ps(p + 0);
+        out[1] = _mm_loadu_ps(p + 4);
+        out[2] = _mm_loadu_ps(p + 8);
+        out[3] = _mm_loadu_ps(p + 12);
+    }
+
+    inline void Transform_Store(const glm_vec4 in[4], glm::mat4& m)
+    {
+        float* p = &m[0][0];
+        _mm_storeu_ps(p + 0, in[0]);
+        _mm_storeu_ps(p + 4, in[1]);
+        _mm_storeu_ps(p + 8, in[2]);
+        _mm_storeu_ps(p + 12, in[3]);
+    }
+
+    inline void Transform_Mul(const glm::mat4& a, const glm::mat4& b, glm::mat4& out)
+    {
+        glm_vec4 va[4], vb[4], r[4];
+        Transform_Load(a, va);
+        Transform_Load(b, vb);
+        r[0] = Transform_Column(va, vb[0]);
+        r[1] = Transform_Column(va, vb[1]);
+        r[2] = Transform_Column(va, vb[2]);
+        r[3] = Transform_Column(va, vb[3]);
+        Transform_Store(r, out);
+    }
+
+    // Produto vetorial da parte xyz; a coordenada w do resultado é zero
+    inline glm_vec4 Transform_Cross(glm_vec4 u, glm_vec4 v)
+    {
+        glm_vec4 u_yzx = _mm_shuffle_ps(u, u, _MM_SHUFFLE(3, 0, 2, 1));
+        glm_vec4 v_yzx = _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 0, 2, 1));
+        glm_vec4 c = _mm_sub_ps(_mm_mul_ps(u, v_yzx), _mm_mul_ps(u_yzx, v));
+        return _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 0, 2, 1));
+    }
+}
+
+#endif
+
+// out = a*b
+glm::mat4 Transform_Multiply(const glm::mat4& a, const glm::mat4& b)
+{
+#if GLM_ARCH & GLM_ARCH_SSE2_BIT
+    glm::mat4 out;
+    Transform_Mul(a, b, out);
+    return out;
+#else
+    return a * b;
+#endif
+}
+
+// out[i] = a[i]*b[i], para i em [0, count). "out" pode ser igual a "a" ou "b".
+void Transform_MultiplyBatch(const glm::mat4* a, const glm::mat4* b, glm::mat4* out, size_t count)
+{
+#if GLM_ARCH & GLM_ARCH_AVX_BIT
+    // Cada registrador de 8 floats guarda duas colunas: as colunas de A são
+    // repetidas nas duas metades e os elementos das colunas de B são
+    // replicados dentro de cada metade.
+    for (size_t i = 0; i < count; ++i)
+    {
+        const float* pa = &a[i][0][0];
+        const float* pb = &b[i][0][0];
+        __m256 a0 = _mm256_broadcast_ps((const __m128*)(pa + 0));
+        __m256 a1 = _mm256_broadcast_ps((const __m128*)(pa + 4));
+        __m256 a2 = _mm256_broadcast_ps((const __m128*)(pa + 8));
+        __m256 a3 = _mm256_broadcast_ps((const __m128*)(pa + 12));
+        __m256 b01 = _mm256_loadu_ps(pb + 0);
+        __m256 b23 = _mm256_loadu_ps(pb + 8);
+
+        __m256 r01 = _mm256_mul_ps(a0, _mm256_shuffle_ps(b01, b01, 0x00));
+        r01 = _mm256_add_ps(r01, _mm256_mul_ps(a1, _mm256_shuffle_ps(b01, b01, 0x55)));
+        r01 = _mm256_add_ps(r01, _mm256_mul_ps(a2, _mm256_shuffle_ps(b01, b01, 0xAA)));
+        r01 = _mm256_add_ps(r01, _mm256_mul_ps(a3, _mm256_shuffle_ps(b01, b01, 0xFF)));
+
+        __m256 r23 = _mm256_mul_ps(a0, _mm256_shuffle_ps(b23, b23, 0x00));
+        r23 = _mm256_add_ps(r23, _mm256_mul_ps(a1, _mm256_shuffle_ps(b23, b23, 0x55)));
+        r23 = _mm256_add_ps(r23, _mm256_mul_ps(a2, _mm256_shuffle_ps(b23, b23, 0xAA)));
+        r23 = _mm256_add_ps(r23, _mm256_mul_ps(a3, _mm256_shuffle_ps(b23, b23, 0xFF)));
+
+        float* po = &out[i][0][0];
+        _mm256_storeu_ps(po + 0, r01);
+        _mm256_storeu_ps(po + 8, r23);
+    }
+#elif GLM_ARCH & GLM_ARCH_SSE2_BIT
+    for (size_t i = 0; i < count; ++i)
+        Transform_Mul(a[i], b[i], out[i]);
+#else
+    for (size_t i = 0; i < count; ++i)
+        out[i] = a[i] * b[i];
+#endif
+}
+
+// m[i] = m[i]*T, onde T é a translação por "t". Só a quarta coluna muda:
+// m[3] = m[0]*t.x + m[1]*t.y + m[2]*t.z + m[3].
+void Transform_TranslateBatch(glm::mat4* m, size_t count, const glm::vec3& t)
+{
+#if GLM_ARCH & GLM_ARCH_SSE2_BIT
+    const glm_vec4 tx = _mm_set1_ps(t.x);
+    const glm_vec4 ty = _mm_set1_ps(t.y);
+    const glm_vec4 tz = _mm_set1_ps(t.z);
+    for (size_t i = 0; i < count; ++i)
+    {
+        float* p = &m[i][0][0];
+        glm_vec4 c = _mm_mul_ps(_mm_loadu_ps(p + 0), tx);
+        c = _mm_add_ps(c, _mm_mul_ps(_mm_loadu_ps(p + 4), ty));
+        c = _mm_add_ps(c, _mm_mul_ps(_mm_loadu_ps(p + 8), tz));
+        c = _mm_add_ps(c, _mm_loadu_ps(p + 12));
+        _mm_storeu_ps(p + 12, c);
+    }
+#else
+    for (size_t i = 0; i < count; ++i)
+        m[i][3] = m[i][0] * t.x + m[i][1] * t.y + m[i][2] * t.z + m[i][3];
+#endif
+}
+
+// m[i] = m[i] * Translate(0, 0, dz[i]): translação ao longo do eixo Z do
+// modelo, com um deslocamento diferente para cada matriz
+void Transform_TranslateZBatch(glm::mat4* m, const float* dz, size_t count)
+{
+#if GLM_ARCH & GLM_ARCH_SSE2_BIT
+    for (size_t i = 0; i < count; ++i)
+    {
+        float* p = &m[i][0][0];
+        glm_vec4 c = _mm_mul_ps(_mm_loadu_ps(p + 8), _mm_set1_ps(dz[i]));
+        c = _mm_add_ps(c, _mm_loadu_ps(p + 12));
+        _mm_storeu_ps(p + 12, c);
+    }
+#else
+    for (size_t i = 0; i < count; ++i)
+        m[i][3] = m[i][2] * dz[i] + m[i][3];
+#endif
+}
+
+// Inversa de uma transformação afim (última linha igual a [0 0 0 1]): a parte
+// linear é invertida pela matriz adjunta (produtos vetoriais das colunas) e
+// a translação é -inversa(L)*t. Mais barata que glm::inverse() e válida
+// também com escalamentos.
+glm::mat4 Transform_AffineInverse(const glm::mat4& m)
+{
+#if GLM_ARCH & GLM_ARCH_SSE2_BIT
+    glm_vec4 c[4];
+    Transform_Load(m, c);
+
+    // Linhas da inversa da parte linear, multiplicadas pelo determinante
+    glm_vec4 r0 = Transform_Cross(c[1], c[2]);
+    glm_vec4 r1 = Transform_Cross(c[2], c[0]);
+    glm_vec4 r2 = Transform_Cross(c[0], c[1]);
+
+    glm_vec4 det = _mm_mul_ps(c[0], r0);
+    det = _mm_add_ps(det, _mm_shuffle_ps(det, det, _MM_SHUFFLE(2, 3, 0, 1)));
+    det = _mm_add_ss(det, _mm_movehl_ps(det, det));
+    glm_vec4 invdet = _mm_div_ps(_mm_set1_ps(1.0f), _mm_shuffle_ps(det, det, 0));
+    r0 = _mm_mul_ps(r0, invdet);
+    r1 = _mm_mul_ps(r1, invdet);
+    r2 = _mm_mul_ps(r2, invdet);
+
+    // Colunas da inversa = transposta das linhas; a quarta linha fica [0 0 0 1]
+    glm_vec4 rows[4] = { r0, r1, r2, _mm_setzero_ps() };
+    glm_vec4 out[4];
+    glm_mat4_transpose(rows, out);
+
+    glm_vec4 t = c[3];
+    glm_vec4 p = _mm_mul_ps(out[0], Transform_Broadcast(t, 0));
+    p = _mm_add_ps(p, _mm_mul_ps(out[1], Transform_Broadcast(t, 1)));
+    p = _mm_add_ps(p, _mm_mul_ps(out[2], Transform_Broadcast(t, 2)));
+    out[3] = _mm_sub_ps(_mm_set_ps(1.0f, 0.0f, 0.0f, 0.0f), p);
+
+    glm::mat4 result;
+    Transform_Store(out, result);
+    return result;
+#else
+    glm::vec3 c0(m[0]), c1(m[1]), c2(m[2]), t(m[3]);
+    glm::vec3 r0 = glm::cross(c1, c2);
+    glm::vec3 r1 = glm::cross(c2, c0);
+    glm::vec3 r2 = glm::cross(c0, c1);
+    float invdet = 1.0f / glm::dot(c0, r0);
+    r0 *= invdet;
+    r1 *= invdet;
+    r2 *= invdet;
+    return glm::mat4(
+        r0.x, r1.x, r2.x, 0.0f,
+        r0.y, r1.y, r2.y, 0.0f,
+        r0.z, r1.z, r2.z, 0.0f,
+        -glm::dot(r0, t), -glm::dot(r1, t), -glm::dot(r2, t), 1.0f
+    );
+#endif
+}
+
+void Transform_AffineInverseBatch(const glm::mat4* in, glm::mat4* out, size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+        out[i] = Transform_AffineInverse(in[i]);
+}
+
+// Avalia uma hierarquia de transformações: worlds[i] = worlds[parents[i]] * locals[i],
+// ou locals[i] se parents[i] < 0. Cada pai deve vir antes dos seus filhos.
+void Transform_EvaluateHierarchy(const int* parents, const glm::mat4* locals, glm::mat4* worlds, size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (parents[i] < 0)
+            worlds[i] = locals[i];
+        else
+#if GLM_ARCH & GLM_ARCH_SSE2_BIT
+            Transform_Mul(worlds[parents[i]], locals[i], worlds[i]);
+#else
+            worlds[i] = worlds[parents[i]] * locals[i];
+#endif
+    }
+}